@@ -0,0 +1,130 @@
+
+#include <chrono>
+#include <algorithm>
+#include "BodyCommands.hpp"
+
+using namespace physx;
+
+void 	BodyCommandQueue::push( const BodyCommand* commands, size_t count )
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_pending.reserve(_pending.size() + count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const BodyCommand& c = commands[i];
+		// mode indexes the per-mode sums of flush()
+		if (!c.body || !c.value.isFinite() || c.mode > PxForceMode::eACCELERATION)
+		{
+			++_rejectedAtPush;
+			continue;
+		}
+
+		Pending p;
+		p.command = c;
+		p.order = _pending.size();
+		_pending.push_back(p);
+	}
+}
+
+bool 	BodyCommandQueue::hasPending( void )
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return !_pending.empty();
+}
+
+void 	BodyCommandQueue::flush( PxScene& scene )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	Stats stats;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_flushing.swap(_pending);
+		stats.rejected = _rejectedAtPush;
+		_rejectedAtPush = 0;
+	}
+	stats.commands = _flushing.size();
+
+	// Group by body, keeping the push order inside a body
+	std::sort(_flushing.begin(), _flushing.end(), []( const Pending& a, const Pending& b ) {
+		return (a.command.body != b.command.body)? (a.command.body < b.command.body) : (a.order < b.order);
+	});
+
+	// Released bodies must not be touched: only the scene's live dynamics are
+	const PxU32 liveCount = _flushing.empty()? 0 : scene.getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC);
+	_live.resize(liveCount);
+	if (liveCount)
+		scene.getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, _live.data(), liveCount);
+	std::sort(_live.begin(), _live.end());
+
+	// PhysX 3.3 allows a single writer on a scene, so this pass stays serial:
+	// the gain is in the coalescing, not in spreading the calls over threads.
+	const int modeCount = 4;
+	for (size_t begin = 0; begin < _flushing.size(); )
+	{
+		PxRigidDynamic* body = _flushing[begin].command.body;
+		size_t end = begin + 1;
+		while (end < _flushing.size() && _flushing[end].command.body == body)
+			++end;
+
+		if (!std::binary_search(_live.begin(), _live.end(), static_cast<PxActor*>(body))
+				|| (body->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC))
+		{
+			stats.rejected += end - begin;
+			stats.commands -= end - begin;
+			begin = end;
+			continue;
+		}
+
+		PxVec3 forces[modeCount] = { PxVec3(0.f), PxVec3(0.f), PxVec3(0.f), PxVec3(0.f) };
+		PxVec3 torques[modeCount] = { PxVec3(0.f), PxVec3(0.f), PxVec3(0.f), PxVec3(0.f) };
+		bool hasForce[modeCount] = {};
+		bool hasTorque[modeCount] = {};
+		const PxVec3* linearVelocity = nullptr;
+		const PxVec3* angularVelocity = nullptr;
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			const BodyCommand& c = _flushing[i].command;
+			switch (c.type)
+			{
+				case BodyCommand::eFORCE: forces[c.mode] += c.value; hasForce[c.mode] = true; break;
+				case BodyCommand::eTORQUE: torques[c.mode] += c.value; hasTorque[c.mode] = true; break;
+				case BodyCommand::eSET_LINEAR_VELOCITY: linearVelocity = &c.value; break;
+				case BodyCommand::eSET_ANGULAR_VELOCITY: angularVelocity = &c.value; break;
+			}
+		}
+
+		if (linearVelocity)
+		{
+			body->setLinearVelocity(*linearVelocity);
+			++stats.calls;
+		}
+		if (angularVelocity)
+		{
+			body->setAngularVelocity(*angularVelocity);
+			++stats.calls;
+		}
+		for (int mode = 0; mode < modeCount; ++mode)
+		{
+			if (hasForce[mode])
+			{
+				body->addForce(forces[mode], (PxForceMode::Enum)mode);
+				++stats.calls;
+			}
+			if (hasTorque[mode])
+			{
+				body->addTorque(torques[mode], (PxForceMode::Enum)mode);
+				++stats.calls;
+			}
+		}
+
+		++stats.bodies;
+		begin = end;
+	}
+	_flushing.clear();
+
+	stats.flushMs = std::chrono::duration<float, std::milli>(
+			std::chrono::high_resolution_clock::now() - start).count();
+	_lastStats = stats;
+}
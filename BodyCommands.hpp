@@ -0,0 +1,78 @@
+
+#ifndef __MCPLANE_BODYCOMMANDS_HPP__
+# define __MCPLANE_BODYCOMMANDS_HPP__
+
+# include <mutex>
+# include <vector>
+# include <PxPhysicsAPI.h>
+
+/// One force, torque or velocity write on a dynamic body.
+struct BodyCommand
+{
+	enum Type
+	{
+		eFORCE,                 ///< addForce(value, mode)
+		eTORQUE,                ///< addTorque(value, mode)
+		eSET_LINEAR_VELOCITY,   ///< mode is ignored
+		eSET_ANGULAR_VELOCITY,  ///< mode is ignored
+	};
+
+	physx::PxRigidDynamic* 		body 	= nullptr;
+	Type 						type 	= eFORCE;
+	physx::PxForceMode::Enum 	mode 	= physx::PxForceMode::eFORCE;
+	physx::PxVec3 				value 	= physx::PxVec3(0.f);
+};
+
+///
+/// Collects body commands from any thread and applies them at the step
+/// boundary with at most one PhysX call per body and kind of write.
+///
+/// Commands for the same body are coalesced: additions of the same mode are
+/// summed, and for velocities the last one pushed wins. Velocities are set
+/// before forces and torques are added, whatever the push order.
+/// Commands with non-finite values or an unknown mode are dropped at push,
+/// the ones whose body left the scene or is kinematic at flush; both are
+/// counted as rejected. The bodies may have been released since the push:
+/// flush() only dereferences the ones it finds among the scene's actors.
+///
+class BodyCommandQueue
+{
+	public:
+		struct Stats
+		{
+			unsigned 	commands = 0;  ///< accepted since the previous flush
+			unsigned 	bodies = 0;    ///< bodies written to
+			unsigned 	calls = 0;     ///< PhysX calls made
+			unsigned 	rejected = 0;
+			float 		flushMs = 0.f;
+		};
+
+		/// Thread-safe; the array is copied.
+		void 	push( const BodyCommand* commands, size_t count );
+		void 	push( const BodyCommand& command ) { push(&command, 1); }
+
+		/// Apply and clear the pending commands to the bodies still in the
+		/// scene. Call outside simulate()/fetchResults().
+		void 	flush( physx::PxScene& scene );
+		/// Thread-safe; whether commands wait for the next flush.
+		bool 	hasPending( void );
+
+		const Stats& 	getLastStats( void ) const { return _lastStats; }
+
+	private:
+		struct Pending
+		{
+			BodyCommand 	command;
+			unsigned 		order;
+		};
+
+		std::mutex 				_mutex;
+		std::vector<Pending> 	_pending;
+		unsigned 				_rejectedAtPush = 0;
+
+		std::vector<Pending> 			_flushing;  ///< kept to reuse its capacity
+		std::vector<physx::PxActor*> 	_live;      ///< dynamics of the scene, sorted
+		Stats 					_lastStats;
+};
+
+#endif // __MCPLANE_BODYCOMMANDS_HPP__
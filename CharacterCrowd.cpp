@@ -0,0 +1,184 @@
+
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include "CharacterCrowd.hpp"
+
+using namespace physx;
+
+static inline PxVec3 	toVec( const PxExtendedVec3& v ) { return PxVec3((float)v.x, (float)v.y, (float)v.z); }
+
+bool 	CharacterCrowd::init( PxScene& scene, PxMaterial& material, const CrowdSettings& settings )
+{
+	if (_manager)
+		return false; // already init
+
+	_manager = PxCreateControllerManager(scene);
+	if (!_manager)
+	{
+		std::cout << "PxCreateControllerManager failed!" << std::endl;
+		return false;
+	}
+	_obstacles = _manager->createObstacleContext();
+
+	_scene = &scene;
+	_material = &material;
+	_settings = settings;
+	return true;
+}
+
+void 	CharacterCrowd::deinit( void )
+{
+	if (!_manager)
+		return;
+
+	// releasing the manager releases its controllers and obstacle contexts
+	_manager->release();
+	_manager = nullptr;
+	_obstacles = nullptr;
+
+	_controllers.clear();
+	_positions.clear();
+	_goals.clear();
+	_fallSpeeds.clear();
+	_colors.clear();
+	_boxObstacles.clear();
+	_scene = nullptr;
+	_material = nullptr;
+}
+
+PxVec3 	CharacterCrowd::pickGoal( void )
+{
+	auto next = [this]() {
+		_random = _random * 1664525u + 1013904223u;
+		return (_random >> 8) / float(1 << 24) * 2.f - 1.f;
+	};
+	return _areaCenter + PxVec3(next(), 0.f, next()) * _settings.areaRadius;
+}
+
+bool 	CharacterCrowd::spawn( const PxVec3& footPosition, const Color& color )
+{
+	PxCapsuleControllerDesc desc;
+	desc.radius = _settings.radius;
+	desc.height = _settings.height;
+	desc.stepOffset = _settings.stepOffset;
+	desc.slopeLimit = _settings.slopeLimit;
+	desc.material = _material;
+	desc.upDirection = PxVec3(0.f, 1.f, 0.f);
+	desc.climbingMode = PxCapsuleClimbingMode::eCONSTRAINED;
+
+	const float centerHeight = _settings.radius + _settings.height * 0.5f + desc.contactOffset;
+	desc.position = PxExtendedVec3(footPosition.x, footPosition.y + centerHeight, footPosition.z);
+
+	PxController* controller = _manager->createController(desc);
+	if (!controller)
+		return false;
+
+	_controllers.push_back(controller);
+	_positions.push_back(toVec(controller->getPosition()));
+	_goals.push_back(pickGoal());
+	_fallSpeeds.push_back(0.f);
+	_colors.push_back(color);
+	return true;
+}
+
+ObstacleHandle 	CharacterCrowd::addBoxObstacle( const PxVec3& center, const PxVec3& halfExtents, const PxQuat& rotation )
+{
+	Obstacle o;
+	o.box.mPos = PxExtendedVec3(center.x, center.y, center.z);
+	o.box.mRot = rotation;
+	o.box.mHalfExtents = halfExtents;
+	o.handle = _obstacles->addObstacle(o.box);
+	_boxObstacles.push_back(o);
+	return o.handle;
+}
+
+bool 	CharacterCrowd::moveBoxObstacle( ObstacleHandle handle, const PxVec3& center, const PxQuat& rotation )
+{
+	for (Obstacle& o : _boxObstacles)
+	{
+		if (o.handle != handle)
+			continue;
+		o.box.mPos = PxExtendedVec3(center.x, center.y, center.z);
+		o.box.mRot = rotation;
+		return _obstacles->updateObstacle(handle, o.box);
+	}
+	return false;
+}
+
+void 	CharacterCrowd::update( float elapsedTime )
+{
+	if (!_manager || _controllers.empty())
+		return;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	const size_t count = _controllers.size();
+	const float gravity = _scene->getGravity().y;
+	const float reached = _settings.radius * 2.f;
+
+	// Steering, from the cached positions only: no PhysX call in this loop
+	_displacements.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		PxVec3 toGoal = _goals[i] - _positions[i];
+		toGoal.y = 0.f;
+		float distance = toGoal.magnitude();
+		if (distance < reached)
+		{
+			_goals[i] = pickGoal();
+			toGoal = PxVec3(0.f);
+		}
+		else
+			toGoal *= std::min(_settings.speed * elapsedTime, distance) / distance;
+
+		_fallSpeeds[i] += gravity * elapsedTime;
+		_displacements[i] = toGoal + PxVec3(0.f, _fallSpeeds[i] * elapsedTime, 0.f);
+	}
+
+	// Moves, all with the same filters and obstacles
+	const PxControllerFilters filters;
+	const float minDistance = 0.001f;
+	for (size_t i = 0; i < count; ++i)
+	{
+		PxControllerCollisionFlags flags = _controllers[i]->move(_displacements[i], minDistance, elapsedTime,
+				filters, _obstacles);
+		if (flags & PxControllerCollisionFlag::eCOLLISION_DOWN)
+			_fallSpeeds[i] = 0.f;
+		_positions[i] = toVec(_controllers[i]->getPosition());
+	}
+
+	_manager->computeInteractions(elapsedTime);
+
+	_lastUpdateMs = std::chrono::duration<float, std::milli>(
+			std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void 	CharacterCrowd::appendCapsules( CapsuleInstances& capsules ) const
+{
+	capsules.reserve(capsules.size() + _positions.size());
+	for (size_t i = 0; i < _positions.size(); ++i)
+	{
+		CapsuleInstance c;
+		c.position = vec3(_positions[i].x, _positions[i].y, _positions[i].z);
+		c.radius = _settings.radius;
+		c.halfHeight = _settings.height * 0.5f;
+		c.color = _colors[i];
+		capsules.push_back(c);
+	}
+}
+
+void 	CharacterCrowd::appendObstacleBoxes( BoxInstances& boxes ) const
+{
+	for (const Obstacle& o : _boxObstacles)
+	{
+		const PxQuat& q = o.box.mRot;
+		const PxVec3& e = o.box.mHalfExtents;
+
+		BoxInstance instance;
+		mat4 model = mat4_cast(quat(q.w, q.x, q.y, q.z));
+		model = model * glm::scale(mat4(1.f), vec3(e.x, e.y, e.z) * 2.f);
+		instance.model = glm::translate(mat4(1.f), vec3(o.box.mPos.x, o.box.mPos.y, o.box.mPos.z)) * model;
+		instance.color = Color(0.9f, 0.9f, 0.9f);
+		boxes.push_back(instance);
+	}
+}
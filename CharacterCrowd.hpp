@@ -0,0 +1,87 @@
+
+#ifndef __MCPLANE_CHARACTERCROWD_HPP__
+# define __MCPLANE_CHARACTERCROWD_HPP__
+
+# include <vector>
+# include <PxPhysicsAPI.h>
+# include "Graphics.hpp"
+
+struct CrowdSettings
+{
+	float 		radius 		= 0.35f;
+	float 		height 		= 1.f;    ///< of the cylinder part
+	float 		stepOffset 	= 0.3f;
+	float 		slopeLimit 	= 0.7f;   ///< cosine of the steepest walkable slope
+	float 		speed 		= 2.5f;   ///< meters per second
+	float 		areaRadius 	= 25.f;   ///< goals are picked within this distance of the area center
+};
+
+///
+/// Many capsule character controllers wandering between random goals.
+///
+/// update() walks the controllers in one pass: all displacements are
+/// computed first from contiguous arrays, then every controller is moved
+/// with the same filters and obstacle context, and finally the
+/// controller-controller interactions are computed once for the crowd.
+/// It moves kinematic actors, so it must be called between fetchResults()
+/// and the next simulate().
+///
+/// The actors of the controllers have no userData.
+///
+class CharacterCrowd
+{
+	public:
+		bool 	init( physx::PxScene& scene, physx::PxMaterial& material,
+				const CrowdSettings& settings = CrowdSettings() );
+		void 	deinit( void );
+
+		/// Goals are picked around this point.
+		void 	setArea( const physx::PxVec3& center ) { _areaCenter = center; }
+
+		/// Returns false when the controller could not be created (e.g. overlapping geometry).
+		bool 	spawn( const physx::PxVec3& footPosition, const Color& color );
+
+		/// Obstacles only exist for the controllers, not for the rigid bodies.
+		physx::ObstacleHandle 	addBoxObstacle( const physx::PxVec3& center, const physx::PxVec3& halfExtents,
+				const physx::PxQuat& rotation = physx::PxQuat(physx::PxIdentity) );
+		bool 	moveBoxObstacle( physx::ObstacleHandle handle, const physx::PxVec3& center,
+				const physx::PxQuat& rotation = physx::PxQuat(physx::PxIdentity) );
+
+		void 	update( float elapsedTime );
+
+		size_t 	size( void ) const { return _controllers.size(); }
+		float 	getLastUpdateMs( void ) const { return _lastUpdateMs; }
+
+		void 	appendCapsules( CapsuleInstances& capsules ) const;
+		void 	appendObstacleBoxes( BoxInstances& boxes ) const;
+
+	private:
+		struct Obstacle
+		{
+			physx::ObstacleHandle 	handle;
+			physx::PxBoxObstacle 	box;
+		};
+
+		physx::PxVec3 	pickGoal( void );
+
+		physx::PxScene* 				_scene = nullptr;
+		physx::PxMaterial* 				_material = nullptr;
+		physx::PxControllerManager* 	_manager = nullptr;
+		physx::PxObstacleContext* 		_obstacles = nullptr;
+		CrowdSettings 					_settings;
+		physx::PxVec3 					_areaCenter = physx::PxVec3(0.f);
+		unsigned 						_random = 12345;
+
+		// one entry per character, kept contiguous for the update pass
+		std::vector<physx::PxController*> 	_controllers;
+		std::vector<physx::PxVec3> 			_positions;  ///< capsule centers after the last move
+		std::vector<physx::PxVec3> 			_goals;
+		std::vector<float> 					_fallSpeeds;
+		std::vector<Color> 					_colors;
+		std::vector<physx::PxVec3> 			_displacements;  ///< scratch
+
+		std::vector<Obstacle> 			_boxObstacles;
+		float 							_lastUpdateMs = 0.f;
+};
+
+#endif // __MCPLANE_CHARACTERCROWD_HPP__
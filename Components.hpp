@@ -0,0 +1,64 @@
+
+#ifndef __MCPLANE_COMPONENTS_HPP__
+# define __MCPLANE_COMPONENTS_HPP__
+
+# include <PxPhysicsAPI.h>
+# include "Graphics.hpp"
+# include "Ecs.hpp"
+
+///
+/// Components of the demo entities, stored in a World.
+///
+
+struct Transform
+{
+	vec3 			position 	= vec3(1.f, 1.f, 1.f);
+	quat 			rotation 	= quat(1.f, 0.f, 0.f, 0.f);
+	vec3 			scale 		= vec3(1.f, 1.f, 1.f);
+
+	mat4 			getModelMatrix( void ) const {
+		mat4 model = mat4_cast(rotation);
+		model = model*glm::scale(mat4(1.f), scale);
+		model = glm::translate(mat4(1.f), position)*model;
+		return model;
+	};
+};
+
+/// Rigid actor owned by the entity, static or dynamic.
+struct PhysicsBody
+{
+	physx::PxRigidActor* 	actor = nullptr;
+};
+
+struct RenderColor
+{
+	Color 			color 		= Color(1.f, 1.f, 1.f);
+};
+
+/// Joints attaching the entity to others.
+struct JointLink
+{
+	static const unsigned 	MAX_LINKS = 4;
+
+	physx::PxJoint* 	joints[MAX_LINKS];
+	EntityId 			others[MAX_LINKS];
+	unsigned 			count = 0;
+};
+
+/// Tag: the body is asleep, its pose does not need syncing.
+struct Sleeping
+{
+};
+
+/// Result of the culling system, for the instance fill.
+struct Visibility
+{
+	bool 			visible 	= true;
+};
+
+struct Name
+{
+	char 			text[16] 	= {};
+};
+
+#endif // __MCPLANE_COMPONENTS_HPP__
@@ -0,0 +1,125 @@
+
+#include <chrono>
+#include <vector>
+#include "ContactTuning.hpp"
+
+using namespace physx;
+
+ContactModifier::ContactModifier( void ) : _nanoseconds(0), _pairs(0)
+{
+	for (unsigned i = 0; i < GROUP_COUNT; ++i)
+		_active[i] = false;
+	rebuildTable();
+}
+
+void 	ContactModifier::setGroup( unsigned group, const ContactTuning& tuning )
+{
+	if (group >= GROUP_COUNT)
+		return;
+	_groups[group] = tuning;
+	_active[group] = true;
+	rebuildTable();
+}
+
+void 	ContactModifier::resetGroup( unsigned group )
+{
+	if (group >= GROUP_COUNT)
+		return;
+	_groups[group] = ContactTuning();
+	_active[group] = false;
+	rebuildTable();
+}
+
+void 	ContactModifier::copyGroups( const ContactModifier& other )
+{
+	for (unsigned i = 0; i < GROUP_COUNT; ++i)
+	{
+		_groups[i] = other._groups[i];
+		_active[i] = other._active[i];
+	}
+	rebuildTable();
+}
+
+void 	ContactModifier::rebuildTable( void )
+{
+	// the lowest active group wins, masks without any are left untouched
+	for (PxU32 mask = 0; mask <= GROUP_MASK; ++mask)
+	{
+		_table[mask] = ContactTuning();
+		_tableActive[mask] = false;
+		for (unsigned group = 0; group < GROUP_COUNT; ++group)
+			if ((mask & (1u << group)) && _active[group])
+			{
+				_table[mask] = _groups[group];
+				_tableActive[mask] = true;
+				break;
+			}
+	}
+}
+
+void 	ContactModifier::setActorGroups( PxRigidActor& actor, PxU32 groupBits )
+{
+	std::vector<PxShape*> shapes(actor.getNbShapes());
+	if (shapes.empty())
+		return;
+	actor.getShapes(&shapes[0], shapes.size());
+
+	for (PxShape* shape : shapes)
+	{
+		PxFilterData fd = shape->getSimulationFilterData();
+		fd.word1 = (fd.word1 & ~GROUP_MASK) | (groupBits & GROUP_MASK);
+		shape->setSimulationFilterData(fd);
+	}
+
+	// pairs already found keep their flags until filtered again
+	if (actor.getScene())
+		actor.getScene()->resetFiltering(actor);
+}
+
+PxFilterFlags 	ContactModifier::filterShader(
+		PxFilterObjectAttributes attributes0, PxFilterData filterData0,
+		PxFilterObjectAttributes attributes1, PxFilterData filterData1,
+		PxPairFlags& pairFlags, const void* constantBlock, PxU32 constantBlockSize )
+{
+	PxFilterFlags flags = PxDefaultSimulationFilterShader(attributes0, filterData0,
+			attributes1, filterData1, pairFlags, constantBlock, constantBlockSize);
+
+	if (filterData0.word1 & filterData1.word1 & GROUP_MASK)
+		pairFlags |= PxPairFlag::eMODIFY_CONTACTS;
+	return flags;
+}
+
+void 	ContactModifier::onContactModify( PxContactModifyPair* const pairs, PxU32 count )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (PxU32 p = 0; p < count; ++p)
+	{
+		PxContactModifyPair& pair = pairs[p];
+		const PxU32 shared = pair.shape[0]->getSimulationFilterData().word1
+			& pair.shape[1]->getSimulationFilterData().word1 & GROUP_MASK;
+		if (!_tableActive[shared])
+			continue; // group reset since the pair was filtered
+		const ContactTuning& t = _table[shared];
+
+		PxContactSet& contacts = pair.contacts;
+		const PxU32 n = contacts.size();
+		for (PxU32 i = 0; i < n; ++i)
+		{
+			contacts.setStaticFriction(i, t.staticFriction);
+			contacts.setDynamicFriction(i, t.dynamicFriction);
+			contacts.setRestitution(i, t.restitution);
+			contacts.setMaxImpulse(i, t.maxImpulse);
+		}
+	}
+
+	_pairs += count;
+	_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void 	ContactModifier::collectStats( unsigned& pairs, float& ms )
+{
+	pairs = _pairs.exchange(0);
+	ms = _nanoseconds.exchange(0) / 1e6f;
+}
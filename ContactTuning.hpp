@@ -0,0 +1,71 @@
+
+#ifndef __MCPLANE_CONTACTTUNING_HPP__
+# define __MCPLANE_CONTACTTUNING_HPP__
+
+# include <atomic>
+# include <cstdint>
+# include <PxPhysicsAPI.h>
+
+/// Contact parameters forced on the pairs of a tuning group.
+struct ContactTuning
+{
+	float 	staticFriction 		= 0.5f;
+	float 	dynamicFriction 	= 0.5f;
+	float 	restitution 		= 0.f;
+	float 	maxImpulse 			= PX_MAX_F32;  ///< per contact and step, lower it for soft contacts
+};
+
+///
+/// Contact modification for the pairs selected by simulation filter data.
+///
+/// Bits 0 to 7 of word1 are tuning groups: a pair is modified when both of
+/// its shapes share a group, with the parameters of the lowest shared
+/// active group. The filter shader only flags those pairs for modification,
+/// so the others cost nothing. Group parameters are resolved into a
+/// 256-entry table when they are set, which leaves one lookup and a
+/// branch-free loop over the contacts per pair in the callback.
+///
+/// setGroup() must not be called during simulate(). The time spent in the
+/// callback is accumulated from the simulation threads and read per step
+/// with collectStats().
+///
+class ContactModifier : public physx::PxContactModifyCallback
+{
+	public:
+		static const unsigned 		GROUP_COUNT = 8;
+		static const physx::PxU32 	GROUP_MASK = (1u << GROUP_COUNT) - 1;
+
+		ContactModifier( void );
+
+		void 	setGroup( unsigned group, const ContactTuning& tuning );
+		void 	resetGroup( unsigned group );
+		/// Same groups as other; the stats are not copied.
+		void 	copyGroups( const ContactModifier& other );
+
+		/// Set the tuning group bits of every shape of the actor (other filter data is kept).
+		static void 	setActorGroups( physx::PxRigidActor& actor, physx::PxU32 groupBits );
+
+		/// PxDefaultSimulationFilterShader, plus eMODIFY_CONTACTS for tuned pairs.
+		static physx::PxFilterFlags 	filterShader(
+				physx::PxFilterObjectAttributes attributes0, physx::PxFilterData filterData0,
+				physx::PxFilterObjectAttributes attributes1, physx::PxFilterData filterData1,
+				physx::PxPairFlags& pairFlags, const void* constantBlock, physx::PxU32 constantBlockSize );
+
+		void 	onContactModify( physx::PxContactModifyPair* const pairs, physx::PxU32 count ) override;
+
+		/// Pairs modified and time spent since the previous call.
+		void 	collectStats( unsigned& pairs, float& ms );
+
+	private:
+		void 	rebuildTable( void );
+
+		ContactTuning 	_groups[GROUP_COUNT];
+		bool 			_active[GROUP_COUNT];
+		ContactTuning 	_table[GROUP_MASK + 1];  ///< by shared group bits
+		bool 			_tableActive[GROUP_MASK + 1];
+
+		std::atomic<uint64_t> 	_nanoseconds;
+		std::atomic<unsigned> 	_pairs;
+};
+
+#endif // __MCPLANE_CONTACTTUNING_HPP__
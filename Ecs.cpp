@@ -0,0 +1,248 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include "Ecs.hpp"
+
+//// Component types ////
+
+static std::mutex 			gComponentMutex;
+static std::vector<size_t> 	gComponentSizes;
+
+unsigned 	ecs_detail::registerComponent( size_t size )
+{
+	std::lock_guard<std::mutex> lock(gComponentMutex);
+	if (gComponentSizes.size() >= MAX_COMPONENT_TYPES)
+	{
+		std::cout << "more than " << MAX_COMPONENT_TYPES << " component types!" << std::endl;
+		std::abort();
+	}
+	gComponentSizes.push_back(size);
+	return gComponentSizes.size() - 1;
+}
+
+size_t 		ecs_detail::componentSize( unsigned id )
+{
+	std::lock_guard<std::mutex> lock(gComponentMutex);
+	return gComponentSizes[id];
+}
+
+//// World ////
+
+Archetype& 	World::findArchetype( ComponentMask mask )
+{
+	for (std::unique_ptr<Archetype>& archetype : _archetypes)
+		if (archetype->mask == mask)
+			return *archetype;
+
+	Archetype* archetype = new Archetype();
+	archetype->mask = mask;
+	for (unsigned id = 0; id < MAX_COMPONENT_TYPES; ++id)
+	{
+		archetype->columnOf[id] = -1;
+		if (!(mask & (ComponentMask(1) << id)))
+			continue;
+
+		Archetype::Column column;
+		column.component = id;
+		column.size = ecs_detail::componentSize(id);
+		archetype->columnOf[id] = archetype->columns.size();
+		archetype->columns.push_back(column);
+	}
+	_archetypes.push_back(std::unique_ptr<Archetype>(archetype));
+	return *archetype;
+}
+
+EntityId 	World::allocateId( void )
+{
+	++_alive;
+	if (!_freeIds.empty())
+	{
+		EntityId entity = _freeIds.back();
+		_freeIds.pop_back();
+		return entity;
+	}
+	_records.push_back(Record());
+	return _records.size() - 1;
+}
+
+bool 	World::isAlive( EntityId entity ) const
+{
+	return entity < _records.size() && _records[entity].archetype;
+}
+
+uint32_t 	World::insertRow( Archetype& archetype, EntityId entity )
+{
+	const uint32_t row = archetype.entities.size();
+	archetype.entities.push_back(entity);
+	for (Archetype::Column& column : archetype.columns)
+		column.data.resize(column.data.size() + column.size);
+
+	_records[entity].archetype = &archetype;
+	_records[entity].row = row;
+	return row;
+}
+
+void 	World::removeRow( Archetype& archetype, uint32_t row )
+{
+	const uint32_t last = archetype.entities.size() - 1;
+	if (row != last)
+	{
+		// the last row fills the hole
+		const EntityId moved = archetype.entities[last];
+		archetype.entities[row] = moved;
+		for (Archetype::Column& column : archetype.columns)
+			memcpy(&column.data[row * column.size], &column.data[last * column.size], column.size);
+		_records[moved].row = row;
+	}
+	archetype.entities.pop_back();
+	for (Archetype::Column& column : archetype.columns)
+		column.data.resize(column.data.size() - column.size);
+}
+
+void 	World::moveTo( EntityId entity, ComponentMask mask )
+{
+	Archetype& from = *_records[entity].archetype;
+	const uint32_t fromRow = _records[entity].row;
+	Archetype& to = findArchetype(mask);
+	const uint32_t toRow = insertRow(to, entity);
+
+	// shared components follow, a new one starts zeroed until written
+	for (Archetype::Column& column : to.columns)
+	{
+		unsigned char* dst = &column.data[toRow * column.size];
+		const int src = from.columnOf[column.component];
+		if (src >= 0)
+			memcpy(dst, &from.columns[src].data[fromRow * column.size], column.size);
+		else
+			memset(dst, 0, column.size);
+	}
+	removeRow(from, fromRow);
+}
+
+void 	World::destroy( EntityId entity )
+{
+	if (!isAlive(entity))
+		return;
+	removeRow(*_records[entity].archetype, _records[entity].row);
+	_records[entity] = Record();
+	_freeIds.push_back(entity);
+	--_alive;
+}
+
+//// Scheduler ////
+
+SystemScheduler::~SystemScheduler( void )
+{
+	deinit();
+}
+
+bool 	SystemScheduler::init( unsigned threadCount )
+{
+	if (!_workers.empty())
+		return false; // already init
+
+	_quit = false;
+	for (unsigned i = 0; i < threadCount; ++i)
+		_workers.push_back(std::thread(&SystemScheduler::workerMain, this));
+	return true;
+}
+
+void 	SystemScheduler::deinit( void )
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_wakeUp.notify_all();
+	for (std::thread& worker : _workers)
+		worker.join();
+	_workers.clear();
+}
+
+void 	SystemScheduler::add( const char* name, const SystemAccess& access, const Run& run )
+{
+	System system;
+	system.name = name;
+	system.access = access;
+	system.run = run;
+
+	// after every earlier system it conflicts with
+	for (const System& other : _systems)
+		if (system.access.conflictsWith(other.access))
+			system.phase = std::max(system.phase, other.phase + 1);
+
+	if (system.phase >= _phases.size())
+		_phases.resize(system.phase + 1);
+	_phases[system.phase].push_back(_systems.size());
+	_systems.push_back(system);
+}
+
+void 	SystemScheduler::runSystem( unsigned system )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	_systems[system].run(*_world);
+	_systems[system].lastMs = std::chrono::duration<float, std::milli>(
+			std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void 	SystemScheduler::run( World& world )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	_world = &world;
+
+	for (const std::vector<unsigned>& phase : _phases)
+	{
+		if (phase.size() == 1 || _workers.empty())
+		{
+			for (unsigned system : phase)
+				runSystem(system);
+			continue;
+		}
+
+		// hand out all but the first, then help until the phase is done
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_queue.insert(_queue.end(), phase.begin() + 1, phase.end());
+			_pending = phase.size() - 1;
+		}
+		_wakeUp.notify_all();
+		runSystem(phase[0]);
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (!_queue.empty())
+		{
+			unsigned system = _queue.front();
+			_queue.pop_front();
+			lock.unlock();
+			runSystem(system);
+			lock.lock();
+			--_pending;
+		}
+		_phaseDone.wait(lock, [this] { return _pending == 0; });
+	}
+
+	_world = nullptr;
+	_lastRunMs = std::chrono::duration<float, std::milli>(
+			std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void 	SystemScheduler::workerMain( void )
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_wakeUp.wait(lock, [this] { return _quit || !_queue.empty(); });
+		if (_quit)
+			return;
+
+		unsigned system = _queue.front();
+		_queue.pop_front();
+		lock.unlock();
+		runSystem(system);
+		lock.lock();
+		if (--_pending == 0)
+			_phaseDone.notify_all();
+	}
+}
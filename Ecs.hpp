@@ -0,0 +1,314 @@
+
+#ifndef __MCPLANE_ECS_HPP__
+# define __MCPLANE_ECS_HPP__
+
+# include <deque>
+# include <mutex>
+# include <memory>
+# include <string>
+# include <thread>
+# include <vector>
+# include <cstdint>
+# include <cstring>
+# include <functional>
+# include <type_traits>
+# include <condition_variable>
+# include "HugePageAllocator.hpp"
+
+using EntityId = uint32_t;
+using ComponentMask = uint64_t;
+
+const EntityId 	INVALID_ENTITY = 0xffffffffu;
+const unsigned 	MAX_COMPONENT_TYPES = 64;
+
+//// Component types ////
+
+namespace ecs_detail
+{
+	unsigned 	registerComponent( size_t size );
+	size_t 		componentSize( unsigned id );
+
+	template<class T>
+	struct ComponentType
+	{
+		// components are plain data, moved between archetypes as bytes
+		static_assert(std::is_trivially_destructible<T>::value, "components must be plain data");
+
+		static unsigned 	id( void ) {
+			static const unsigned id = registerComponent(sizeof(T));
+			return id;
+		}
+	};
+}
+
+/// Index of a component type, assigned on first use (const or not).
+template<class C>
+unsigned 	componentId( void )
+{
+	return ecs_detail::ComponentType<typename std::remove_const<C>::type>::id();
+}
+
+template<class... C>
+ComponentMask 	componentMask( void )
+{
+	ComponentMask mask = 0;
+	int expand[] = { 0, (mask |= ComponentMask(1) << componentId<C>(), 0)... };
+	(void)expand;
+	return mask;
+}
+
+//// Storage ////
+
+///
+/// Every entity with exactly the same set of components, stored as one
+/// contiguous column per component. Rows are packed: removing one moves
+/// the last row into its place.
+///
+struct Archetype
+{
+	struct Column
+	{
+		unsigned 					component;
+		size_t 						size;
+		ArenaVector<unsigned char> 	data;  ///< big entity walks, worth huge pages
+	};
+
+	ComponentMask 			mask = 0;
+	std::vector<EntityId> 	entities;
+	std::vector<Column> 	columns;
+	int 					columnOf[MAX_COMPONENT_TYPES];  ///< by component id, -1 when absent
+
+	template<class C>
+	C* 		column( void ) {
+		const int c = columnOf[componentId<C>()];
+		return reinterpret_cast<C*>(columns[c].data.data());
+	}
+};
+
+///
+/// Archetype-based entity and component store.
+///
+/// Adding or removing a component moves the entity to the archetype of its
+/// new component set. Queries are typed: each<Transform, const PhysicsBody>
+/// visits every archetype holding both, column by column. A const component
+/// is read-only, which is what SystemScheduler relies on to run systems in
+/// parallel.
+///
+/// Structural changes (create, destroy, add, remove) must not happen during
+/// each() or while the scheduler runs.
+///
+class World
+{
+	public:
+		template<class... C>
+		EntityId 	create( const C&... components );
+		void 		destroy( EntityId entity );
+		bool 		isAlive( EntityId entity ) const;
+		size_t 		size( void ) const { return _alive; }
+
+		/// Add a component, or overwrite it when the entity already has one.
+		template<class C>
+		void 	add( EntityId entity, const C& component = C() );
+		template<class C>
+		void 	remove( EntityId entity );
+		/// nullptr when the entity does not have the component.
+		template<class C>
+		C* 		get( EntityId entity );
+		template<class C>
+		bool 	has( EntityId entity ) const;
+
+		/// Call f(EntityId, C&...) for every entity with all of C and none of exclude.
+		template<class... C, class F>
+		void 	each( F f, ComponentMask exclude = 0 );
+		/// Number of entities with all of C and none of exclude.
+		template<class... C>
+		size_t 	count( ComponentMask exclude = 0 ) const;
+
+	private:
+		struct Record
+		{
+			Archetype* 	archetype = nullptr;
+			uint32_t 	row = 0;
+		};
+
+		Archetype& 	findArchetype( ComponentMask mask );
+		EntityId 	allocateId( void );
+		uint32_t 	insertRow( Archetype& archetype, EntityId entity );
+		void 		removeRow( Archetype& archetype, uint32_t row );
+		void 		moveTo( EntityId entity, ComponentMask mask );
+
+		template<class... C, class F>
+		static void 	eachRow( Archetype& archetype, F& f, C*... columns );
+
+		std::vector<std::unique_ptr<Archetype>> 	_archetypes;
+		std::vector<Record> 						_records;  ///< by entity id
+		std::vector<EntityId> 						_freeIds;
+		size_t 										_alive = 0;
+};
+
+template<class... C>
+EntityId 	World::create( const C&... components )
+{
+	EntityId entity = allocateId();
+	Archetype& archetype = findArchetype(componentMask<C...>());
+	uint32_t row = insertRow(archetype, entity);
+
+	int expand[] = { 0, (archetype.column<C>()[row] = components, 0)... };
+	(void)expand;
+	return entity;
+}
+
+template<class C>
+void 	World::add( EntityId entity, const C& component )
+{
+	if (!isAlive(entity))
+		return;
+	const ComponentMask bit = ComponentMask(1) << componentId<C>();
+	if (!(_records[entity].archetype->mask & bit))
+		moveTo(entity, _records[entity].archetype->mask | bit);
+
+	const Record& r = _records[entity];
+	r.archetype->column<C>()[r.row] = component;
+}
+
+template<class C>
+void 	World::remove( EntityId entity )
+{
+	if (!isAlive(entity))
+		return;
+	const ComponentMask bit = ComponentMask(1) << componentId<C>();
+	if (_records[entity].archetype->mask & bit)
+		moveTo(entity, _records[entity].archetype->mask & ~bit);
+}
+
+template<class C>
+C* 		World::get( EntityId entity )
+{
+	if (!has<C>(entity))
+		return nullptr;
+	const Record& r = _records[entity];
+	return &r.archetype->column<C>()[r.row];
+}
+
+template<class C>
+bool 	World::has( EntityId entity ) const
+{
+	return isAlive(entity) && (_records[entity].archetype->mask & (ComponentMask(1) << componentId<C>()));
+}
+
+template<class... C, class F>
+void 	World::eachRow( Archetype& archetype, F& f, C*... columns )
+{
+	const size_t rows = archetype.entities.size();
+	const EntityId* entities = archetype.entities.data();
+	for (size_t row = 0; row < rows; ++row)
+		f(entities[row], columns[row]...);
+}
+
+template<class... C, class F>
+void 	World::each( F f, ComponentMask exclude )
+{
+	const ComponentMask mask = componentMask<C...>();
+	for (std::unique_ptr<Archetype>& archetype : _archetypes)
+	{
+		Archetype& a = *archetype;
+		if ((a.mask & mask) != mask || (a.mask & exclude) || a.entities.empty())
+			continue;
+		eachRow<C...>(a, f, a.column<C>()...);
+	}
+}
+
+template<class... C>
+size_t 	World::count( ComponentMask exclude ) const
+{
+	const ComponentMask mask = componentMask<C...>();
+	size_t n = 0;
+	for (const std::unique_ptr<Archetype>& archetype : _archetypes)
+		if ((archetype->mask & mask) == mask && !(archetype->mask & exclude))
+			n += archetype->entities.size();
+	return n;
+}
+
+//// Systems ////
+
+/// Components a system reads and writes.
+struct SystemAccess
+{
+	ComponentMask 	reads = 0;
+	ComponentMask 	writes = 0;
+
+	bool 	conflictsWith( const SystemAccess& other ) const {
+		return (writes & (other.reads | other.writes)) || (other.writes & reads);
+	}
+};
+
+/// accessOf<Transform, const PhysicsBody>(): writes Transform, reads PhysicsBody.
+template<class... C>
+SystemAccess 	accessOf( void )
+{
+	SystemAccess access;
+	int expand[] = { 0, ((std::is_const<C>::value? access.reads : access.writes)
+			|= ComponentMask(1) << componentId<C>(), 0)... };
+	(void)expand;
+	return access;
+}
+
+///
+/// Runs systems over a World, in parallel when their accesses allow it.
+///
+/// Systems are grouped into phases in the order they were added: a system
+/// goes to the phase after the last one holding a system it conflicts with
+/// (one writes a component the other reads or writes). The systems of a
+/// phase run at the same time, on the calling thread and the workers.
+///
+/// Outside of the world, a system must only touch what it owns (its own
+/// output buffer, counters...).
+///
+class SystemScheduler
+{
+	public:
+		using Run = std::function<void (World&)>;
+
+		~SystemScheduler( void );
+
+		bool 	init( unsigned threadCount );
+		void 	deinit( void );
+
+		void 	add( const char* name, const SystemAccess& access, const Run& run );
+		void 	run( World& world );
+
+		unsigned 		getSystemCount( void ) const { return _systems.size(); }
+		const char* 	getName( unsigned system ) const { return _systems[system].name.c_str(); }
+		unsigned 		getPhase( unsigned system ) const { return _systems[system].phase; }
+		float 			getLastMs( unsigned system ) const { return _systems[system].lastMs; }
+		unsigned 		getPhaseCount( void ) const { return _phases.size(); }
+		float 			getLastRunMs( void ) const { return _lastRunMs; }
+
+	private:
+		struct System
+		{
+			std::string 	name;
+			SystemAccess 	access;
+			Run 			run;
+			unsigned 		phase = 0;
+			float 			lastMs = 0.f;
+		};
+
+		void 	runSystem( unsigned system );
+		void 	workerMain( void );
+
+		std::vector<System> 				_systems;
+		std::vector<std::vector<unsigned>> 	_phases;
+		float 								_lastRunMs = 0.f;
+
+		std::vector<std::thread> 	_workers;
+		std::deque<unsigned> 		_queue;
+		unsigned 					_pending = 0;
+		World* 						_world = nullptr;
+		std::mutex 					_mutex;
+		std::condition_variable 	_wakeUp;
+		std::condition_variable 	_phaseDone;
+		bool 						_quit = false;
+};
+
+#endif // __MCPLANE_ECS_HPP__
@@ -0,0 +1,351 @@
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include "FrameCapture.hpp"
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+#define WRITE_BUFFER_SIZE 	(8 << 20)
+
+//// RGBA to I420 conversion ////
+//
+// Y = ((66R + 129G + 25B + 128) >> 8) + 16
+// U = ((-38R - 74G + 112B + 128) >> 8) + 128
+// V = ((112R - 94G - 18B + 128) >> 8) + 128
+//
+// Chroma is computed on the rounded average of each 2x2 block (vertical then
+// horizontal average, like _mm_avg_epu8) so both paths give identical output.
+
+static inline uint8_t 	avgU8( uint8_t a, uint8_t b ) { return (a + b + 1) >> 1; }
+
+static void 	convertRowsScalar( const uint8_t* row0, const uint8_t* row1, unsigned begin, unsigned end,
+		uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v )
+{
+	for (unsigned x = begin; x < end; x += 2)
+	{
+		const uint8_t* p[4] = { row0 + x * 4, row0 + x * 4 + 4, row1 + x * 4, row1 + x * 4 + 4 };
+		uint8_t* ys[4] = { y0 + x, y0 + x + 1, y1 + x, y1 + x + 1 };
+		for (int i = 0; i < 4; ++i)
+			*ys[i] = ((66 * p[i][0] + 129 * p[i][1] + 25 * p[i][2] + 128) >> 8) + 16;
+
+		int rgb[3];
+		for (int c = 0; c < 3; ++c)
+			rgb[c] = avgU8(avgU8(p[0][c], p[2][c]), avgU8(p[1][c], p[3][c]));
+		u[x / 2] = ((-38 * rgb[0] - 74 * rgb[1] + 112 * rgb[2] + 128) >> 8) + 128;
+		v[x / 2] = ((112 * rgb[0] - 94 * rgb[1] - 18 * rgb[2] + 128) >> 8) + 128;
+	}
+}
+
+#ifdef __SSE2__
+
+/// Weighted sum of R, G, B for 4 RGBA pixels, as 4 int32.
+static inline __m128i 	weightedSum4( __m128i px, __m128i coeffs )
+{
+	const __m128i zero = _mm_setzero_si128();
+	// (r*cr + g*cg, b*cb + a*0) for each pixel, then add the two halves
+	__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), coeffs);
+	__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), coeffs);
+	lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));
+	hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+	return _mm_unpacklo_epi64(_mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 3, 2, 0)),
+			_mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 2, 0)));
+}
+
+/// 8 pixels to 8 bytes of Y (or 4 averaged pixels twice to U/V).
+static inline __m128i 	toBytes( __m128i a, __m128i b, __m128i offset )
+{
+	const __m128i round = _mm_set1_epi32(128);
+	a = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(a, round), 8), offset);
+	b = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(b, round), 8), offset);
+	return _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_setzero_si128());
+}
+
+/// Average of the horizontal pixel pairs of two 4 pixel vectors: 4 pixels.
+static inline __m128i 	averagePairs( __m128i a, __m128i b )
+{
+	a = _mm_avg_epu8(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 3, 0, 1)));
+	b = _mm_avg_epu8(b, _mm_shuffle_epi32(b, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_unpacklo_epi64(_mm_shuffle_epi32(a, _MM_SHUFFLE(2, 0, 2, 0)),
+			_mm_shuffle_epi32(b, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+/// Convert two rows, 8 pixels at a time, returns the first unprocessed column.
+static unsigned 	convertRowsSSE2( const uint8_t* row0, const uint8_t* row1, unsigned width,
+		uint8_t* y0, uint8_t* y1, uint8_t* u, uint8_t* v )
+{
+	const __m128i yCoeffs = _mm_setr_epi16(66, 129, 25, 0, 66, 129, 25, 0);
+	const __m128i uCoeffs = _mm_setr_epi16(-38, -74, 112, 0, -38, -74, 112, 0);
+	const __m128i vCoeffs = _mm_setr_epi16(112, -94, -18, 0, 112, -94, -18, 0);
+	const __m128i yOffset = _mm_set1_epi32(16);
+	const __m128i uvOffset = _mm_set1_epi32(128);
+
+	unsigned x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		__m128i a0 = _mm_loadu_si128((const __m128i*)(row0 + x * 4));
+		__m128i b0 = _mm_loadu_si128((const __m128i*)(row0 + x * 4 + 16));
+		__m128i a1 = _mm_loadu_si128((const __m128i*)(row1 + x * 4));
+		__m128i b1 = _mm_loadu_si128((const __m128i*)(row1 + x * 4 + 16));
+
+		_mm_storel_epi64((__m128i*)(y0 + x), toBytes(weightedSum4(a0, yCoeffs), weightedSum4(b0, yCoeffs), yOffset));
+		_mm_storel_epi64((__m128i*)(y1 + x), toBytes(weightedSum4(a1, yCoeffs), weightedSum4(b1, yCoeffs), yOffset));
+
+		// 2x2 block averages: 4 chroma samples
+		__m128i avg = averagePairs(_mm_avg_epu8(a0, a1), _mm_avg_epu8(b0, b1));
+		__m128i uv = toBytes(weightedSum4(avg, uCoeffs), weightedSum4(avg, vCoeffs), uvOffset);
+		uint32_t uBytes = (uint32_t)_mm_cvtsi128_si32(uv);
+		uint32_t vBytes = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(uv, 4));
+		memcpy(u + x / 2, &uBytes, 4);
+		memcpy(v + x / 2, &vBytes, 4);
+	}
+	return x;
+}
+
+#endif // __SSE2__
+
+void 	convertRGBAToI420( const uint8_t* rgba, unsigned width, unsigned height,
+		uint8_t* yPlane, uint8_t* uPlane, uint8_t* vPlane )
+{
+	const size_t stride = width * 4;
+	for (unsigned y = 0; y < height; y += 2)
+	{
+		// GL rows are bottom-up
+		const uint8_t* row0 = rgba + (height - 1 - y) * stride;
+		const uint8_t* row1 = row0 - stride;
+		uint8_t* y0 = yPlane + y * width;
+		uint8_t* y1 = y0 + width;
+		uint8_t* u = uPlane + (y / 2) * (width / 2);
+		uint8_t* v = vPlane + (y / 2) * (width / 2);
+
+		unsigned x = 0;
+#ifdef __SSE2__
+		x = convertRowsSSE2(row0, row1, width, y0, y1, u, v);
+#endif
+		convertRowsScalar(row0, row1, x, width, y0, y1, u, v);
+	}
+}
+
+//// FrameCapture ////
+
+bool 	FrameCapture::start( const std::string& path, unsigned width, unsigned height, unsigned fps )
+{
+	if (_file)
+		return false; // already running
+
+	// 4:2:0 needs even dimensions, crop the last row/column if needed
+	_width = width & ~1u;
+	_height = height & ~1u;
+
+	_file = fopen(path.c_str(), "wb");
+	if (!_file)
+	{
+		std::cout << "unable to open capture file " << path << std::endl;
+		return false;
+	}
+	setvbuf(_file, nullptr, _IOFBF, WRITE_BUFFER_SIZE);
+	fprintf(_file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", _width, _height, fps);
+
+	const size_t rgbaSize = _width * _height * 4;
+	const size_t yuvSize = _width * _height * 3 / 2;
+
+	glGenBuffers(PBO_COUNT, _pbos);
+	for (unsigned i = 0; i < PBO_COUNT; ++i)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbos[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, rgbaSize, nullptr, GL_STREAM_READ);
+		_fences[i] = nullptr;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	_pboHead = 0;
+	_pboPending = 0;
+
+	for (unsigned i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		Frame* frame = new Frame();
+		frame->rgba.resize(rgbaSize);
+		frame->yuv.resize(yuvSize);
+		_frames.push_back(frame);
+		_free.push_back(frame);
+	}
+
+	_nextIndex = 0;
+	_nextToWrite = 0;
+	_written = 0;
+	_dropped = 0;
+	_stopping = false;
+
+	unsigned nbWorkers = std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+	for (unsigned i = 0; i < nbWorkers; ++i)
+		_workers.push_back(std::thread(&FrameCapture::workerLoop, this));
+	_writer = std::thread(&FrameCapture::writerLoop, this);
+
+	std::cout << "capturing " << _width << "x" << _height << " to " << path << std::endl;
+	return true;
+}
+
+void 	FrameCapture::stop( void )
+{
+	if (!_file)
+		return;
+
+	// flush the frames still being read back
+	collect(true);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_convertCond.notify_all();
+	_writeCond.notify_all();
+	for (std::thread& t : _workers)
+		t.join();
+	_workers.clear();
+	_writer.join();
+
+	glDeleteBuffers(PBO_COUNT, _pbos);
+	for (Frame* frame : _frames)
+		delete frame;
+	_frames.clear();
+	_free.clear();
+
+	fclose(_file);
+	_file = nullptr;
+
+	std::cout << "capture done: " << _written << " frames written, "
+		<< _dropped << " dropped" << std::endl;
+}
+
+void 	FrameCapture::capture( void )
+{
+	if (!_file)
+		return;
+
+	collect(false);
+
+	if (_pboPending == PBO_COUNT)
+	{
+		++_dropped;
+		return;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbos[_pboHead]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadPixels(0, 0, _width, _height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	_fences[_pboHead] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	_pboHead = (_pboHead + 1) % PBO_COUNT;
+	++_pboPending;
+}
+
+void 	FrameCapture::collect( bool wait )
+{
+	const size_t rgbaSize = _width * _height * 4;
+
+	while (_pboPending > 0)
+	{
+		unsigned oldest = (_pboHead + PBO_COUNT - _pboPending) % PBO_COUNT;
+
+		GLenum status = glClientWaitSync(_fences[oldest], GL_SYNC_FLUSH_COMMANDS_BIT,
+				wait? GL_TIMEOUT_IGNORED : 0);
+		if (status == GL_TIMEOUT_EXPIRED)
+			break; // not ready yet, try again next frame
+
+		glDeleteSync(_fences[oldest]);
+		_fences[oldest] = nullptr;
+		--_pboPending;
+
+		Frame* frame = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (!_free.empty())
+			{
+				frame = _free.back();
+				_free.pop_back();
+			}
+		}
+		if (!frame)
+		{
+			++_dropped; // converters or writer are behind
+			continue;
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, _pbos[oldest]);
+		const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rgbaSize, GL_MAP_READ_BIT);
+		if (pixels)
+		{
+			memcpy(frame->rgba.data(), pixels, rgbaSize);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!pixels)
+		{
+			_free.push_back(frame);
+			++_dropped;
+			continue;
+		}
+		frame->index = _nextIndex++;
+		_toConvert.push_back(frame);
+		_convertCond.notify_one();
+	}
+}
+
+void 	FrameCapture::workerLoop( void )
+{
+	const size_t lumaSize = _width * _height;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_convertCond.wait(lock, [this]{ return _stopping || !_toConvert.empty(); });
+		if (_toConvert.empty())
+			break; // stopping and nothing left
+
+		Frame* frame = _toConvert.front();
+		_toConvert.pop_front();
+		++_converting;
+		lock.unlock();
+
+		uint8_t* yPlane = frame->yuv.data();
+		convertRGBAToI420(frame->rgba.data(), _width, _height,
+				yPlane, yPlane + lumaSize, yPlane + lumaSize + lumaSize / 4);
+
+		lock.lock();
+		--_converting;
+		_toWrite[frame->index] = frame;
+		_writeCond.notify_one();
+	}
+	_writeCond.notify_one();
+}
+
+void 	FrameCapture::writerLoop( void )
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_writeCond.wait(lock, [this]{
+				return _toWrite.count(_nextToWrite)
+					|| (_stopping && _toConvert.empty() && _converting == 0); });
+
+		auto it = _toWrite.find(_nextToWrite);
+		if (it == _toWrite.end())
+			break; // stopping and everything was written
+
+		Frame* frame = it->second;
+		_toWrite.erase(it);
+		lock.unlock();
+
+		fwrite("FRAME\n", 1, 6, _file);
+		fwrite(frame->yuv.data(), 1, frame->yuv.size(), _file);
+
+		lock.lock();
+		_free.push_back(frame);
+		++_nextToWrite;
+		++_written;
+	}
+}
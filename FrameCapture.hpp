@@ -0,0 +1,92 @@
+
+#ifndef __MCPLANE_FRAMECAPTURE_HPP__
+# define __MCPLANE_FRAMECAPTURE_HPP__
+
+# include <cstdio>
+# include <cstdint>
+# include <string>
+# include <vector>
+# include <deque>
+# include <map>
+# include <atomic>
+# include <thread>
+# include <mutex>
+# include <condition_variable>
+# include "Graphics.hpp"
+
+///
+/// Continuous capture of the viewport to a Y4M (raw YUV 4:2:0) stream.
+///
+/// The pipeline never stalls the render loop:
+///  - pixels are read back asynchronously into a ring of PBOs and mapped a
+///    couple of frames later, once their fence is signaled,
+///  - RGB to YUV conversion (SSE2 when available) runs on worker threads,
+///  - a writer thread puts frames back in order and writes them through a
+///    large stdio buffer.
+/// When every buffer is busy the frame is dropped (and counted) instead.
+///
+/// start(), capture() and stop() must be called on the thread owning the GL
+/// context.
+///
+class FrameCapture
+{
+	public:
+		bool 	start( const std::string& path, unsigned width, unsigned height, unsigned fps );
+		void 	stop( void );
+		bool 	isRunning( void ) const { return _file != nullptr; }
+
+		/// Queue the read back of the current back buffer, call before swapping.
+		void 	capture( void );
+
+		unsigned 	getCapturedCount( void ) const { return _written; }
+		unsigned 	getDroppedCount( void ) const { return _dropped; }
+
+	private:
+		static const unsigned 	PBO_COUNT = 3;
+		static const unsigned 	MAX_FRAMES_IN_FLIGHT = 8;
+
+		struct Frame
+		{
+			uint64_t 				index = 0;
+			std::vector<uint8_t> 	rgba;
+			std::vector<uint8_t> 	yuv;
+		};
+
+		void 	collect( bool wait );
+		void 	workerLoop( void );
+		void 	writerLoop( void );
+
+		FILE* 			_file = nullptr;
+		unsigned 		_width = 0;
+		unsigned 		_height = 0;
+
+		GLuint 			_pbos[PBO_COUNT] = {};
+		GLsync 			_fences[PBO_COUNT] = {};
+		unsigned 		_pboHead = 0;  ///< next PBO to read into
+		unsigned 		_pboPending = 0;
+
+		uint64_t 		_nextIndex = 0;    ///< index given to the next converted frame
+		uint64_t 		_nextToWrite = 0;
+		std::atomic<unsigned> 	_written{0}; ///< updated by the writer thread
+		unsigned 		_dropped = 0;
+
+		std::vector<Frame*> 			_frames;  ///< owns every frame
+		std::vector<Frame*> 			_free;
+		std::deque<Frame*> 				_toConvert;
+		std::map<uint64_t, Frame*> 		_toWrite;  ///< converted, waiting for their turn
+
+		std::vector<std::thread> 		_workers;
+		std::thread 					_writer;
+		std::mutex 						_mutex;
+		std::condition_variable 		_convertCond;
+		std::condition_variable 		_writeCond;
+		bool 							_stopping = false;
+		unsigned 						_converting = 0;
+};
+
+/// Convert a bottom-up RGBA image to top-down planar I420 (BT.601, limited range).
+/// width and height must be even.
+void 	convertRGBAToI420( const uint8_t* rgba, unsigned width, unsigned height,
+		uint8_t* yPlane, uint8_t* uPlane, uint8_t* vPlane );
+
+#endif // __MCPLANE_FRAMECAPTURE_HPP__
@@ -0,0 +1,95 @@
+
+#include "GlDebug.hpp"
+
+#ifdef MCPLANE_GL_DEBUG
+
+#include <iostream>
+#include <SDL2/SDL.h>
+
+static bool 	gHasDebugOutput = false;
+
+static const char* 	sourceName( GLenum source )
+{
+	switch (source)
+	{
+		case GL_DEBUG_SOURCE_API: return "api";
+		case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "window system";
+		case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+		case GL_DEBUG_SOURCE_THIRD_PARTY: return "third party";
+		case GL_DEBUG_SOURCE_APPLICATION: return "application";
+		default: return "other";
+	}
+}
+
+static const char* 	typeName( GLenum type )
+{
+	switch (type)
+	{
+		case GL_DEBUG_TYPE_ERROR: return "error";
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "undefined behavior";
+		case GL_DEBUG_TYPE_PORTABILITY: return "portability";
+		case GL_DEBUG_TYPE_PERFORMANCE: return "performance";
+		default: return "other";
+	}
+}
+
+static const char* 	severityName( GLenum severity )
+{
+	switch (severity)
+	{
+		case GL_DEBUG_SEVERITY_HIGH: return "high";
+		case GL_DEBUG_SEVERITY_MEDIUM: return "medium";
+		case GL_DEBUG_SEVERITY_LOW: return "low";
+		default: return "notification";
+	}
+}
+
+/// May be called from a driver thread: the output is asynchronous.
+static void APIENTRY 	onDebugMessage( GLenum source, GLenum type, GLuint id, GLenum severity,
+		GLsizei length, const GLchar* message, const void* userParam )
+{
+	(void)length;
+	(void)userParam;
+	std::cout << "GL " << severityName(severity) << " " << typeName(type)
+		<< " (" << sourceName(source) << ", " << id << "): " << message << std::endl;
+}
+
+void 	glDebugRequestContext( void )
+{
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+}
+
+bool 	glDebugInit( void )
+{
+	gHasDebugOutput = GLEW_VERSION_4_3 || GLEW_KHR_debug;
+	if (!gHasDebugOutput)
+	{
+		std::cout << "no KHR_debug, GL errors won't be reported" << std::endl;
+		return false;
+	}
+
+	glEnable(GL_DEBUG_OUTPUT);
+	glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageCallback(onDebugMessage, nullptr);
+	// notifications are chatty (buffer placement...), keep the rest
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+	// our own group markers are echoed as messages too
+	glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+	glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+	return true;
+}
+
+GlDebugGroup::GlDebugGroup( const char* name )
+{
+	if (gHasDebugOutput)
+		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+}
+
+GlDebugGroup::~GlDebugGroup( void )
+{
+	if (gHasDebugOutput)
+		glPopDebugGroup();
+}
+
+#endif // MCPLANE_GL_DEBUG
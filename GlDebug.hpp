@@ -0,0 +1,54 @@
+
+#ifndef __MCPLANE_GLDEBUG_HPP__
+# define __MCPLANE_GLDEBUG_HPP__
+
+# define GLEW_STATIC
+# include <GL/glew.h>
+
+///
+/// GL debug layer, built only without NDEBUG (like assert).
+///
+/// Errors are reported by the driver through a KHR_debug callback instead
+/// of glGetError() polling, which waits for the GL pipeline. Debug groups
+/// name the parts of a frame (clear, draw, refresh...) in external frame
+/// debuggers such as RenderDoc or apitrace.
+///
+/// In release builds every call below compiles to nothing.
+///
+
+# ifndef NDEBUG
+
+#  define MCPLANE_GL_DEBUG 1
+
+/// SDL attributes for a debug context, before the window is created.
+void 	glDebugRequestContext( void );
+/// Install the message callback on the current context, false when the
+/// driver has no KHR_debug (the groups then do nothing).
+bool 	glDebugInit( void );
+
+/// Debug group for the lifetime of the scope.
+class GlDebugGroup
+{
+	public:
+		explicit 	GlDebugGroup( const char* name );
+		~GlDebugGroup( void );
+
+	private:
+		GlDebugGroup( const GlDebugGroup& ) = delete;
+		GlDebugGroup& 	operator=( const GlDebugGroup& ) = delete;
+};
+
+#  define GL_DEBUG_GROUP_CONCAT2(a, b) 	a##b
+#  define GL_DEBUG_GROUP_CONCAT(a, b) 	GL_DEBUG_GROUP_CONCAT2(a, b)
+#  define GL_DEBUG_GROUP(name) 			GlDebugGroup GL_DEBUG_GROUP_CONCAT(glDebugGroup, __LINE__)(name)
+
+# else
+
+inline void 	glDebugRequestContext( void ) {}
+inline bool 	glDebugInit( void ) { return true; }
+
+#  define GL_DEBUG_GROUP(name)
+
+# endif
+
+#endif // __MCPLANE_GLDEBUG_HPP__
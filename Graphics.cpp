@@ -1,60 +1,14 @@
 
 #include <iostream>
-#include <cassert>
+#include <cmath>
+#include <cstddef>
 #include "Graphics.hpp"
+#include "GlDebug.hpp"
 
 #define SHADER_ATTRIB_OUT 		"OutColor"
 #define SHADER_ATTRIB_POSITION 	"Position"
 #define SHADER_ATTRIB_NORMAL 	"Normal"
 
-const char* vertexShader = R"str(
-#version 330 core
-
-uniform mat4 proj;
-uniform mat4 view;
-uniform mat4 model;
-
-layout (location = 0) in vec3 Position;
-layout (location = 1) in vec3 Normal;
-
-out VS_OUT
-{
-	float light;
-} vs_out;
-
-void main() {
-	// direction of the sun
-	vec3 sunDir = normalize(vec3(0.5, 1, 0.25));
-
-	mat4 rot = model;
-	rot[3][0] = 0;
-	rot[3][1] = 0;
-	rot[3][2] = 0;
-	vec3 N = normalize((rot*vec4(Normal, 1.0)).xyz);
-	vs_out.light = max(dot(N, sunDir), 0.0);
-	gl_Position = proj * view * model * vec4(Position, 1.0);
-}
-
-)str";
-
-const char* fragShader = R"str(
-#version 330 core
-
-uniform vec3 color;
-
-layout (location = 0) out vec4 OutColor;
-
-in VS_OUT
-{
-	float light;
-} fs_in;
-
-void main() {
-	OutColor = vec4(color * fs_in.light, 1.0);
-}
-
-)str";
-
 bool 	loadShader( GLuint shaderId, const char* src, std::string& outputlog )
 {
 	char buffer[512];
@@ -71,8 +25,43 @@ bool 	loadShader( GLuint shaderId, const char* src, std::string& outputlog )
 	return (status == GL_TRUE);
 }
 
+bool 	buildProgram( const char* vertSrc, const char* fragSrc, GLuint& vertId, GLuint& fragId, GLuint& programId )
+{
+	fragId = glCreateShader(GL_FRAGMENT_SHADER);
+	vertId = glCreateShader(GL_VERTEX_SHADER);
+	programId = glCreateProgram();
+
+	std::string outputlog;
+	if (loadShader(vertId, vertSrc, outputlog) == false
+			|| loadShader(fragId, fragSrc, outputlog) == false)
+	{
+		std::cout << "error while compiling shaders: \n" << outputlog << std::endl;
+		return false;
+	}
+
+	glAttachShader(programId, vertId);
+	glAttachShader(programId, fragId);
+
+	glBindFragDataLocation(programId, 0, SHADER_ATTRIB_OUT);
+	glBindAttribLocation(programId, 0, SHADER_ATTRIB_POSITION);
+
+	glLinkProgram(programId);
+
+	GLint programSuccess = GL_TRUE;
+	glGetProgramiv(programId, GL_LINK_STATUS, &programSuccess);
+	if ( programSuccess != GL_TRUE)
+	{
+		std::cout << "failed to link shader program";
+		return false;
+	}
+	return true;
+}
+
 bool 	Graphics::init( unsigned width, unsigned height )
 {
+	_width = width;
+	_height = height;
+
 	// Use OpenGL 3.1 core
 	SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
 	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 3 );
@@ -86,6 +75,9 @@ bool 	Graphics::init( unsigned width, unsigned height )
 	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
 	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
 
+	// Debug builds report GL errors through KHR_debug
+	glDebugRequestContext();
+
 	// Create window
 	_win.reset(
 			SDL_CreateWindow( "mctest", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
@@ -109,8 +101,6 @@ bool 	Graphics::init( unsigned width, unsigned height )
 	if( SDL_GL_SetSwapInterval(1) < 0 )
 		std::cout << "unable to set VSync! SDL Error: " << SDL_GetError();
 
-	assert(glGetError() == GL_NO_ERROR);
-
 	std::cout << "Opengl Version: " << glGetString(GL_VERSION) << std::endl;
 	std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
 
@@ -124,46 +114,11 @@ bool 	Graphics::init( unsigned width, unsigned height )
 	//https://www.opengl.org/wiki/OpenGL_Loading_Library
 	glGetError();
 
+	glDebugInit();
 
 	//Load shaders
-	_fragId = glCreateShader(GL_FRAGMENT_SHADER);
-	_vertId = glCreateShader(GL_VERTEX_SHADER);
-	_programId = glCreateProgram();
-
-	std::string outputlog;
-	if (loadShader(_vertId, vertexShader, outputlog) == false
-			|| loadShader(_fragId, fragShader, outputlog) == false)
-	{
-		std::cout << "error while compiling shaders: \n" << outputlog << std::endl;
-		return false;
-	}
-
-	glAttachShader(_programId, _vertId);
-	glAttachShader(_programId, _fragId);
-
-	
-	glBindFragDataLocation(_programId, 0, SHADER_ATTRIB_OUT);
-	glBindAttribLocation(_programId, 0, SHADER_ATTRIB_POSITION);
-	glBindAttribLocation(_programId, 1, SHADER_ATTRIB_NORMAL);
-
-	glLinkProgram(_programId);
-
-	assert(glGetError() == GL_NO_ERROR);
-
-	GLint programSuccess = GL_TRUE;
-	glGetProgramiv(_programId, GL_LINK_STATUS, &programSuccess);
-	if ( programSuccess != GL_TRUE)
-	{
-		std::cout << "failed to link shader program";
+	if (_shaders.init() == false)
 		return false;
-	}
-
-	glUseProgram(_programId);
-
-	_unifProj = glGetUniformLocation(_programId, "proj");
-	_unifView = glGetUniformLocation(_programId, "view");
-	_unifModel = glGetUniformLocation(_programId, "model");
-	_unifColor = glGetUniformLocation(_programId, "color");
 
 	// Generate a Box
 	glGenVertexArrays(1, &_boxVAO);
@@ -229,11 +184,38 @@ bool 	Graphics::init( unsigned width, unsigned height )
 	glEnableVertexAttribArray(1/*SHADER_ATTRIB_NORMAL*/);
 	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
 
+	// Per-instance model matrix (4 columns) and color, filled by drawBoxes()
+	glGenBuffers(1, &_boxInstanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, _boxInstanceVBO);
+	for (GLuint i = 0; i < 4; ++i)
+	{
+		glEnableVertexAttribArray(2 + i);
+		glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(BoxInstance),
+				(void*)(offsetof(BoxInstance, model) + i * sizeof(vec4)));
+		glVertexAttribDivisor(2 + i, 1);
+	}
+	glEnableVertexAttribArray(6);
+	glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, sizeof(BoxInstance), (void*)offsetof(BoxInstance, color));
+	glVertexAttribDivisor(6, 1);
+
+	initCapsuleResources();
+
+	// Debug lines: two vertices (position, color) per line
+	glGenVertexArrays(1, &_lineVAO);
+	glBindVertexArray(_lineVAO);
+	glGenBuffers(1, &_lineVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, _lineVBO);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), 0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+
+	glBindVertexArray(0);
+
 	// Application Settings
-	mat4 	_proj = perspective( 3.14f/3.f, (float)width/(float)height, 0.1f, 1000.f);
-	mat4 	_view = lookAt(vec3(5, 6, 5)*3.f, vec3(0.f, 0.f, -30.f), vec3(0.f, 1.f, 0.f));
-	glUniform(_unifProj, _proj);
-	glUniform(_unifView, _view);
+	_proj = perspective( 3.14f/3.f, (float)width/(float)height, 0.1f, 1000.f);
+	_view = lookAt(vec3(5, 6, 5)*3.f, vec3(0.f, 0.f, -30.f), vec3(0.f, 1.f, 0.f));
 
 	glDepthMask( GL_TRUE );
 	glDepthFunc( GL_LESS );
@@ -244,30 +226,345 @@ bool 	Graphics::init( unsigned width, unsigned height )
 
 void 	Graphics::deinit( void )
 {
-	if (_fragId) glDeleteShader(_fragId);
-	if (_vertId) glDeleteShader(_vertId);
-	if (_programId) glDeleteProgram(_programId);
+	_shaders.deinit();
+	deinitTerrainResources();
 	glDeleteBuffers(1, &_boxVBO);
+	glDeleteBuffers(1, &_boxInstanceVBO);
 	glDeleteVertexArrays(1, &_boxVAO);
+	glDeleteBuffers(1, &_capsuleVBO);
+	glDeleteBuffers(1, &_capsuleIBO);
+	glDeleteBuffers(1, &_capsuleInstanceVBO);
+	glDeleteVertexArrays(1, &_capsuleVAO);
+	glDeleteBuffers(1, &_lineVBO);
+	glDeleteVertexArrays(1, &_lineVAO);
+	SDL_GL_DeleteContext(_context);
+	_context = nullptr;
 	_win.reset();
 }
 
+bool 	Graphics::makeCurrent( void )
+{
+	if (SDL_GL_MakeCurrent(_win.get(), _context) < 0)
+	{
+		std::cout << "unable to make GL context current! SDL Error: " << SDL_GetError() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void 	Graphics::releaseCurrent( void )
+{
+	SDL_GL_MakeCurrent(_win.get(), nullptr);
+}
+
 void 	Graphics::clear( void )
 {
+	GL_DEBUG_GROUP("clear");
 	const GLfloat  clearColor = 0.7f;
 	glClearColor(clearColor, clearColor, clearColor, 0.f);
 	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 }
 
-void 	Graphics::drawBox( const mat4& model, const Color& color )
+void 	Graphics::drawFrame( const FramePacket& packet )
+{
+	GL_DEBUG_GROUP("draw");
+	_view = packet.view;
+	_surfaceFeatures = packet.debugNormals? SHADER_DEBUG_NORMALS : SHADER_LIT;
+	drawTerrain(packet.terrain);
+	drawBoxes(packet.boxes);
+	drawCapsules(packet.capsules);
+	drawLines(packet.lines);
+}
+
+void 	Graphics::drawBoxes( const BoxInstances& boxes )
+{
+	GL_DEBUG_GROUP("boxes");
+	if (boxes.empty())
+		return;
+
+	const ShaderProgram& shader = _shaders.get(SHADER_BOX, _surfaceFeatures);
+	glUseProgram(shader.program);
+	glUniform(shader.proj, _proj);
+	glUniform(shader.view, _view);
+
+	// Orphan the instance buffer when it grows, then stream this frame's data
+	glBindBuffer(GL_ARRAY_BUFFER, _boxInstanceVBO);
+	if (boxes.size() > _boxInstanceCapacity)
+	{
+		_boxInstanceCapacity = boxes.size() * 2;
+		glBufferData(GL_ARRAY_BUFFER, _boxInstanceCapacity * sizeof(BoxInstance), nullptr, GL_STREAM_DRAW);
+	}
+	glBufferSubData(GL_ARRAY_BUFFER, 0, boxes.size() * sizeof(BoxInstance), boxes.data());
+
+	glBindVertexArray(_boxVAO);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 36, boxes.size());
+}
+
+void 	Graphics::initCapsuleResources( void )
+{
+	// Unit sphere split at the equator: the vertex shader pushes each
+	// hemisphere away from the center, which stretches the equator band
+	// into the cylinder.
+	const int slices = 16;
+	const int stacks = 6; // per hemisphere
+
+	std::vector<GLfloat> 	vertices; // position, side
+	std::vector<GLuint> 	indices;
+	for (int side = 1; side >= -1; side -= 2)
+	{
+		for (int stack = 0; stack <= stacks; ++stack)
+		{
+			float lat = side * (stack * 3.14159265f * 0.5f / stacks);
+			for (int slice = 0; slice <= slices; ++slice)
+			{
+				float lon = slice * 2.f * 3.14159265f / slices;
+				vertices.push_back(std::cos(lat) * std::cos(lon));
+				vertices.push_back(std::sin(lat));
+				vertices.push_back(std::cos(lat) * std::sin(lon));
+				vertices.push_back((GLfloat)side);
+			}
+		}
+	}
+
+	const GLuint ring = slices + 1;
+	const GLuint bottom = (stacks + 1) * ring;
+	auto band = [&]( GLuint lower, GLuint upper ) {
+		for (GLuint i = 0; i < (GLuint)slices; ++i)
+		{
+			GLuint quad[6] = { lower + i, upper + i, lower + i + 1, lower + i + 1, upper + i, upper + i + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	};
+	for (GLuint stack = 0; stack < (GLuint)stacks; ++stack)
+	{
+		band(stack * ring, (stack + 1) * ring);                    // top, equator upward
+		band(bottom + (stack + 1) * ring, bottom + stack * ring);  // bottom, pole upward
+	}
+	band(bottom, 0); // cylinder between both equators
+	_capsuleIndexCount = indices.size();
+
+	glGenVertexArrays(1, &_capsuleVAO);
+	glBindVertexArray(_capsuleVAO);
+
+	glGenBuffers(1, &_capsuleVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, _capsuleVBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+
+	glGenBuffers(1, &_capsuleIBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _capsuleIBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+	// Per-instance (center, radius), half height and color, filled by drawCapsules()
+	glGenBuffers(1, &_capsuleInstanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, _capsuleInstanceVBO);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(CapsuleInstance), (void*)offsetof(CapsuleInstance, position));
+	glVertexAttribDivisor(2, 1);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(CapsuleInstance), (void*)offsetof(CapsuleInstance, halfHeight));
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(CapsuleInstance), (void*)offsetof(CapsuleInstance, color));
+	glVertexAttribDivisor(4, 1);
+
+	glBindVertexArray(0);
+}
+
+void 	Graphics::drawCapsules( const CapsuleInstances& capsules )
+{
+	GL_DEBUG_GROUP("capsules");
+	if (capsules.empty())
+		return;
+
+	const ShaderProgram& shader = _shaders.get(SHADER_CAPSULE, _surfaceFeatures);
+	glUseProgram(shader.program);
+	glUniform(shader.proj, _proj);
+	glUniform(shader.view, _view);
+
+	glBindBuffer(GL_ARRAY_BUFFER, _capsuleInstanceVBO);
+	if (capsules.size() > _capsuleInstanceCapacity)
+	{
+		_capsuleInstanceCapacity = capsules.size() * 2;
+		glBufferData(GL_ARRAY_BUFFER, _capsuleInstanceCapacity * sizeof(CapsuleInstance), nullptr, GL_STREAM_DRAW);
+	}
+	glBufferSubData(GL_ARRAY_BUFFER, 0, capsules.size() * sizeof(CapsuleInstance), capsules.data());
+
+	glBindVertexArray(_capsuleVAO);
+	glDrawElementsInstanced(GL_TRIANGLES, _capsuleIndexCount, GL_UNSIGNED_INT, 0, capsules.size());
+}
+
+void 	Graphics::drawLines( const std::vector<DebugLine>& lines )
+{
+	GL_DEBUG_GROUP("lines");
+	if (lines.empty())
+		return;
+
+	const ShaderProgram& shader = _shaders.get<SHADER_LINE, 0>();
+	glUseProgram(shader.program);
+	glUniform(shader.proj, _proj);
+	glUniform(shader.view, _view);
+
+	// interleave (position, color) for both ends of every line
+	std::vector<GLfloat>& 	vertices = _lineVertices;
+	vertices.clear();
+	for (const DebugLine& l : lines)
+	{
+		const vec3* pts[2] = { &l.from, &l.to };
+		for (const vec3* p : pts)
+		{
+			vertices.push_back(p->x);
+			vertices.push_back(p->y);
+			vertices.push_back(p->z);
+			vertices.push_back(l.color.x);
+			vertices.push_back(l.color.y);
+			vertices.push_back(l.color.z);
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, _lineVBO);
+	if (lines.size() > _lineCapacity)
+	{
+		_lineCapacity = lines.size() * 2;
+		glBufferData(GL_ARRAY_BUFFER, _lineCapacity * 12 * sizeof(GLfloat), nullptr, GL_STREAM_DRAW);
+	}
+	glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(GLfloat), vertices.data());
+
+	glBindVertexArray(_lineVAO);
+	glDrawArrays(GL_LINES, 0, lines.size() * 2);
+}
+
+bool 	Graphics::initTerrainResources( const TerrainRenderData& terrain )
 {
-	glUniform(_unifModel, model);
-	glUniform(_unifColor, color);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
+	deinitTerrainResources();
+
+	const unsigned n = terrain.samplesPerSide;
+	if (n < 2 || terrain.maxTiles == 0)
+		return false;
+
+	// Grid shared by every patch: one vertex per sample, two triangles per cell
+	std::vector<GLfloat> 	grid;
+	std::vector<GLuint> 	indices;
+	grid.reserve(n * n * 2);
+	for (unsigned row = 0; row < n; ++row)
+		for (unsigned col = 0; col < n; ++col)
+		{
+			grid.push_back((GLfloat)row);
+			grid.push_back((GLfloat)col);
+		}
+	indices.reserve((n - 1) * (n - 1) * 6);
+	for (unsigned row = 0; row + 1 < n; ++row)
+		for (unsigned col = 0; col + 1 < n; ++col)
+		{
+			GLuint i = row * n + col;
+			GLuint quad[6] = { i, i + 1, i + n, i + 1, i + n + 1, i + n };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	_terrainIndexCount = indices.size();
+
+	glGenVertexArrays(1, &_terrainVAO);
+	glBindVertexArray(_terrainVAO);
+
+	glGenBuffers(1, &_terrainVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, _terrainVBO);
+	glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(GLfloat), grid.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), 0);
+
+	glGenBuffers(1, &_terrainIBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _terrainIBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &_terrainInstanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, _terrainInstanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, terrain.maxTiles * 3 * sizeof(GLfloat), nullptr, GL_STREAM_DRAW);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), 0);
+	glVertexAttribDivisor(1, 1);
+
+	glBindVertexArray(0);
+
+	glGenTextures(1, &_terrainHeights);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _terrainHeights);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, n, n, terrain.maxTiles, 0, GL_RED, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+
+	_terrainSamples = n;
+	_terrainMaxTiles = terrain.maxTiles;
+	_terrainSlotIds.assign(terrain.maxTiles, 0);
+	return true;
+}
+
+void 	Graphics::deinitTerrainResources( void )
+{
+	if (_terrainVAO == 0)
+		return;
+
+	glDeleteBuffers(1, &_terrainVBO);
+	glDeleteBuffers(1, &_terrainIBO);
+	glDeleteBuffers(1, &_terrainInstanceVBO);
+	glDeleteVertexArrays(1, &_terrainVAO);
+	glDeleteTextures(1, &_terrainHeights);
+	_terrainVAO = _terrainVBO = _terrainIBO = _terrainInstanceVBO = _terrainHeights = 0;
+	_terrainSamples = 0;
+	_terrainMaxTiles = 0;
+	_terrainSlotIds.clear();
+}
+
+void 	Graphics::drawTerrain( const TerrainRenderData& terrain )
+{
+	GL_DEBUG_GROUP("terrain");
+	if (terrain.patches.empty())
+		return;
+
+	if (terrain.samplesPerSide != _terrainSamples || terrain.maxTiles != _terrainMaxTiles)
+		if (initTerrainResources(terrain) == false)
+			return;
+
+	// Upload the heights of the tiles that moved into a slot since last frame
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, _terrainHeights);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	_terrainInstances.clear();
+	for (const TerrainPatch& patch : terrain.patches)
+	{
+		if (patch.slot >= _terrainMaxTiles || !patch.heights)
+			continue;
+
+		if (_terrainSlotIds[patch.slot] != patch.id)
+		{
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, patch.slot, _terrainSamples, _terrainSamples, 1,
+					GL_RED, GL_FLOAT, patch.heights->data());
+			_terrainSlotIds[patch.slot] = patch.id;
+		}
+
+		_terrainInstances.push_back(patch.origin.x);
+		_terrainInstances.push_back(patch.origin.y);
+		_terrainInstances.push_back((GLfloat)patch.slot);
+	}
+
+	const ShaderProgram& shader = _shaders.get(SHADER_TERRAIN, _surfaceFeatures);
+	glUseProgram(shader.program);
+	glUniform(shader.proj, _proj);
+	glUniform(shader.view, _view);
+	glUniform(shader.cellSize, terrain.cellSize);
+	glUniform(shader.samples, (GLint)_terrainSamples);
+	glUniform(shader.heights, (GLint)0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, _terrainInstanceVBO);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, _terrainInstances.size() * sizeof(GLfloat), _terrainInstances.data());
+
+	glBindVertexArray(_terrainVAO);
+	glDrawElementsInstanced(GL_TRIANGLES, _terrainIndexCount, GL_UNSIGNED_INT, 0, _terrainInstances.size() / 3);
 }
 
 void 	Graphics::refresh( void )
 {
+	GL_DEBUG_GROUP("refresh");
 	SDL_GL_SwapWindow(_win.get());
 }
-
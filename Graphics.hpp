@@ -4,6 +4,7 @@
 
 # define GLEW_STATIC
 # include <memory>
+# include <vector>
 # include <GL/glew.h>
 # include <SDL2/SDL_opengl.h>
 # include <GL/glu.h>
@@ -14,6 +15,8 @@
 # include <glm/gtc/matrix_transform.hpp>	
 # include <glm/glm.hpp>
 # include <SDL2/SDL.h>
+# include "HugePageAllocator.hpp"
+# include "ShaderLibrary.hpp"
 
 
 using namespace glm;
@@ -60,33 +63,175 @@ inline	void glUniform(GLint location, GLfloat f) { glUniform1f(location, f); }
 inline	void glUniform(GLint location, GLint i) { glUniform1i(location, i); }
 inline	void glUniform(GLint location, GLuint i) { glUniform1ui(location, i); }
 
+/// Compile both shaders and link them, ids are returned even on failure so they can be deleted.
+bool 	buildProgram( const char* vertSrc, const char* fragSrc, GLuint& vertId, GLuint& fragId, GLuint& programId );
+
+///
+/// Per-instance data of a drawn box (uploaded as instanced vertex attributes).
+///
+struct BoxInstance
+{
+	mat4 			model;
+	Color 			color;
+};
+
+///
+/// Upright capsule (e.g. a character controller), drawn instanced as well.
+///
+struct CapsuleInstance
+{
+	vec3 			position;
+	float 			radius;
+	float 			halfHeight;  ///< of the cylinder part
+	Color 			color;
+};
+
+/// Per-frame instance arrays, large enough to live in the huge-page arenas.
+using BoxInstances = ArenaVector<BoxInstance>;
+using CapsuleInstances = ArenaVector<CapsuleInstance>;
+
+struct DebugLine
+{
+	vec3 			from;
+	vec3 			to;
+	Color 			color;
+};
+
+///
+/// One resident heightfield tile, drawn as an instanced grid patch displaced
+/// in the vertex shader.
+///
+struct TerrainPatch
+{
+	using Heights = std::shared_ptr<const std::vector<float>>;
+
+	vec2 		origin;      ///< world (x, z) of sample (0, 0)
+	unsigned 	slot = 0;    ///< layer of the height texture array
+	unsigned 	id = 0;      ///< changes whenever the slot holds another tile
+	Heights 	heights;     ///< samplesPerSide^2 heights, rows along x, columns along z
+};
+
+struct TerrainRenderData
+{
+	unsigned 					samplesPerSide = 0;
+	unsigned 					maxTiles = 0;
+	float 						cellSize = 0.f;
+	std::vector<TerrainPatch> 	patches;
+};
+
+///
+/// Simulation numbers shown by the on-screen overlay.
+///
+struct HudStats
+{
+	float 		stepMs 				= 0.f; ///< simulate() + fetchResults() duration
+	unsigned 	bodies 				= 0;
+	unsigned 	activeBodies 		= 0; ///< awake dynamic and kinematic bodies
+	unsigned 	storedBodies 		= 0; ///< streamed out of the scene
+	unsigned 	joints 				= 0;
+	unsigned 	contacts 			= 0; ///< shape pairs with contacts
+	unsigned 	pairs 				= 0; ///< shape pairs through the narrow phase
+	unsigned 	modifiedPairs 		= 0;
+	float 		contactModifyMs 	= 0.f; ///< contact modify callback duration
+	unsigned 	characters 			= 0;
+	float 		crowdMs 			= 0.f; ///< character controllers update duration
+	unsigned 	vehicles 			= 0;
+	float 		vehicleMs 			= 0.f; ///< suspension raycasts + vehicle updates duration
+	unsigned 	triggerEvents 		= 0; ///< trigger volume enter/leave events of the step
+	unsigned 	droppedTriggerEvents = 0; ///< over the event buffer
+	unsigned 	entities 			= 0;
+	unsigned 	sleepingEntities 	= 0; ///< asleep or static, not synced
+	unsigned 	entityJoints 		= 0;
+	float 		systemsMs 			= 0.f; ///< entity systems run duration
+	unsigned 	filterDataChanges 	= 0;
+	char 		lastAlert[64] 		= {};
+};
+
+///
+/// Immutable snapshot of everything needed to draw one frame.
+/// Built by the simulation thread, consumed by the render thread.
+///
+struct FramePacket
+{
+	using Ptr = std::shared_ptr<const FramePacket>;
+
+	mat4 						view;
+	BoxInstances 				boxes;
+	CapsuleInstances 			capsules;
+	std::vector<DebugLine> 		lines;
+	TerrainRenderData 			terrain;
+	HudStats 					hud;
+	bool 						debugNormals = false;  ///< draw world normals instead of lit colors
+};
+
 ///
 /// Manage everything related to Graphics.
 ///
+/// init() creates the window and the GL context on the calling thread, the
+/// context can then be handed to another thread with releaseCurrent() and
+/// makeCurrent().
+///
 class Graphics
 {
 	public:
 		bool 	init( unsigned width, unsigned height );
 		void 	deinit( void );
 
+		bool 	makeCurrent( void );
+		void 	releaseCurrent( void );
+
 		void 	clear( void );
-		void 	drawBox( const mat4& model, const Color& color );
+		void 	drawFrame( const FramePacket& packet );
 		void 	refresh( void );
 
+		unsigned 	getWidth( void ) const { return _width; }
+		unsigned 	getHeight( void ) const { return _height; }
+		const mat4& getProjection( void ) const { return _proj; }
+
 	private:
+		void 	drawBoxes( const BoxInstances& boxes );
+		void 	drawCapsules( const CapsuleInstances& capsules );
+		void 	initCapsuleResources( void );
+		void 	drawLines( const std::vector<DebugLine>& lines );
+		void 	drawTerrain( const TerrainRenderData& terrain );
+		bool 	initTerrainResources( const TerrainRenderData& terrain );
+		void 	deinitTerrainResources( void );
+
 		SDLWindowUPtr 	_win = nullptr;
 		SDL_GLContext 	_context;
+		unsigned 		_width = 0;
+		unsigned 		_height = 0;
 
 		GLuint 			_boxVAO = 0;
 		GLuint 			_boxVBO = 0;
-		GLuint  		_fragId     = 0;  ///< fragment shader id
-		GLuint  		_vertId     = 0;  ///< vertex shader id
-		GLuint  		_programId  = 0;  ///< program id (attaching both fragment and vertex shaders)
-
-		GLint 			_unifProj = 0;
-		GLint 			_unifView = 0;
-		GLint 			_unifModel = 0;
-		GLint 			_unifColor = 0;
+		GLuint 			_boxInstanceVBO = 0;
+		size_t 			_boxInstanceCapacity = 0; ///< in instances
+
+		GLuint 			_capsuleVAO = 0;
+		GLuint 			_capsuleVBO = 0;
+		GLuint 			_capsuleIBO = 0;
+		GLuint 			_capsuleInstanceVBO = 0;
+		GLsizei 		_capsuleIndexCount = 0;
+		size_t 			_capsuleInstanceCapacity = 0; ///< in instances
+
+		GLuint 			_lineVAO = 0;
+		GLuint 			_lineVBO = 0;
+		size_t 			_lineCapacity = 0; ///< in lines
+		std::vector<GLfloat> 	_lineVertices; ///< staging, kept to avoid per-frame allocations
+
+		GLuint 			_terrainVAO = 0;
+		GLuint 			_terrainVBO = 0;
+		GLuint 			_terrainIBO = 0;
+		GLuint 			_terrainInstanceVBO = 0;
+		GLuint 			_terrainHeights = 0;  ///< 2D texture array, one layer per tile slot
+		GLsizei 		_terrainIndexCount = 0;
+		unsigned 		_terrainSamples = 0;
+		unsigned 		_terrainMaxTiles = 0;
+		std::vector<unsigned> 	_terrainSlotIds;  ///< tile id uploaded in each layer
+		std::vector<GLfloat> 	_terrainInstances;
+
+		ShaderLibrary 	_shaders;
+		unsigned 		_surfaceFeatures = SHADER_LIT;  ///< of this frame's lit draws
 
 		mat4 			_proj;
 		mat4 			_view;
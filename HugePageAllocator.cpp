@@ -0,0 +1,281 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <sys/mman.h>
+#include "HugePageAllocator.hpp"
+#include "Numa.hpp"
+
+#define BLOCK_HEADER_SIZE 	16
+#define ARENA_GRANULARITY 	64
+#define BLOCK_FROM_HEAP 	0x48454150u  // 'HEAP'
+#define BLOCK_FROM_ARENA 	0x4152454eu  // 'AREN'
+
+/// Stored right before every block returned, keeps the blocks 16-byte aligned.
+struct BlockHeader
+{
+	uint32_t 	origin;
+	uint32_t 	padding;
+	uint64_t 	size;  ///< header included
+};
+static_assert(sizeof(BlockHeader) == BLOCK_HEADER_SIZE, "PhysX wants 16-byte aligned blocks");
+
+static inline size_t 	roundUp( size_t value, size_t granularity )
+{
+	return (value + granularity - 1) / granularity * granularity;
+}
+
+static inline void* 	writeHeader( char* block, uint32_t origin, size_t size )
+{
+	BlockHeader* header = reinterpret_cast<BlockHeader*>(block);
+	header->origin = origin;
+	header->size = size;
+	return block + BLOCK_HEADER_SIZE;
+}
+
+static inline void 	updatePeak( std::atomic<size_t>& peak, size_t value )
+{
+	size_t current = peak.load(std::memory_order_relaxed);
+	while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+		;
+}
+
+HugePageAllocator& 	HugePageAllocator::instance( void )
+{
+	static HugePageAllocator allocator;
+	return allocator;
+}
+
+HugePageAllocator::Arena* 	HugePageAllocator::mapArena( size_t minSize, unsigned node )
+{
+	const size_t size = std::max(_arenaSize, roundUp(minSize, HUGE_PAGE_SIZE));
+
+	Arena* arena = new Arena();
+	arena->size = size;
+	arena->node = node;
+
+	// Reserved huge pages first (fails unless vm.nr_hugepages is set)
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (p != MAP_FAILED)
+	{
+		arena->base = static_cast<char*>(p);
+		arena->hugetlb = true;
+		numaBindMemory(p, size, node);
+		_stats.hugetlbMapped += size;
+	}
+	else
+	{
+		// Transparent huge pages need 2 MB aligned ranges: map more and trim
+		p = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+		{
+			delete arena;
+			return nullptr;
+		}
+		char* raw = static_cast<char*>(p);
+		char* base = reinterpret_cast<char*>(roundUp(reinterpret_cast<uintptr_t>(raw), HUGE_PAGE_SIZE));
+		if (base > raw)
+			munmap(raw, base - raw);
+		munmap(base + size, (raw + size + HUGE_PAGE_SIZE) - (base + size));
+
+		madvise(base, size, MADV_HUGEPAGE);
+		numaBindMemory(base, size, node);
+		arena->base = base;
+		_stats.thpMapped += size;
+	}
+
+	arena->freeBlocks[0] = size;
+	_arenas.push_back(arena);
+	return arena;
+}
+
+void* 	HugePageAllocator::allocateFromArenas( size_t size, unsigned node )
+{
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		for (Arena* arena : _arenas)
+		{
+			if (arena->node != node)
+				continue;
+			for (auto it = arena->freeBlocks.begin(); it != arena->freeBlocks.end(); ++it)
+			{
+				if (it->second < size)
+					continue;
+
+				// first fit, the remainder stays free
+				size_t offset = it->first;
+				size_t remaining = it->second - size;
+				arena->freeBlocks.erase(it);
+				if (remaining)
+					arena->freeBlocks[offset + size] = remaining;
+				arena->used += size;
+				return arena->base + offset;
+			}
+		}
+
+		if (!mapArena(size, node))
+			return nullptr;
+	}
+	return nullptr;
+}
+
+void 	HugePageAllocator::freeToArena( Arena& arena, char* block, size_t size )
+{
+	size_t offset = block - arena.base;
+	arena.used -= size;
+
+	// merge with the following and the preceding free blocks
+	auto next = arena.freeBlocks.lower_bound(offset);
+	if (next != arena.freeBlocks.end() && next->first == offset + size)
+	{
+		size += next->second;
+		next = arena.freeBlocks.erase(next);
+	}
+	if (next != arena.freeBlocks.begin())
+	{
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			prev->second += size;
+			return;
+		}
+	}
+	arena.freeBlocks[offset] = size;
+}
+
+void* 	HugePageAllocator::allocate( size_t size, const char*, const char*, int )
+{
+	const size_t total = size + BLOCK_HEADER_SIZE;
+	if (_enabled && size >= _threshold)
+	{
+		const NumaTopology& topology = NumaTopology::get();
+		const unsigned node = topology.isNuma()? topology.getCurrentNode() : 0;
+		const size_t blockSize = roundUp(total, ARENA_GRANULARITY);
+		char* block = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			block = static_cast<char*>(allocateFromArenas(blockSize, node));
+			if (block)
+			{
+				_stats.arenaBytes += blockSize;
+				_stats.peakArenaBytes = std::max(_stats.peakArenaBytes, _stats.arenaBytes);
+			}
+		}
+		if (block)
+			return writeHeader(block, BLOCK_FROM_ARENA, blockSize);
+	}
+
+	// small blocks, disabled mode or no arena left: the heap, without the lock
+	void* p = nullptr;
+	if (posix_memalign(&p, 16, total) != 0)
+		return nullptr;
+	updatePeak(_peakHeapBytes, _heapBytes.fetch_add(total, std::memory_order_relaxed) + total);
+	return writeHeader(static_cast<char*>(p), BLOCK_FROM_HEAP, total);
+}
+
+void 	HugePageAllocator::deallocate( void* ptr )
+{
+	if (!ptr)
+		return;
+
+	char* block = static_cast<char*>(ptr) - BLOCK_HEADER_SIZE;
+	const BlockHeader* header = reinterpret_cast<const BlockHeader*>(block);
+	const size_t size = header->size;
+
+	if (header->origin == BLOCK_FROM_HEAP)
+	{
+		_heapBytes.fetch_sub(size, std::memory_order_relaxed);
+		free(block);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (Arena* arena : _arenas)
+		if (block >= arena->base && block < arena->base + arena->size)
+		{
+			_stats.arenaBytes -= size;
+			freeToArena(*arena, block, size);
+			return;
+		}
+}
+
+HugePageAllocator::Stats 	HugePageAllocator::getStats( void ) const
+{
+	std::vector<Arena> arenas; // base, size and node only: queried without the lock
+	std::vector<std::pair<uintptr_t, uintptr_t>> thpRanges;
+	Stats stats;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		stats = _stats;
+		arenas.resize(_arenas.size());
+		for (size_t i = 0; i < _arenas.size(); ++i)
+		{
+			const Arena* arena = _arenas[i];
+			arenas[i].base = arena->base;
+			arenas[i].size = arena->size;
+			arenas[i].node = arena->node;
+			if (!arena->hugetlb)
+				thpRanges.push_back(std::make_pair((uintptr_t)arena->base, (uintptr_t)(arena->base + arena->size)));
+		}
+	}
+
+	// move_pages() is slow, arenas are never unmapped
+	NumaPlacement placement;
+	for (const Arena& arena : arenas)
+		numaQueryPlacement(arena.base, arena.size, arena.node, placement);
+	stats.heapBytes = _heapBytes.load(std::memory_order_relaxed);
+	stats.peakHeapBytes = _peakHeapBytes.load(std::memory_order_relaxed);
+	stats.sampledPages = placement.sampledPages;
+	stats.remotePages = placement.remotePages;
+	stats.thpBacked = 0;
+	if (thpRanges.empty())
+		return stats;
+
+	// The kernel decides which advised pages really are huge: ask it
+	FILE* smaps = fopen("/proc/self/smaps", "r");
+	if (!smaps)
+		return stats;
+
+	char line[256];
+	bool inArena = false;
+	while (fgets(line, sizeof(line), smaps))
+	{
+		unsigned long start = 0, end = 0;
+		size_t kb = 0;
+		if (sscanf(line, "%lx-%lx ", &start, &end) == 2)
+		{
+			inArena = false;
+			for (const auto& r : thpRanges)
+				if (start >= r.first && start < r.second)
+					inArena = true;
+		}
+		else if (inArena && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1)
+			stats.thpBacked += kb << 10;
+	}
+	fclose(smaps);
+	return stats;
+}
+
+void 	HugePageAllocator::report( std::ostream& out ) const
+{
+	const Stats s = getStats();
+	const float mb = 1.f / (1 << 20);
+	const size_t total = s.arenaBytes + s.heapBytes;
+
+	char line[256];
+	snprintf(line, sizeof(line), "huge pages %s: %.1f MB hugetlb, %.1f MB THP advised (%.1f MB backed)",
+			isEnabled()? "enabled" : "disabled", s.hugetlbMapped * mb, s.thpMapped * mb, s.thpBacked * mb);
+	out << line << std::endl;
+	snprintf(line, sizeof(line), "  in use: %.1f MB from arenas, %.1f MB from the heap (%.0f%% in arenas), peaks %.1f / %.1f MB",
+			s.arenaBytes * mb, s.heapBytes * mb, total? 100.f * s.arenaBytes / total : 0.f,
+			s.peakArenaBytes * mb, s.peakHeapBytes * mb);
+	out << line << std::endl;
+	if (s.sampledPages)
+	{
+		snprintf(line, sizeof(line), "  NUMA: %zu of %zu sampled arena pages away from their node (%.1f%%)",
+				s.remotePages, s.sampledPages, 100.f * s.remotePages / s.sampledPages);
+		out << line << std::endl;
+	}
+}
@@ -0,0 +1,116 @@
+
+#ifndef __MCPLANE_HUGEPAGEALLOCATOR_HPP__
+# define __MCPLANE_HUGEPAGEALLOCATOR_HPP__
+
+# include <map>
+# include <atomic>
+# include <mutex>
+# include <vector>
+# include <ostream>
+# include <PxPhysicsAPI.h>
+
+///
+/// PhysX allocator callback that can serve large blocks from 2 MB huge-page
+/// arenas, to cut TLB misses when walking many bodies.
+///
+/// Arenas are mapped with MAP_HUGETLB when the system has reserved huge
+/// pages, otherwise as regular anonymous memory advised with
+/// MADV_HUGEPAGE (transparent huge pages, best effort). Blocks smaller than
+/// the threshold, and every block while huge pages are disabled, come from
+/// the regular heap. Every block is 16-byte aligned as PhysX requires, and
+/// can be freed whatever the mode was when it was allocated.
+///
+/// On NUMA hosts every node has its own arenas, bound to it: a block comes
+/// from the node the allocating thread runs on, so scenes stepped by a
+/// NumaDispatcher keep their large blocks local.
+///
+/// Thread-safe: PhysX allocates from its worker threads too. Only the arena
+/// bookkeeping is locked, heap blocks take no lock.
+///
+class HugePageAllocator : public physx::PxAllocatorCallback
+{
+	public:
+		static const size_t 	HUGE_PAGE_SIZE = 2u << 20;
+
+		struct Stats
+		{
+			size_t 	arenaBytes = 0;        ///< in use, served from arenas
+			size_t 	heapBytes = 0;         ///< in use, served from the regular heap
+			size_t 	peakArenaBytes = 0;
+			size_t 	peakHeapBytes = 0;
+			size_t 	hugetlbMapped = 0;     ///< arena memory backed by reserved huge pages
+			size_t 	thpMapped = 0;         ///< arena memory advised for transparent huge pages
+			size_t 	thpBacked = 0;         ///< part of it actually backed by huge pages (from smaps)
+			size_t 	sampledPages = 0;      ///< arena pages sampled for their NUMA node
+			size_t 	remotePages = 0;       ///< sampled pages found away from their arena's node
+		};
+
+		/// Shared by PhysX and the arena-backed containers (ArenaAllocator).
+		static HugePageAllocator& 	instance( void );
+
+		/// New allocations follow the mode; it can change at any time.
+		void 	setEnabled( bool enabled ) { _enabled = enabled; }
+		bool 	isEnabled( void ) const { return _enabled; }
+		/// Smallest block served from the arenas.
+		void 	setThreshold( size_t bytes ) { _threshold = bytes; }
+
+		void* 	allocate( size_t size, const char* typeName, const char* filename, int line ) override;
+		void 	deallocate( void* ptr ) override;
+
+		Stats 	getStats( void ) const;
+		/// Human readable huge-page coverage.
+		void 	report( std::ostream& out ) const;
+
+	private:
+		HugePageAllocator( void ) = default;
+		HugePageAllocator( const HugePageAllocator& ) = delete;
+		HugePageAllocator& operator=( const HugePageAllocator& ) = delete;
+
+		struct Arena
+		{
+			char* 						base = nullptr;
+			size_t 						size = 0;
+			bool 						hugetlb = false;
+			unsigned 					node = 0;    ///< NumaTopology index
+			size_t 						used = 0;
+			std::map<size_t, size_t> 	freeBlocks;  ///< offset -> size, coalesced
+		};
+
+		Arena* 	mapArena( size_t minSize, unsigned node );
+		void* 	allocateFromArenas( size_t size, unsigned node );
+		void 	freeToArena( Arena& arena, char* block, size_t size );
+
+		mutable std::mutex 		_mutex;  ///< arenas and the arena stats
+		std::atomic<bool> 		_enabled{false};
+		std::atomic<size_t> 	_threshold{16u << 10};
+		size_t 					_arenaSize = 32u << 20;
+		std::vector<Arena*> 	_arenas;
+		Stats 					_stats;  ///< arena fields, the heap ones are the atomics below
+		std::atomic<size_t> 	_heapBytes{0};
+		std::atomic<size_t> 	_peakHeapBytes{0};
+};
+
+///
+/// std allocator on top of HugePageAllocator::instance(), for the big
+/// per-frame arrays (entities, render instances).
+///
+template<class T>
+struct ArenaAllocator
+{
+	using value_type = T;
+
+	ArenaAllocator( void ) = default;
+	template<class U> ArenaAllocator( const ArenaAllocator<U>& ) {}
+
+	T* 		allocate( size_t n ) {
+		return static_cast<T*>(HugePageAllocator::instance().allocate(n * sizeof(T), "ArenaAllocator", __FILE__, __LINE__));
+	}
+	void 	deallocate( T* p, size_t ) { HugePageAllocator::instance().deallocate(p); }
+
+	template<class U> bool 	operator==( const ArenaAllocator<U>& ) const { return true; }
+	template<class U> bool 	operator!=( const ArenaAllocator<U>& ) const { return false; }
+};
+
+template<class T> using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif // __MCPLANE_HUGEPAGEALLOCATOR_HPP__
@@ -0,0 +1,202 @@
+
+#include <iostream>
+#include "JointFactory.hpp"
+
+using namespace physx;
+
+void 	JointDescs::reserve( size_t count )
+{
+	types.reserve(count);
+	flags.reserve(count);
+	actors0.reserve(count);
+	actors1.reserve(count);
+	frames0.reserve(count);
+	frames1.reserve(count);
+	limits.reserve(count);
+	drives.reserve(count);
+	projections.reserve(count);
+}
+
+void 	JointDescs::clear( void )
+{
+	types.clear();
+	flags.clear();
+	actors0.clear();
+	actors1.clear();
+	frames0.clear();
+	frames1.clear();
+	limits.clear();
+	drives.clear();
+	projections.clear();
+}
+
+size_t 	JointDescs::add( JointType type, PxRigidActor* actor0, const PxTransform& frame0,
+		PxRigidActor* actor1, const PxTransform& frame1, uint8_t jointFlags )
+{
+	types.push_back(type);
+	flags.push_back(jointFlags);
+	actors0.push_back(actor0);
+	actors1.push_back(actor1);
+	frames0.push_back(frame0);
+	frames1.push_back(frame1);
+	limits.push_back(JointLimit());
+	drives.push_back(JointDrive());
+	projections.push_back(JointProjection());
+	return types.size() - 1;
+}
+
+size_t 	JointFactory::create( PxPhysics& physics, const JointDescs& descs, PxJoint** joints )
+{
+	size_t created = 0;
+	for (size_t i = 0; i < descs.size(); ++i)
+	{
+		joints[i] = createJoint(physics, descs, i);
+		if (!joints[i])
+			continue;
+		++created;
+
+		const uint8_t flags = descs.flags[i];
+		if (!(flags & JOINT_COLLIDE))
+		{
+			const bool keep = flags & (JOINT_KEEP_FILTER_DATA0 | JOINT_KEEP_FILTER_DATA1);
+			if (keep)
+			{
+				_shapes.clear();
+				_filterData.clear();
+				if (flags & JOINT_KEEP_FILTER_DATA0)
+					saveFilterData(descs.actors0[i]);
+				if (flags & JOINT_KEEP_FILTER_DATA1)
+					saveFilterData(descs.actors1[i]);
+			}
+			joints[i]->setConstraintFlag(PxConstraintFlag::eCOLLISION_ENABLED, false);
+			if (keep)
+				restoreFilterData();
+		}
+		setJointProjection(*joints[i], descs.projections[i]);
+	}
+	return created;
+}
+
+PxJoint* 	JointFactory::createJoint( PxPhysics& physics, const JointDescs& descs, size_t i )
+{
+	PxRigidActor* actor0 = descs.actors0[i];
+	PxRigidActor* actor1 = descs.actors1[i];
+	const PxTransform& frame0 = descs.frames0[i];
+	const PxTransform& frame1 = descs.frames1[i];
+	const bool limited = descs.flags[i] & JOINT_LIMITED;
+	const bool driven = descs.flags[i] & JOINT_DRIVEN;
+	const JointLimit& limit = descs.limits[i];
+	const JointDrive& drive = descs.drives[i];
+	const bool soft = limit.stiffness > 0.f;
+	const PxSpring spring(limit.stiffness, limit.damping);
+
+	switch (descs.types[i])
+	{
+		case JOINT_FIXED:
+			return PxFixedJointCreate(physics, actor0, frame0, actor1, frame1);
+
+		case JOINT_REVOLUTE:
+		{
+			PxRevoluteJoint* joint = PxRevoluteJointCreate(physics, actor0, frame0, actor1, frame1);
+			if (joint && limited)
+			{
+				joint->setLimit(soft? PxJointAngularLimitPair(limit.lower, limit.upper, spring)
+						: PxJointAngularLimitPair(limit.lower, limit.upper));
+				joint->setRevoluteJointFlag(PxRevoluteJointFlag::eLIMIT_ENABLED, true);
+			}
+			if (joint && driven)
+			{
+				joint->setDriveVelocity(drive.velocity);
+				joint->setDriveForceLimit(drive.forceLimit);
+				joint->setRevoluteJointFlag(PxRevoluteJointFlag::eDRIVE_ENABLED, true);
+			}
+			return joint;
+		}
+
+		case JOINT_SPHERICAL:
+		{
+			PxSphericalJoint* joint = PxSphericalJointCreate(physics, actor0, frame0, actor1, frame1);
+			if (joint && limited)
+			{
+				joint->setLimitCone(soft? PxJointLimitCone(limit.yAngle, limit.zAngle, spring)
+						: PxJointLimitCone(limit.yAngle, limit.zAngle));
+				joint->setSphericalJointFlag(PxSphericalJointFlag::eLIMIT_ENABLED, true);
+			}
+			return joint;
+		}
+
+		case JOINT_PRISMATIC:
+		{
+			PxPrismaticJoint* joint = PxPrismaticJointCreate(physics, actor0, frame0, actor1, frame1);
+			if (joint && limited)
+			{
+				joint->setLimit(soft? PxJointLinearLimitPair(limit.lower, limit.upper, spring)
+						: PxJointLinearLimitPair(physics.getTolerancesScale(), limit.lower, limit.upper));
+				joint->setPrismaticJointFlag(PxPrismaticJointFlag::eLIMIT_ENABLED, true);
+			}
+			return joint;
+		}
+
+		case JOINT_DISTANCE:
+		{
+			PxDistanceJoint* joint = PxDistanceJointCreate(physics, actor0, frame0, actor1, frame1);
+			if (joint && limited)
+			{
+				joint->setMinDistance(limit.lower);
+				joint->setMaxDistance(limit.upper);
+				joint->setDistanceJointFlag(PxDistanceJointFlag::eMIN_DISTANCE_ENABLED, true);
+				joint->setDistanceJointFlag(PxDistanceJointFlag::eMAX_DISTANCE_ENABLED, true);
+			}
+			if (joint && driven)
+			{
+				joint->setStiffness(drive.stiffness);
+				joint->setDamping(drive.damping);
+				joint->setDistanceJointFlag(PxDistanceJointFlag::eSPRING_ENABLED, true);
+			}
+			return joint;
+		}
+
+		case JOINT_D6:
+		{
+			// created with every axis locked
+			PxD6Joint* joint = PxD6JointCreate(physics, actor0, frame0, actor1, frame1);
+			if (joint && limited)
+			{
+				joint->setMotion(PxD6Axis::eTWIST, PxD6Motion::eLIMITED);
+				joint->setMotion(PxD6Axis::eSWING1, PxD6Motion::eLIMITED);
+				joint->setMotion(PxD6Axis::eSWING2, PxD6Motion::eLIMITED);
+				joint->setTwistLimit(soft? PxJointAngularLimitPair(limit.lower, limit.upper, spring)
+						: PxJointAngularLimitPair(limit.lower, limit.upper));
+				joint->setSwingLimit(soft? PxJointLimitCone(limit.yAngle, limit.zAngle, spring)
+						: PxJointLimitCone(limit.yAngle, limit.zAngle));
+			}
+			if (joint && driven)
+			{
+				joint->setDrive(PxD6Drive::eSLERP, PxD6JointDrive(drive.stiffness, drive.damping, drive.forceLimit));
+				joint->setDrivePosition(PxTransform(PxIdentity));
+			}
+			return joint;
+		}
+	}
+	std::cout << "JointFactory: unknown joint type " << (unsigned)descs.types[i] << std::endl;
+	return nullptr;
+}
+
+void 	JointFactory::saveFilterData( PxRigidActor* actor )
+{
+	if (!actor)
+		return;
+	const size_t first = _shapes.size();
+	const PxU32 count = actor->getNbShapes();
+	_shapes.resize(first + count);
+	if (count)
+		actor->getShapes(&_shapes[first], count);
+	for (size_t i = first; i < _shapes.size(); ++i)
+		_filterData.push_back(_shapes[i]->getSimulationFilterData());
+}
+
+void 	JointFactory::restoreFilterData( void )
+{
+	for (size_t i = 0; i < _shapes.size(); ++i)
+		_shapes[i]->setSimulationFilterData(_filterData[i]);
+}
@@ -0,0 +1,114 @@
+
+#ifndef __MCPLANE_JOINTFACTORY_HPP__
+# define __MCPLANE_JOINTFACTORY_HPP__
+
+# include <vector>
+# include <cstdint>
+# include <PxPhysicsAPI.h>
+# include "JointTuning.hpp"
+
+enum JointType : uint8_t
+{
+	JOINT_FIXED,
+	JOINT_REVOLUTE,
+	JOINT_SPHERICAL,
+	JOINT_PRISMATIC,
+	JOINT_DISTANCE,
+	JOINT_D6,
+};
+
+enum JointFlag : uint8_t
+{
+	JOINT_COLLIDE 			= 1 << 0,  ///< keep the contacts between the two actors
+	JOINT_KEEP_FILTER_DATA0 = 1 << 1,  ///< restore the filter data of actor0 after disabling the contacts
+	JOINT_KEEP_FILTER_DATA1 = 1 << 2,  ///< restore the filter data of actor1 after disabling the contacts
+	JOINT_LIMITED 			= 1 << 3,  ///< apply the limit of the joint
+	JOINT_DRIVEN 			= 1 << 4,  ///< apply the drive of the joint
+};
+
+///
+/// Limit of a joint, read according to its type:
+///  - revolute: lower/upper twist angles
+///  - prismatic: lower/upper positions along the x axis of the frames
+///  - distance: lower/upper distances
+///  - spherical: yAngle/zAngle of the cone
+///  - D6: lower/upper twist angles and the swing cone, linear axes locked
+///
+/// A stiffness above 0 makes it a soft limit.
+///
+struct JointLimit
+{
+	float 	lower 		= 0.f;
+	float 	upper 		= 0.f;
+	float 	yAngle 		= physx::PxPi / 4.f;
+	float 	zAngle 		= physx::PxPi / 4.f;
+	float 	stiffness 	= 0.f;
+	float 	damping 	= 0.f;
+};
+
+///
+/// Drive of a joint, read according to its type:
+///  - revolute: velocity and forceLimit
+///  - distance: stiffness and damping of the spring
+///  - D6: slerp drive towards the rest frames (stiffness, damping, forceLimit)
+///
+/// Fixed, spherical and prismatic joints have none.
+///
+struct JointDrive
+{
+	float 	stiffness 	= 0.f;
+	float 	damping 	= 0.f;
+	float 	forceLimit 	= PX_MAX_F32;
+	float 	velocity 	= 0.f;
+};
+
+///
+/// Joints to create, as contiguous arrays: entry i of each one describes
+/// joint i. A null actor is the world. Reuse the same descriptors (clear()
+/// keeps the storage) to build structures without allocating per joint.
+///
+struct JointDescs
+{
+	std::vector<JointType> 					types;
+	std::vector<uint8_t> 					flags;  ///< JointFlag bits
+	std::vector<physx::PxRigidActor*> 		actors0;
+	std::vector<physx::PxRigidActor*> 		actors1;
+	std::vector<physx::PxTransform> 		frames0;  ///< in actor 0
+	std::vector<physx::PxTransform> 		frames1;  ///< in actor 1
+	std::vector<JointLimit> 				limits;  ///< read with JOINT_LIMITED
+	std::vector<JointDrive> 				drives;  ///< read with JOINT_DRIVEN
+	std::vector<JointProjection> 			projections;
+
+	size_t 	size( void ) const { return types.size(); }
+	void 	reserve( size_t count );
+	void 	clear( void );
+
+	/// Index of the new joint; its limit, drive and projection are the defaults.
+	size_t 	add( JointType type, physx::PxRigidActor* actor0, const physx::PxTransform& frame0,
+			physx::PxRigidActor* actor1, const physx::PxTransform& frame1, uint8_t jointFlags = 0 );
+};
+
+///
+/// Creates the joints of a JointDescs in one pass, with the same handling
+/// for every type: contacts between the actors disabled unless
+/// JOINT_COLLIDE (with the filter data of each actor restored on its
+/// JOINT_KEEP_FILTER_DATA flag, the workaround of this project), then the
+/// limit, the drive and the projection.
+///
+class JointFactory
+{
+	public:
+		/// joints receives descs.size() pointers, nullptr where the creation
+		/// failed. Returns the number of joints created.
+		size_t 	create( physx::PxPhysics& physics, const JointDescs& descs, physx::PxJoint** joints );
+
+	private:
+		physx::PxJoint* 	createJoint( physx::PxPhysics& physics, const JointDescs& descs, size_t i );
+		void 				saveFilterData( physx::PxRigidActor* actor );
+		void 				restoreFilterData( void );
+
+		std::vector<physx::PxShape*> 		_shapes;  ///< scratch of the filter data restore
+		std::vector<physx::PxFilterData> 	_filterData;
+};
+
+#endif // __MCPLANE_JOINTFACTORY_HPP__
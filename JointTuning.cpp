@@ -0,0 +1,49 @@
+
+#include <cmath>
+#include <algorithm>
+#include "JointTuning.hpp"
+
+using namespace physx;
+
+/// Every joint type with both tolerances has the same two setters.
+template<class T>
+static bool 	setTolerances( PxJoint& joint, const JointProjection& projection )
+{
+	T* typed = joint.is<T>();
+	if (!typed)
+		return false;
+	typed->setProjectionLinearTolerance(projection.linearTolerance);
+	typed->setProjectionAngularTolerance(projection.angularTolerance);
+	return true;
+}
+
+bool 	setJointProjection( PxJoint& joint, const JointProjection& projection )
+{
+	bool supported = setTolerances<PxFixedJoint>(joint, projection)
+		|| setTolerances<PxRevoluteJoint>(joint, projection)
+		|| setTolerances<PxPrismaticJoint>(joint, projection)
+		|| setTolerances<PxD6Joint>(joint, projection);
+	if (!supported)
+	{
+		PxSphericalJoint* spherical = joint.is<PxSphericalJoint>();
+		if (!spherical)
+			return false;
+		spherical->setProjectionLinearTolerance(projection.linearTolerance);
+	}
+	joint.setConstraintFlag(PxConstraintFlag::ePROJECTION, projection.enabled);
+	return true;
+}
+
+void 	getJointError( const PxJoint& joint, float& linear, float& angular )
+{
+	PxRigidActor* actors[2];
+	joint.getActors(actors[0], actors[1]);
+	const PxTransform frame0 = (actors[0]? actors[0]->getGlobalPose() : PxTransform(PxIdentity))
+		* joint.getLocalPose(PxJointActorIndex::eACTOR0);
+	const PxTransform frame1 = (actors[1]? actors[1]->getGlobalPose() : PxTransform(PxIdentity))
+		* joint.getLocalPose(PxJointActorIndex::eACTOR1);
+
+	linear = (frame1.p - frame0.p).magnitude();
+	const PxQuat delta = frame0.q.getConjugate() * frame1.q;
+	angular = 2.f * std::acos(std::min(std::abs(delta.w), 1.f));
+}
@@ -0,0 +1,31 @@
+
+#ifndef __MCPLANE_JOINTTUNING_HPP__
+# define __MCPLANE_JOINTTUNING_HPP__
+
+# include <PxPhysicsAPI.h>
+
+///
+/// Projection of a joint: after the solver, when the joint error is over a
+/// tolerance, the lighter body is moved back in place.
+///
+/// It keeps stiff assemblies together with few solver iterations, at the
+/// cost of momentum (a projected body is teleported, not pushed). Compare it
+/// with more position iterations on the assembly (joint_bench).
+///
+struct JointProjection
+{
+	bool 	enabled 			= false;
+	float 	linearTolerance 	= 0.05f;  ///< distance between the joint frames
+	float 	angularTolerance 	= 0.05f;  ///< radians
+};
+
+/// Fixed, revolute, prismatic and D6 joints use both tolerances, spherical
+/// joints only the linear one. False for the types without projection.
+bool 	setJointProjection( physx::PxJoint& joint, const JointProjection& projection );
+
+/// Distance and angle (radians) between the world frames of the joint on its
+/// two actors: the whole error of a fixed joint, the error plus the free
+/// motion for the others.
+void 	getJointError( const physx::PxJoint& joint, float& linear, float& angular );
+
+#endif // __MCPLANE_JOINTTUNING_HPP__
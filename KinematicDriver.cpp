@@ -0,0 +1,51 @@
+
+#include <cstring>
+#include <iostream>
+#include "KinematicDriver.hpp"
+
+using namespace physx;
+
+size_t 	KinematicDriver::add( PxRigidDynamic& body )
+{
+	if (!(body.getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC))
+		std::cout << "KinematicDriver: the body is not kinematic" << std::endl;
+
+	PxTransform pose = body.getGlobalPose();
+	_bodies.push_back(&body);
+	_targets.push_back(pose);
+	_applied.push_back(pose);
+	return _bodies.size() - 1;
+}
+
+void 	KinematicDriver::clear( void )
+{
+	_bodies.clear();
+	_targets.clear();
+	_applied.clear();
+}
+
+void 	KinematicDriver::setTargets( const PxTransform* poses, size_t count, size_t first )
+{
+	if (first + count > _targets.size())
+	{
+		std::cout << "KinematicDriver: targets out of range" << std::endl;
+		return;
+	}
+	memcpy(&_targets[first], poses, count * sizeof(PxTransform));
+}
+
+size_t 	KinematicDriver::apply( void )
+{
+	size_t calls = 0;
+	for (size_t i = 0; i < _bodies.size(); ++i)
+	{
+		const PxTransform& target = _targets[i];
+		if (memcmp(&target, &_applied[i], sizeof(PxTransform)) == 0)
+			continue;
+
+		_bodies[i]->setKinematicTarget(target);
+		_applied[i] = target;
+		++calls;
+	}
+	return calls;
+}
@@ -0,0 +1,38 @@
+
+#ifndef __MCPLANE_KINEMATICDRIVER_HPP__
+# define __MCPLANE_KINEMATICDRIVER_HPP__
+
+# include <vector>
+# include <PxPhysicsAPI.h>
+
+///
+/// Moves a set of kinematic bodies from one contiguous array of target poses.
+///
+/// Animation code writes the poses in place (getTargets()) or copies a whole
+/// range (setTargets()), then apply() hands them to PhysX once per step,
+/// before simulate(). Targets equal to the previously applied ones are
+/// skipped: a kinematic body without a new target simply stays still.
+///
+class KinematicDriver
+{
+	public:
+		/// The body must be kinematic; its current pose is its first target. Returns its index.
+		size_t 	add( physx::PxRigidDynamic& body );
+		void 	clear( void );
+
+		size_t 					size( void ) const { return _bodies.size(); }
+		physx::PxTransform* 	getTargets( void ) { return _targets.data(); }
+
+		/// Copy count poses to the targets from index first.
+		void 	setTargets( const physx::PxTransform* poses, size_t count, size_t first = 0 );
+
+		/// Returns the number of setKinematicTarget() calls made.
+		size_t 	apply( void );
+
+	private:
+		std::vector<physx::PxRigidDynamic*> 	_bodies;
+		std::vector<physx::PxTransform> 		_targets;
+		std::vector<physx::PxTransform> 		_applied;
+};
+
+#endif // __MCPLANE_KINEMATICDRIVER_HPP__
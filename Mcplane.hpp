@@ -0,0 +1,31 @@
+
+#ifndef __MCPLANE_HPP__
+# define __MCPLANE_HPP__
+
+///
+/// Public API of mcplane_core, the physics core shared by the demo, the
+/// headless runner, the benchmarks and the Python module. Consumers include
+/// this header and link mcplane_core; the headers below stay free of any
+/// window, GL or demo type.
+///
+/// MCPLANE_API_VERSION is bumped on any incompatible change of them.
+///
+
+# define MCPLANE_API_VERSION 1
+
+# include "HugePageAllocator.hpp"
+# include "Numa.hpp"
+# include "Simulation.hpp"
+# include "JointFactory.hpp"
+# include "JointTuning.hpp"
+# include "ContactTuning.hpp"
+# include "ShapeOffsets.hpp"
+# include "SpawnValidator.hpp"
+# include "TriggerVolumes.hpp"
+# include "Vehicles.hpp"
+# include "BodyCommands.hpp"
+# include "KinematicDriver.hpp"
+# include "SceneHistory.hpp"
+# include "SceneFork.hpp"
+
+#endif // __MCPLANE_HPP__
@@ -0,0 +1,264 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <dirent.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "Numa.hpp"
+
+using namespace physx;
+
+// From <numaif.h>, so that libnuma is not needed
+#define NUMA_MPOL_PREFERRED 	1
+#define NUMA_MAX_NODES 			1024
+#define NUMA_SAMPLED_PAGES 		256
+
+//// Topology ////
+
+/// "0-3,8,10-11" -> { 0, 1, 2, 3, 8, 10, 11 }
+static std::vector<int> 	parseCpuList( const char* list )
+{
+	std::vector<int> cpus;
+	while (*list)
+	{
+		char* end = nullptr;
+		long first = strtol(list, &end, 10);
+		if (end == list)
+			break;
+		long last = first;
+		if (*end == '-')
+			last = strtol(end + 1, &end, 10);
+		for (long cpu = first; cpu <= last; ++cpu)
+			cpus.push_back(cpu);
+		list = (*end == ',')? end + 1 : end;
+	}
+	return cpus;
+}
+
+NumaTopology::NumaTopology( void )
+{
+	DIR* dir = opendir("/sys/devices/system/node");
+	if (dir)
+	{
+		std::vector<int> ids;
+		while (dirent* entry = readdir(dir))
+		{
+			int id = 0;
+			if (sscanf(entry->d_name, "node%d", &id) == 1)
+				ids.push_back(id);
+		}
+		closedir(dir);
+		std::sort(ids.begin(), ids.end());
+
+		for (int id : ids)
+		{
+			char path[128];
+			char list[4096] = {};
+			snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", id);
+			FILE* file = fopen(path, "r");
+			if (!file)
+				continue;
+			if (!fgets(list, sizeof(list), file))
+				list[0] = '\0';
+			fclose(file);
+
+			std::vector<int> cpus = parseCpuList(list);
+			if (cpus.empty())
+				continue; // memory-only node, nothing to run there
+			_nodes.push_back(id);
+			_cpus.push_back(cpus);
+		}
+	}
+
+	if (_nodes.empty())
+	{
+		std::vector<int> cpus;
+		const long count = sysconf(_SC_NPROCESSORS_ONLN);
+		for (long cpu = 0; cpu < count; ++cpu)
+			cpus.push_back(cpu);
+		_nodes.push_back(0);
+		_cpus.push_back(cpus);
+	}
+}
+
+const NumaTopology& 	NumaTopology::get( void )
+{
+	static NumaTopology topology;
+	return topology;
+}
+
+unsigned 	NumaTopology::getCurrentNode( void ) const
+{
+	if (!isNuma())
+		return 0;
+
+	const int cpu = sched_getcpu();
+	for (unsigned node = 0; node < _nodes.size(); ++node)
+		if (std::find(_cpus[node].begin(), _cpus[node].end(), cpu) != _cpus[node].end())
+			return node;
+	return 0;
+}
+
+//// Placement ////
+
+static bool 	makeNodeMask( unsigned node, unsigned long* mask )
+{
+	const NumaTopology& topology = NumaTopology::get();
+	if (node >= topology.getNodeCount() || topology.getNodeId(node) >= NUMA_MAX_NODES)
+		return false;
+
+	const int id = topology.getNodeId(node);
+	const unsigned bits = sizeof(unsigned long) * 8;
+	for (unsigned i = 0; i < NUMA_MAX_NODES / bits; ++i)
+		mask[i] = 0;
+	mask[id / bits] |= 1ul << (id % bits);
+	return true;
+}
+
+bool 	numaPinThread( unsigned node )
+{
+	const NumaTopology& topology = NumaTopology::get();
+	if (!topology.isNuma() || node >= topology.getNodeCount())
+		return false;
+
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	for (int cpu : topology.getCpus(node))
+		if (cpu < CPU_SETSIZE)
+			CPU_SET(cpu, &cpus);
+	bool pinned = (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0);
+
+#ifdef SYS_set_mempolicy
+	unsigned long mask[NUMA_MAX_NODES / (sizeof(unsigned long) * 8)];
+	if (makeNodeMask(node, mask))
+		pinned = (syscall(SYS_set_mempolicy, NUMA_MPOL_PREFERRED, mask, NUMA_MAX_NODES + 1) == 0) && pinned;
+#endif
+	return pinned;
+}
+
+bool 	numaBindMemory( void* address, size_t size, unsigned node )
+{
+#ifdef SYS_mbind
+	if (!NumaTopology::get().isNuma())
+		return false;
+
+	unsigned long mask[NUMA_MAX_NODES / (sizeof(unsigned long) * 8)];
+	if (!makeNodeMask(node, mask))
+		return false;
+	return syscall(SYS_mbind, address, size, NUMA_MPOL_PREFERRED, mask, NUMA_MAX_NODES + 1, 0) == 0;
+#else
+	return false;
+#endif
+}
+
+void 	numaQueryPlacement( const void* address, size_t size, unsigned node, NumaPlacement& placement )
+{
+#ifdef SYS_move_pages
+	const NumaTopology& topology = NumaTopology::get();
+	if (!topology.isNuma() || node >= topology.getNodeCount())
+		return;
+
+	const size_t pageSize = sysconf(_SC_PAGESIZE);
+	const size_t pages = size / pageSize;
+	if (pages == 0)
+		return;
+
+	// evenly spread samples, move_pages() with no target nodes only reports
+	const size_t count = std::min<size_t>(pages, NUMA_SAMPLED_PAGES);
+	void* samples[NUMA_SAMPLED_PAGES];
+	int status[NUMA_SAMPLED_PAGES];
+	for (size_t i = 0; i < count; ++i)
+		samples[i] = (char*)address + (i * pages / count) * pageSize;
+	if (syscall(SYS_move_pages, 0, count, samples, nullptr, status, 0) != 0)
+		return;
+
+	const int id = topology.getNodeId(node);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (status[i] < 0)
+			continue; // never touched
+		++placement.sampledPages;
+		if (status[i] == id)
+			++placement.localPages;
+		else
+			++placement.remotePages;
+	}
+#endif
+}
+
+//// Dispatcher ////
+
+NumaDispatcher::~NumaDispatcher( void )
+{
+	deinit();
+}
+
+bool 	NumaDispatcher::init( unsigned node, unsigned threadCount )
+{
+	if (!_workers.empty())
+		return false; // already init
+
+	if (node >= NumaTopology::get().getNodeCount())
+	{
+		std::cout << "no NUMA node " << node << std::endl;
+		return false;
+	}
+
+	_node = node;
+	_quit = false;
+	for (unsigned i = 0; i < threadCount; ++i)
+		_workers.push_back(std::thread(&NumaDispatcher::workerMain, this));
+	return true;
+}
+
+void 	NumaDispatcher::deinit( void )
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_wakeUp.notify_all();
+	for (std::thread& worker : _workers)
+		worker.join();
+	_workers.clear();
+}
+
+void 	NumaDispatcher::submitTask( PxBaseTask& task )
+{
+	if (_workers.empty())
+	{
+		task.run();
+		task.release();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push_back(&task);
+	}
+	_wakeUp.notify_one();
+}
+
+void 	NumaDispatcher::workerMain( void )
+{
+	numaPinThread(_node);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_wakeUp.wait(lock, [this] { return _quit || !_tasks.empty(); });
+		if (_tasks.empty())
+			return; // quitting, and nothing left to run
+
+		PxBaseTask* task = _tasks.front();
+		_tasks.pop_front();
+		lock.unlock();
+		task->run();
+		task->release();
+		lock.lock();
+	}
+}
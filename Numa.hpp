@@ -0,0 +1,85 @@
+
+#ifndef __MCPLANE_NUMA_HPP__
+# define __MCPLANE_NUMA_HPP__
+
+# include <deque>
+# include <mutex>
+# include <thread>
+# include <vector>
+# include <condition_variable>
+# include <PxPhysicsAPI.h>
+
+///
+/// NUMA nodes and their CPUs, read once from /sys/devices/system/node.
+///
+/// Without that information (non-NUMA kernel, container without sysfs) a
+/// single node 0 holding every CPU is reported, and everything below turns
+/// into harmless no-ops.
+///
+class NumaTopology
+{
+	public:
+		static const NumaTopology& 	get( void );
+
+		unsigned 					getNodeCount( void ) const { return _nodes.size(); }
+		int 						getNodeId( unsigned index ) const { return _nodes[index]; }
+		const std::vector<int>& 	getCpus( unsigned index ) const { return _cpus[index]; }
+		/// Index of the node the calling thread currently runs on.
+		unsigned 					getCurrentNode( void ) const;
+		bool 						isNuma( void ) const { return _nodes.size() > 1; }
+
+	private:
+		NumaTopology( void );
+
+		std::vector<int> 				_nodes;  ///< kernel node ids
+		std::vector<std::vector<int>> 	_cpus;
+};
+
+/// Pin the calling thread to the CPUs of a node, and make the node its
+/// preferred memory node (first touch stays local). Best effort.
+bool 	numaPinThread( unsigned node );
+
+/// Prefer a node for an untouched memory range (mbind). Best effort.
+bool 	numaBindMemory( void* address, size_t size, unsigned node );
+
+/// Where the pages of a range ended up, sampled with move_pages().
+struct NumaPlacement
+{
+	size_t 	sampledPages = 0;
+	size_t 	localPages = 0;   ///< on the expected node
+	size_t 	remotePages = 0;  ///< on another node: every access crosses the interconnect
+};
+void 	numaQueryPlacement( const void* address, size_t size, unsigned node, NumaPlacement& placement );
+
+///
+/// PhysX CPU dispatcher whose worker threads are pinned to one node.
+///
+/// One per scene: each scene is stepped on the CPUs of its node, and the
+/// memory its workers touch first is allocated there. With no worker
+/// threads, tasks run on the thread that submits them.
+///
+class NumaDispatcher : public physx::PxCpuDispatcher
+{
+	public:
+		~NumaDispatcher( void );
+
+		bool 	init( unsigned node, unsigned threadCount );
+		void 	deinit( void );
+
+		void 			submitTask( physx::PxBaseTask& task ) override;
+		physx::PxU32 	getWorkerCount( void ) const override { return _workers.size(); }
+
+		unsigned 	getNode( void ) const { return _node; }
+
+	private:
+		void 	workerMain( void );
+
+		unsigned 						_node = 0;
+		std::vector<std::thread> 		_workers;
+		std::deque<physx::PxBaseTask*> 	_tasks;
+		std::mutex 						_mutex;
+		std::condition_variable 		_wakeUp;
+		bool 							_quit = false;
+};
+
+#endif // __MCPLANE_NUMA_HPP__
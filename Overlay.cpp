@@ -0,0 +1,377 @@
+
+#include <iostream>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include "Overlay.hpp"
+
+#define GLYPH_SIZE 		8
+#define GLYPH_SCALE 	2
+#define ATLAS_COLUMNS 	16
+#define FIRST_GLYPH 	' '
+#define LAST_GLYPH 		'~'
+
+const char* overlayVertexShader = R"str(
+#version 330 core
+
+uniform vec2 screen;
+
+layout (location = 0) in vec2 Corner;
+layout (location = 1) in vec2 InstancePos;
+layout (location = 2) in uint InstanceGlyph;
+layout (location = 3) in vec4 InstanceColor;
+
+out vec2 texel;
+out vec4 glyphColor;
+
+void main() {
+	const float glyphSize = 8.0;
+	const float glyphScale = 2.0;
+	const uint atlasColumns = 16u;
+
+	vec2 cell = vec2(InstanceGlyph % atlasColumns, InstanceGlyph / atlasColumns);
+	texel = (cell + Corner) * glyphSize;
+	glyphColor = InstanceColor;
+
+	vec2 p = InstancePos + Corner * glyphSize * glyphScale;
+	gl_Position = vec4(p.x / screen.x * 2.0 - 1.0, 1.0 - p.y / screen.y * 2.0, 0.0, 1.0);
+}
+
+)str";
+
+const char* overlayFragShader = R"str(
+#version 330 core
+
+uniform sampler2D atlas;
+
+layout (location = 0) out vec4 OutColor;
+
+in vec2 texel;
+in vec4 glyphColor;
+
+void main() {
+	float coverage = texelFetch(atlas, ivec2(texel), 0).r;
+	if (coverage < 0.5)
+		discard;
+	OutColor = glyphColor;
+}
+
+)str";
+
+/// Public domain 8x8 font (font8x8_basic), one byte per row, lsb on the left.
+static const unsigned char 	fontGlyphs[LAST_GLYPH - FIRST_GLYPH + 1][GLYPH_SIZE] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// ' '
+	{ 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 },	// '!'
+	{ 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '"'
+	{ 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 },	// '#'
+	{ 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 },	// '$'
+	{ 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 },	// '%'
+	{ 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 },	// '&'
+	{ 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '''
+	{ 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 },	// '('
+	{ 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 },	// ')'
+	{ 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 },	// '*'
+	{ 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 },	// '+'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 },	// ','
+	{ 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 },	// '-'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 },	// '.'
+	{ 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 },	// '/'
+	{ 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 },	// '0'
+	{ 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 },	// '1'
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 },	// '2'
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 },	// '3'
+	{ 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 },	// '4'
+	{ 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 },	// '5'
+	{ 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 },	// '6'
+	{ 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 },	// '7'
+	{ 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 },	// '8'
+	{ 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 },	// '9'
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 },	// ':'
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 },	// ';'
+	{ 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 },	// '<'
+	{ 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 },	// '='
+	{ 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 },	// '>'
+	{ 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 },	// '?'
+	{ 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 },	// '@'
+	{ 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 },	// 'A'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 },	// 'B'
+	{ 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 },	// 'C'
+	{ 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 },	// 'D'
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 },	// 'E'
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 },	// 'F'
+	{ 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 },	// 'G'
+	{ 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 },	// 'H'
+	{ 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// 'I'
+	{ 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 },	// 'J'
+	{ 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 },	// 'K'
+	{ 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 },	// 'L'
+	{ 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 },	// 'M'
+	{ 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 },	// 'N'
+	{ 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 },	// 'O'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 },	// 'P'
+	{ 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 },	// 'Q'
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 },	// 'R'
+	{ 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 },	// 'S'
+	{ 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// 'T'
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 },	// 'U'
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },	// 'V'
+	{ 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 },	// 'W'
+	{ 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 },	// 'X'
+	{ 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 },	// 'Y'
+	{ 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 },	// 'Z'
+	{ 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 },	// '['
+	{ 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 },	// '\'
+	{ 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 },	// ']'
+	{ 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 },	// '^'
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF },	// '_'
+	{ 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '`'
+	{ 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 },	// 'a'
+	{ 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 },	// 'b'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 },	// 'c'
+	{ 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 },	// 'd'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 },	// 'e'
+	{ 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 },	// 'f'
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F },	// 'g'
+	{ 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 },	// 'h'
+	{ 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// 'i'
+	{ 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E },	// 'j'
+	{ 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 },	// 'k'
+	{ 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// 'l'
+	{ 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 },	// 'm'
+	{ 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 },	// 'n'
+	{ 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 },	// 'o'
+	{ 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F },	// 'p'
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 },	// 'q'
+	{ 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 },	// 'r'
+	{ 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 },	// 's'
+	{ 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 },	// 't'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 },	// 'u'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },	// 'v'
+	{ 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 },	// 'w'
+	{ 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 },	// 'x'
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F },	// 'y'
+	{ 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 },	// 'z'
+	{ 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 },	// '{'
+	{ 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 },	// '|'
+	{ 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 },	// '}'
+	{ 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '~'
+};
+
+static const GLubyte 	textColor[4] = { 16, 16, 16, 255 };
+static const GLubyte 	alertColor[4] = { 200, 0, 0, 255 };
+
+bool 	Overlay::init( unsigned width, unsigned height )
+{
+	_width = width;
+	_height = height;
+
+	if (buildProgram(overlayVertexShader, overlayFragShader, _vertId, _fragId, _programId) == false)
+		return false;
+
+	_unifScreen = glGetUniformLocation(_programId, "screen");
+	_unifAtlas = glGetUniformLocation(_programId, "atlas");
+
+	// Bake the atlas: one 8x8 cell per glyph, ATLAS_COLUMNS cells per row
+	const unsigned glyphCount = LAST_GLYPH - FIRST_GLYPH + 1;
+	const unsigned atlasWidth = ATLAS_COLUMNS * GLYPH_SIZE;
+	const unsigned atlasHeight = ((glyphCount + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS) * GLYPH_SIZE;
+	std::vector<GLubyte> pixels(atlasWidth * atlasHeight, 0);
+
+	for (unsigned g = 0; g < glyphCount; ++g)
+	{
+		unsigned x0 = (g % ATLAS_COLUMNS) * GLYPH_SIZE;
+		unsigned y0 = (g / ATLAS_COLUMNS) * GLYPH_SIZE;
+		for (unsigned row = 0; row < GLYPH_SIZE; ++row)
+			for (unsigned col = 0; col < GLYPH_SIZE; ++col)
+				if (fontGlyphs[g][row] & (1 << col))
+					pixels[(y0 + row) * atlasWidth + x0 + col] = 255;
+	}
+
+	glGenTextures(1, &_atlas);
+	glBindTexture(GL_TEXTURE_2D, _atlas);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlasWidth, atlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	// Unit quad drawn once per glyph instance
+	glGenVertexArrays(1, &_vao);
+	glBindVertexArray(_vao);
+
+	const GLfloat corners[] = { 0.f, 0.f,  1.f, 0.f,  0.f, 1.f,  1.f, 1.f };
+	glGenBuffers(1, &_quadVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, _quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), 0);
+
+	glGenBuffers(1, &_instanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, x));
+	glVertexAttribDivisor(1, 1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, glyph));
+	glVertexAttribDivisor(2, 1);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphInstance), (void*)offsetof(GlyphInstance, color));
+	glVertexAttribDivisor(3, 1);
+
+	glBindVertexArray(0);
+
+	_periodStart = Clock::now();
+	return true;
+}
+
+void 	Overlay::deinit( void )
+{
+	if (_fragId) glDeleteShader(_fragId);
+	if (_vertId) glDeleteShader(_vertId);
+	if (_programId) glDeleteProgram(_programId);
+	glDeleteTextures(1, &_atlas);
+	glDeleteBuffers(1, &_quadVBO);
+	glDeleteBuffers(1, &_instanceVBO);
+	glDeleteVertexArrays(1, &_vao);
+	_fragId = _vertId = _programId = 0;
+}
+
+void 	Overlay::draw( const HudStats& stats )
+{
+	Clock::time_point t0 = Clock::now();
+
+	updateAverages(stats);
+	rebuild(stats);
+
+	if (!_glyphs.empty())
+	{
+		glDisable(GL_DEPTH_TEST);
+		glUseProgram(_programId);
+		glUniform(_unifScreen, vec2((float)_width, (float)_height));
+		glUniform(_unifAtlas, (GLint)0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, _atlas);
+		glBindVertexArray(_vao);
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, _glyphs.size());
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	_periodCostMs += std::chrono::duration<float, std::milli>(Clock::now() - t0).count();
+}
+
+void 	Overlay::updateAverages( const HudStats& stats )
+{
+	++_periodFrames;
+	_periodStepMs += stats.stepMs;
+	_periodCrowdMs += stats.crowdMs;
+	_periodModifyMs += stats.contactModifyMs;
+	_periodVehicleMs += stats.vehicleMs;
+	_periodSystemsMs += stats.systemsMs;
+
+	float elapsed = std::chrono::duration<float>(Clock::now() - _periodStart).count();
+	if (elapsed < 0.5f)
+		return;
+
+	_fps = _periodFrames / elapsed;
+	_stepMs = _periodStepMs / _periodFrames;
+	_crowdMs = _periodCrowdMs / _periodFrames;
+	_modifyMs = _periodModifyMs / _periodFrames;
+	_vehicleMs = _periodVehicleMs / _periodFrames;
+	_systemsMs = _periodSystemsMs / _periodFrames;
+	_costMs = _periodCostMs / _periodFrames;
+
+	_periodStart = Clock::now();
+	_periodFrames = 0;
+	_periodStepMs = 0.f;
+	_periodCrowdMs = 0.f;
+	_periodModifyMs = 0.f;
+	_periodVehicleMs = 0.f;
+	_periodSystemsMs = 0.f;
+	_periodCostMs = 0.f;
+}
+
+void 	Overlay::rebuild( const HudStats& stats )
+{
+	char 	line[128];
+
+	// Format everything first and only touch the instance buffer on changes
+	_scratch.clear();
+	snprintf(line, sizeof(line), "fps %.1f  step %.3f ms  hud %.3f ms\n", _fps, _stepMs, _costMs);
+	_scratch += line;
+	snprintf(line, sizeof(line), "bodies %u (%u stored)  joints %u  contacts %u of %u pairs\n",
+			stats.bodies, stats.storedBodies, stats.joints, stats.contacts, stats.pairs);
+	_scratch += line;
+	if (stats.entities)
+	{
+		snprintf(line, sizeof(line), "entities %u (%u asleep, %u joints)  systems %.3f ms\n",
+				stats.entities, stats.sleepingEntities, stats.entityJoints, _systemsMs);
+		_scratch += line;
+	}
+	if (stats.modifiedPairs)
+	{
+		snprintf(line, sizeof(line), "contact modify %u pairs  %.3f ms\n", stats.modifiedPairs, _modifyMs);
+		_scratch += line;
+	}
+	if (stats.characters)
+	{
+		snprintf(line, sizeof(line), "crowd %u characters  %.3f ms\n", stats.characters, _crowdMs);
+		_scratch += line;
+	}
+	if (stats.vehicles)
+	{
+		snprintf(line, sizeof(line), "%u vehicles  %.3f ms\n", stats.vehicles, _vehicleMs);
+		_scratch += line;
+	}
+	if (stats.triggerEvents || stats.droppedTriggerEvents)
+	{
+		snprintf(line, sizeof(line), "trigger events %u (%u dropped)\n", stats.triggerEvents, stats.droppedTriggerEvents);
+		_scratch += line;
+	}
+
+	// alerts come last, in another color
+	const unsigned alertLine = std::count(_scratch.begin(), _scratch.end(), '\n');
+	if (stats.filterDataChanges)
+	{
+		snprintf(line, sizeof(line), "filter data changed %u times, last: %s\n", stats.filterDataChanges, stats.lastAlert);
+		_scratch += line;
+	}
+
+	if (_scratch == _text)
+		return;
+	_text.swap(_scratch);
+
+	_glyphs.clear();
+	_cursorY = GLYPH_SIZE;
+	unsigned lineIndex = 0;
+	const char* begin = _text.c_str();
+	for (const char* end = strchr(begin, '\n'); end; begin = end + 1, end = strchr(begin, '\n'), ++lineIndex)
+		appendLine(begin, end, (lineIndex >= alertLine)? alertColor : textColor);
+
+	glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO);
+	if (_glyphs.size() > _instanceCapacity)
+	{
+		_instanceCapacity = _glyphs.size() * 2;
+		glBufferData(GL_ARRAY_BUFFER, _instanceCapacity * sizeof(GlyphInstance), nullptr, GL_DYNAMIC_DRAW);
+	}
+	glBufferSubData(GL_ARRAY_BUFFER, 0, _glyphs.size() * sizeof(GlyphInstance), _glyphs.data());
+}
+
+void 	Overlay::appendLine( const char* begin, const char* end, const GLubyte color[4] )
+{
+	float x = GLYPH_SIZE;
+	for (const char* c = begin; c != end; ++c, x += GLYPH_SIZE * GLYPH_SCALE)
+	{
+		if (*c == ' ' || *c < FIRST_GLYPH || *c > LAST_GLYPH)
+			continue;
+
+		GlyphInstance g;
+		g.x = x;
+		g.y = _cursorY;
+		g.glyph = *c - FIRST_GLYPH;
+		for (int i = 0; i < 4; ++i)
+			g.color[i] = color[i];
+		_glyphs.push_back(g);
+	}
+	_cursorY += GLYPH_SIZE * GLYPH_SCALE + 4;
+}
@@ -0,0 +1,76 @@
+
+#ifndef __MCPLANE_OVERLAY_HPP__
+# define __MCPLANE_OVERLAY_HPP__
+
+# include <string>
+# include <chrono>
+# include "Graphics.hpp"
+
+///
+/// On-screen stats overlay.
+///
+/// Glyphs come from a baked 8x8 bitmap font atlas and the whole text is
+/// drawn with a single instanced quad draw. The glyph instance buffer is only
+/// rebuilt when the displayed text changes: averaged values (fps, step time,
+/// overlay cost) are refreshed twice per second.
+///
+class Overlay
+{
+	public:
+		bool 	init( unsigned width, unsigned height );
+		void 	deinit( void );
+
+		/// Must be called once per presented frame, with the GL context current.
+		void 	draw( const HudStats& stats );
+
+	private:
+		struct GlyphInstance
+		{
+			GLfloat 	x, y;     ///< top left corner, in pixels
+			GLuint 		glyph;    ///< index in the atlas
+			GLubyte 	color[4];
+		};
+
+		void 	updateAverages( const HudStats& stats );
+		void 	rebuild( const HudStats& stats );
+		void 	appendLine( const char* begin, const char* end, const GLubyte color[4] );
+
+		GLuint 		_vao = 0;
+		GLuint 		_quadVBO = 0;
+		GLuint 		_instanceVBO = 0;
+		size_t 		_instanceCapacity = 0; ///< in glyphs
+		GLuint 		_atlas = 0;
+		GLuint 		_fragId = 0;
+		GLuint 		_vertId = 0;
+		GLuint 		_programId = 0;
+		GLint 		_unifScreen = 0;
+		GLint 		_unifAtlas = 0;
+
+		unsigned 	_width = 0;
+		unsigned 	_height = 0;
+
+		std::vector<GlyphInstance> 	_glyphs;
+		std::string 				_text;       ///< text currently in _instanceVBO
+		std::string 				_scratch;
+		float 						_cursorY = 0.f;
+
+		// values averaged over the current refresh period
+		using Clock = std::chrono::high_resolution_clock;
+		Clock::time_point 	_periodStart;
+		unsigned 			_periodFrames = 0;
+		float 				_periodStepMs = 0.f;
+		float 				_periodCrowdMs = 0.f;
+		float 				_periodModifyMs = 0.f;
+		float 				_periodVehicleMs = 0.f;
+		float 				_periodSystemsMs = 0.f;
+		float 				_periodCostMs = 0.f;
+		float 				_fps = 0.f;
+		float 				_stepMs = 0.f;
+		float 				_crowdMs = 0.f;
+		float 				_modifyMs = 0.f;
+		float 				_vehicleMs = 0.f;
+		float 				_systemsMs = 0.f;
+		float 				_costMs = 0.f;
+};
+
+#endif // __MCPLANE_OVERLAY_HPP__
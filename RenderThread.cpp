@@ -0,0 +1,122 @@
+
+#include <iostream>
+#include <string>
+#include <system_error>
+#include "RenderThread.hpp"
+#include "GlDebug.hpp"
+
+bool 	RenderThread::start( Graphics& graphics, size_t capacity )
+{
+	if (_running)
+		return false; // already started
+
+	_graphics = &graphics;
+	_capacity = (capacity > 0)? capacity : 1;
+	_running = true;
+
+	// the context can only be current on one thread at a time
+	_graphics->releaseCurrent();
+	try
+	{
+		_thread = std::thread(&RenderThread::run, this);
+	}
+	catch (const std::system_error& e)
+	{
+		std::cout << "RenderThread: cannot start the thread: " << e.what() << std::endl;
+		_running = false;
+		_graphics->makeCurrent();
+		return false;
+	}
+	return true;
+}
+
+void 	RenderThread::stop( void )
+{
+	if (!_running)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_running = false;
+	}
+	_cond.notify_one();
+	_thread.join();
+
+	_queue.clear();
+
+	// give the context back to the caller (for Graphics::deinit)
+	_graphics->makeCurrent();
+}
+
+void 	RenderThread::submit( FramePacket::Ptr packet )
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_queue.size() >= _capacity)
+		{
+			_queue.pop_front();
+			++_dropped;
+		}
+		_queue.push_back(std::move(packet));
+	}
+	_cond.notify_one();
+}
+
+void 	RenderThread::run( void )
+{
+	if (_graphics->makeCurrent() == false)
+		return;
+
+	bool overlayReady = _overlay.init(_graphics->getWidth(), _graphics->getHeight());
+	if (!overlayReady)
+		std::cout << "failed to init overlay, stats won't be displayed" << std::endl;
+
+	while (true)
+	{
+		FramePacket::Ptr packet;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_cond.wait(lock, [this]{ return !_running || !_queue.empty(); });
+			if (!_running)
+				break;
+			packet = std::move(_queue.front());
+			_queue.pop_front();
+		}
+
+		_graphics->clear();
+		_graphics->drawFrame(*packet);
+		if (overlayReady)
+		{
+			GL_DEBUG_GROUP("overlay");
+			_overlay.draw(packet->hud);
+		}
+
+		updateCapture();
+		{
+			GL_DEBUG_GROUP("capture");
+			_capture.capture();
+		}
+
+		_graphics->refresh();
+	}
+
+	_capture.stop();
+	_overlay.deinit();
+	_graphics->releaseCurrent();
+}
+
+void 	RenderThread::updateCapture( void )
+{
+	bool requested = _captureRequested;
+	if (requested == _capture.isRunning())
+		return;
+
+	if (requested)
+	{
+		std::string path = "capture_" + std::to_string(_captureCount++) + ".y4m";
+		if (_capture.start(path, _graphics->getWidth(), _graphics->getHeight(), 60) == false)
+			_captureRequested = false;
+	}
+	else
+		_capture.stop();
+}
@@ -0,0 +1,56 @@
+
+#ifndef __MCPLANE_RENDERTHREAD_HPP__
+# define __MCPLANE_RENDERTHREAD_HPP__
+
+# include <thread>
+# include <mutex>
+# include <condition_variable>
+# include <deque>
+# include <atomic>
+# include "Graphics.hpp"
+# include "Overlay.hpp"
+# include "FrameCapture.hpp"
+
+///
+/// Owns the GL context on a dedicated thread and draws the FramePackets
+/// submitted by the simulation thread.
+///
+/// The packet queue is bounded: when the renderer falls behind (slow swap,
+/// vsync wait) the oldest pending packet is dropped instead of blocking the
+/// submitter, so physics stepping is never delayed by presentation.
+///
+class RenderThread
+{
+	public:
+		static const size_t 	DEFAULT_CAPACITY = 2;
+
+		bool 	start( Graphics& graphics, size_t capacity = DEFAULT_CAPACITY );
+		void 	stop( void );
+
+		void 	submit( FramePacket::Ptr packet );
+
+		/// Start or stop recording the presented frames to capture_<n>.y4m.
+		void 	setCapturing( bool enabled ) { _captureRequested = enabled; }
+		bool 	isCapturing( void ) const { return _captureRequested; }
+
+		unsigned 	getDroppedCount( void ) const { return _dropped; }
+
+	private:
+		void 	run( void );
+		void 	updateCapture( void );
+
+		Graphics* 						_graphics = nullptr;
+		Overlay 						_overlay;
+		FrameCapture 					_capture;
+		std::atomic<bool> 				_captureRequested{false};
+		unsigned 						_captureCount = 0;
+		std::thread 					_thread;
+		std::mutex 						_mutex;
+		std::condition_variable 		_cond;
+		std::deque<FramePacket::Ptr> 	_queue;
+		size_t 							_capacity = DEFAULT_CAPACITY;
+		bool 							_running = false;
+		std::atomic<unsigned> 			_dropped{0}; ///< packets discarded because the queue was full, read by any thread
+};
+
+#endif // __MCPLANE_RENDERTHREAD_HPP__
@@ -0,0 +1,235 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <iostream>
+#include "SceneFork.hpp"
+
+using namespace physx;
+
+/// Binary collections are deserialized in place from blocks aligned like this.
+static const size_t 	SERIAL_ALIGNMENT = 128;
+
+bool 	SceneForker::init( PxPhysics& physics, const PxSceneDesc& desc )
+{
+	if (_physics)
+		return false; // already init
+
+	_registry = PxSerialization::createSerializationRegistry(physics);
+	if (!_registry)
+	{
+		std::cout << "SceneForker: no serialization registry" << std::endl;
+		return false;
+	}
+	_physics = &physics;
+	_desc = desc;
+	return true;
+}
+
+void 	SceneForker::deinit( void )
+{
+	if (_captured)
+		_captured->release();
+	if (_registry)
+		_registry->release();
+	_captured = nullptr;
+	_registry = nullptr;
+	_physics = nullptr;
+	_data.clear();
+}
+
+bool 	SceneForker::capture( PxScene& scene )
+{
+	if (!_physics)
+		return false;
+	if (_captured)
+		_captured->release();
+	_captured = PxCreateCollection();
+	_data.clear();
+
+	const PxActorTypeSelectionFlags rigids = PxActorTypeSelectionFlag::eRIGID_STATIC | PxActorTypeSelectionFlag::eRIGID_DYNAMIC;
+	std::vector<PxActor*> actors(scene.getNbActors(rigids));
+	if (!actors.empty())
+		scene.getActors(rigids, actors.data(), actors.size());
+	for (PxActor* actor : actors)
+		_captured->add(*actor);
+
+	std::vector<PxConstraint*> constraints(scene.getNbConstraints());
+	if (!constraints.empty())
+		scene.getConstraints(constraints.data(), constraints.size());
+	for (PxConstraint* c : constraints)
+	{
+		PxU32 typeID = 0;
+		PxJoint* joint = (PxJoint*)c->getExternalReference(typeID);
+		if (typeID == PxConstraintExtIDs::eJOINT)
+			_captured->add(*joint);
+	}
+
+	// shapes, materials and meshes follow, then everything gets an id
+	PxSerialization::complete(*_captured, *_registry);
+	PxSerialization::createSerialObjectIds(*_captured, PxSerialObjectId(1));
+	if (!PxSerialization::isSerializable(*_captured, *_registry))
+	{
+		std::cout << "SceneForker: the scene cannot be serialized" << std::endl;
+		return false;
+	}
+
+	PxDefaultMemoryOutputStream stream;
+	if (!PxSerialization::serializeCollectionToBinary(stream, *_captured, *_registry))
+	{
+		std::cout << "SceneForker: serialization failed" << std::endl;
+		return false;
+	}
+	_data.assign(stream.getData(), stream.getData() + stream.getSize());
+	return true;
+}
+
+PxSerialObjectId 	SceneForker::getId( const PxBase& original ) const
+{
+	return _captured? _captured->getId(original) : PxSerialObjectId(0);
+}
+
+bool 	SceneForker::createFork( SceneFork& fork )
+{
+	if (posix_memalign(&fork._memory, SERIAL_ALIGNMENT, _data.size()) != 0)
+	{
+		fork._memory = nullptr;
+		return false;
+	}
+	memcpy(fork._memory, _data.data(), _data.size());
+
+	fork._collection = PxSerialization::createCollectionFromBinary(fork._memory, *_registry);
+	if (!fork._collection)
+	{
+		std::cout << "SceneForker: deserialization failed" << std::endl;
+		return false;
+	}
+
+	// same settings, its own worker and contact modifier (the source's keeps
+	// the stats of the application); the events (triggers) are not for the forks
+	PxSceneDesc desc = _desc;
+	desc.simulationEventCallback = nullptr;
+	desc.contactModifyCallback = nullptr;
+	if (_contactSource)
+	{
+		fork._contactModifier = new ContactModifier();
+		fork._contactModifier->copyGroups(*_contactSource);
+		desc.contactModifyCallback = fork._contactModifier;
+	}
+	fork._dispatcher = PxDefaultCpuDispatcherCreate(1);
+	desc.cpuDispatcher = fork._dispatcher;
+	fork._scene = _physics->createScene(desc);
+	if (!fork._scene)
+		return false;
+	fork._scene->addCollection(*fork._collection);
+	return true;
+}
+
+void 	SceneForker::releaseFork( SceneFork& fork )
+{
+	if (fork._collection)
+	{
+		PxCollectionExt::releaseObjects(*fork._collection);
+		fork._collection->release();
+	}
+	if (fork._scene)
+		fork._scene->release();
+	if (fork._dispatcher)
+		fork._dispatcher->release();
+	delete fork._contactModifier;
+	free(fork._memory);
+	fork = SceneFork();
+}
+
+static float 	kineticEnergy( const PxRigidDynamic& body )
+{
+	const PxVec3 v = body.getLinearVelocity();
+	const PxQuat frame = body.getGlobalPose().q * body.getCMassLocalPose().q;
+	const PxVec3 w = frame.rotateInv(body.getAngularVelocity());
+	const PxVec3 inertia = body.getMassSpaceInertiaTensor();
+	return 0.5f * (body.getMass() * v.magnitudeSquared()
+			+ inertia.x * w.x * w.x + inertia.y * w.y * w.y + inertia.z * w.z * w.z);
+}
+
+bool 	SceneForker::run( const std::vector<ForkVariant>& variants, unsigned steps, float elapsedTime,
+		const std::vector<PxSerialObjectId>& watched, std::vector<ForkMetrics>& metrics,
+		const ForkStepHook& beforeStep )
+{
+	metrics.assign(variants.size(), ForkMetrics());
+	if (_data.empty())
+		return false;
+
+	// PxPhysics objects are created and released on this thread only
+	std::vector<SceneFork> forks(variants.size());
+	std::vector<std::vector<PxRigidDynamic*>> watchedBodies(variants.size());
+	bool ok = true;
+	for (size_t i = 0; i < forks.size(); ++i)
+	{
+		if (!createFork(forks[i]))
+		{
+			ok = false;
+			break;
+		}
+		if (variants[i].setup)
+			variants[i].setup(forks[i]);
+		for (PxSerialObjectId id : watched)
+			if (PxRigidDynamic* body = forks[i].find<PxRigidDynamic>(id))
+				watchedBodies[i].push_back(body);
+		metrics[i].name = variants[i].name;
+	}
+
+	if (ok)
+	{
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < forks.size(); ++i)
+			threads.push_back(std::thread([&, i]( void ) {
+				PxScene& scene = forks[i].getScene();
+				ForkMetrics& m = metrics[i];
+				auto start = std::chrono::high_resolution_clock::now();
+				for (unsigned s = 0; s < steps; ++s)
+				{
+					if (beforeStep)
+						beforeStep(forks[i], s);
+					scene.simulate(elapsedTime);
+					scene.fetchResults(true);
+					for (PxRigidDynamic* body : watchedBodies[i])
+					{
+						m.maxSpeed = std::max(m.maxSpeed, body->getLinearVelocity().magnitude());
+						m.maxAngularSpeed = std::max(m.maxAngularSpeed, body->getAngularVelocity().magnitude());
+					}
+				}
+				m.stepMs = std::chrono::duration<float, std::milli>(
+						std::chrono::high_resolution_clock::now() - start).count() / std::max(steps, 1u);
+
+				for (PxRigidDynamic* body : watchedBodies[i])
+					m.finalEnergy += kineticEnergy(*body);
+				PxSimulationStatistics stats;
+				scene.getSimulationStatistics(stats);
+				m.awakeBodies = stats.nbActiveDynamicBodies;
+				m.contacts = stats.nbDiscreteContactPairsWithContacts;
+			}));
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	for (SceneFork& fork : forks)
+		releaseFork(fork);
+	return ok;
+}
+
+void 	printForkMetrics( std::ostream& out, const std::vector<ForkMetrics>& metrics )
+{
+	char line[160];
+	snprintf(line, sizeof(line), "%-24s %9s %10s %10s %12s %7s %9s",
+			"fork", "step ms", "max speed", "max ang.", "end energy", "awake", "contacts");
+	out << line << std::endl;
+	for (const ForkMetrics& m : metrics)
+	{
+		snprintf(line, sizeof(line), "%-24s %9.3f %10.3f %10.3f %12.3f %7u %9u",
+				m.name.c_str(), m.stepMs, m.maxSpeed, m.maxAngularSpeed, m.finalEnergy, m.awakeBodies, m.contacts);
+		out << line << std::endl;
+	}
+}
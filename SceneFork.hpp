@@ -0,0 +1,124 @@
+
+#ifndef __MCPLANE_SCENEFORK_HPP__
+# define __MCPLANE_SCENEFORK_HPP__
+
+# include <string>
+# include <ostream>
+# include <vector>
+# include <functional>
+# include <PxPhysicsAPI.h>
+# include "ContactTuning.hpp"
+
+///
+/// One independent copy of a captured scene.
+///
+/// Objects are found by the id they had in the capture
+/// (SceneForker::getId() of the original object).
+///
+class SceneFork
+{
+	public:
+		physx::PxScene& 	getScene( void ) { return *_scene; }
+		physx::PxPhysics& 	getPhysics( void ) { return _scene->getPhysics(); }
+		/// The fork's own copy of the source's, nullptr without SceneForker::setContactModifier().
+		ContactModifier* 	getContactModifier( void ) { return _contactModifier; }
+
+		/// nullptr when the object was not captured or has another type.
+		template<class T>
+		T* 		find( physx::PxSerialObjectId id ) const {
+			physx::PxBase* object = id? _collection->find(id) : nullptr;
+			return object? object->is<T>() : nullptr;
+		}
+
+	private:
+		friend class SceneForker;
+
+		physx::PxScene* 					_scene = nullptr;
+		physx::PxDefaultCpuDispatcher* 		_dispatcher = nullptr;
+		physx::PxCollection* 				_collection = nullptr;
+		ContactModifier* 					_contactModifier = nullptr;
+		void* 								_memory = nullptr;  ///< deserialized in place, kept until release
+};
+
+///
+/// Change applied to a fork before it steps, e.g. creating the joint with
+/// other settings.
+///
+struct ForkVariant
+{
+	std::string 						name;
+	std::function<void (SceneFork&)> 	setup;
+};
+
+/// Called on the thread of a fork before each of its steps (0 first).
+using ForkStepHook = std::function<void (SceneFork& fork, unsigned step)>;
+
+///
+/// Numbers comparable between the forks of a run.
+///
+struct ForkMetrics
+{
+	std::string 	name;
+	float 			stepMs 			= 0.f;  ///< average simulate() + fetchResults()
+	float 			maxSpeed 		= 0.f;  ///< peak linear speed of the watched bodies
+	float 			maxAngularSpeed = 0.f;  ///< peak angular speed of the watched bodies
+	float 			finalEnergy 	= 0.f;  ///< kinetic energy of the watched bodies after the last step
+	unsigned 		awakeBodies 	= 0;    ///< after the last step
+	unsigned 		contacts 		= 0;    ///< shape pairs with contacts after the last step
+};
+
+///
+/// What-if evaluation: clones a scene into independent ones through
+/// in-memory binary serialization, and steps them in parallel.
+///
+/// capture() serializes every actor and joint of the scene (with their
+/// shapes, materials and meshes) once. run() then deserializes one fork
+/// per variant into a new scene created from the same description, applies
+/// the variant, and steps all the forks at the same time on their own
+/// threads and dispatchers. The source scene is not touched and the forks
+/// are released before run() returns.
+///
+/// The forks never share the callbacks of the source scene: contact
+/// modification is done by their own ContactModifier, a copy of the one
+/// given to setContactModifier() (groups can then change per fork from a
+/// ForkStepHook), and the other events are not reported.
+///
+/// Joints need PxInitExtensions(). Only the PhysX objects are cloned:
+/// vehicles drives and character controllers do not follow (their actors
+/// just stop being driven).
+///
+class SceneForker
+{
+	public:
+		/// desc is the one of the captured scenes, its dispatcher is replaced in the forks.
+		bool 	init( physx::PxPhysics& physics, const physx::PxSceneDesc& desc );
+		void 	deinit( void );
+		/// Groups copied into every fork; keep it alive while forking.
+		void 	setContactModifier( const ContactModifier* source ) { _contactSource = source; }
+
+		/// Call outside simulate()/fetchResults().
+		bool 	capture( physx::PxScene& scene );
+		/// Id of a captured object in the forks, 0 when it was not captured.
+		physx::PxSerialObjectId 	getId( const physx::PxBase& original ) const;
+		size_t 						getCaptureBytes( void ) const { return _data.size(); }
+
+		bool 	run( const std::vector<ForkVariant>& variants, unsigned steps, float elapsedTime,
+				const std::vector<physx::PxSerialObjectId>& watched, std::vector<ForkMetrics>& metrics,
+				const ForkStepHook& beforeStep = ForkStepHook() );
+
+	private:
+		bool 	createFork( SceneFork& fork );
+		void 	releaseFork( SceneFork& fork );
+
+		physx::PxPhysics* 					_physics = nullptr;
+		physx::PxSceneDesc 					_desc = physx::PxSceneDesc(physx::PxTolerancesScale());
+		const ContactModifier* 				_contactSource = nullptr;
+		physx::PxSerializationRegistry* 	_registry = nullptr;
+		physx::PxCollection* 				_captured = nullptr;  ///< references the source objects, for getId()
+		std::vector<char> 					_data;
+};
+
+/// Print the metrics of a run as a table.
+void 	printForkMetrics( std::ostream& out, const std::vector<ForkMetrics>& metrics );
+
+#endif // __MCPLANE_SCENEFORK_HPP__
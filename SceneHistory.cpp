@@ -0,0 +1,147 @@
+
+#include <algorithm>
+#include <iostream>
+#include "SceneHistory.hpp"
+
+using namespace physx;
+
+bool 	SceneHistory::init( PxScene& scene, size_t budgetBytes )
+{
+	if (_scene)
+		return false; // already init
+
+	_scene = &scene;
+	_budgetBytes = budgetBytes;
+	return true;
+}
+
+void 	SceneHistory::deinit( void )
+{
+	_frames.clear();
+	_spares.clear();
+	_addedJoints.clear();
+	_usedBytes = 0;
+	_scene = nullptr;
+}
+
+void 	SceneHistory::dropOldest( void )
+{
+	_usedBytes -= _frames.front().getBytes();
+	_spares.push_back(std::move(_frames.front()));
+	_frames.pop_front();
+}
+
+void 	SceneHistory::record( unsigned step )
+{
+	if (!_scene)
+		return;
+
+	Frame frame;
+	if (!_spares.empty())
+	{
+		frame = std::move(_spares.back());
+		_spares.pop_back();
+	}
+	frame.step = step;
+	frame.addedJoints.assign(_addedJoints.begin(), _addedJoints.end());
+	_addedJoints.clear();
+
+	const PxU32 count = _scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC);
+	_actors.resize(count);
+	if (count)
+		_scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, _actors.data(), count);
+
+	frame.bodies.resize(count);
+	for (PxU32 i = 0; i < count; ++i)
+	{
+		PxRigidDynamic* body = static_cast<PxRigidDynamic*>(_actors[i]);
+		BodyState& s = frame.bodies[i];
+		s.body = body;
+		s.pose = body->getGlobalPose();
+		s.kinematic = body->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC;
+		s.sleeping = !s.kinematic && body->isSleeping();
+		s.linearVelocity = s.kinematic? PxVec3(0.f) : body->getLinearVelocity();
+		s.angularVelocity = s.kinematic? PxVec3(0.f) : body->getAngularVelocity();
+	}
+
+	_usedBytes += frame.getBytes();
+	_frames.push_back(std::move(frame));
+
+	// the newest step always stays, even over budget
+	while (_frames.size() > 1 && _usedBytes > _budgetBytes)
+		dropOldest();
+}
+
+void 	SceneHistory::jointAdded( PxJoint* joint )
+{
+	_addedJoints.push_back(joint);
+}
+
+void 	SceneHistory::bodiesRemoved( PxRigidActor* const* actors, size_t count )
+{
+	if (!count)
+		return;
+	_removed.assign(actors, actors + count);
+	std::sort(_removed.begin(), _removed.end());
+
+	for (Frame& frame : _frames)
+	{
+		auto end = std::remove_if(frame.bodies.begin(), frame.bodies.end(), [this]( const BodyState& s ) {
+			return std::binary_search(_removed.begin(), _removed.end(), static_cast<PxRigidActor*>(s.body));
+		});
+		frame.bodies.erase(end, frame.bodies.end());
+	}
+}
+
+bool 	SceneHistory::rewind( unsigned step, std::vector<PxJoint*>& jointsToRelease )
+{
+	if (!_scene || _frames.empty() || step < getOldestStep() || step > getNewestStep())
+		return false;
+
+	// steps are recorded one after the other
+	const size_t target = step - getOldestStep();
+	if (_frames[target].step != step)
+	{
+		std::cout << "SceneHistory: step " << step << " is not buffered" << std::endl;
+		return false;
+	}
+
+	// newer frames are undone: their joints go, their storage is kept
+	jointsToRelease.insert(jointsToRelease.end(), _addedJoints.begin(), _addedJoints.end());
+	_addedJoints.clear();
+	while (_frames.size() > target + 1)
+	{
+		Frame& newest = _frames.back();
+		jointsToRelease.insert(jointsToRelease.end(), newest.addedJoints.begin(), newest.addedJoints.end());
+		_usedBytes -= newest.getBytes();
+		_spares.push_back(std::move(newest));
+		_frames.pop_back();
+	}
+
+	// only the bodies still in the scene, looked up in its sorted actors
+	const PxU32 count = _scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC);
+	_actors.resize(count);
+	if (count)
+		_scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, _actors.data(), count);
+	std::sort(_actors.begin(), _actors.end());
+
+	for (const BodyState& s : _frames.back().bodies)
+	{
+		if (!std::binary_search(_actors.begin(), _actors.end(), static_cast<PxActor*>(s.body)))
+			continue;
+
+		PxRigidDynamic& body = *s.body;
+		body.setGlobalPose(s.pose, false);
+		if (s.kinematic)
+			continue;
+		if (s.sleeping)
+		{
+			body.putToSleep();
+			continue;
+		}
+		body.setLinearVelocity(s.linearVelocity, false);
+		body.setAngularVelocity(s.angularVelocity, false);
+		body.wakeUp();
+	}
+	return true;
+}
@@ -0,0 +1,87 @@
+
+#ifndef __MCPLANE_SCENEHISTORY_HPP__
+# define __MCPLANE_SCENEHISTORY_HPP__
+
+# include <deque>
+# include <vector>
+# include <PxPhysicsAPI.h>
+# include "HugePageAllocator.hpp"
+
+///
+/// Compact state of one rigid dynamic after a step.
+///
+struct BodyState
+{
+	physx::PxRigidDynamic* 	body;
+	physx::PxTransform 		pose;
+	physx::PxVec3 			linearVelocity;
+	physx::PxVec3 			angularVelocity;
+	bool 					sleeping;
+	bool 					kinematic;  ///< pose only
+};
+
+///
+/// Ring buffer of the last steps of a scene, to rewind it and replay from
+/// any of them.
+///
+/// record() copies the state of every rigid dynamic of the scene after a
+/// step, plus the joints added since the previous record (jointAdded()).
+/// The oldest steps are dropped to stay within the memory budget; their
+/// storage is reused for the new ones.
+///
+/// rewind() writes the bodies back in one pass and hands back the joints
+/// added after the target step, for the caller to release: the scene then
+/// looks as it did right after that step. Bodies that left the scene since
+/// are skipped. States are kept by actor address: bodies released while
+/// buffered must be reported with bodiesRemoved(), or a new actor created
+/// at the same address would get their state. Released joints are not
+/// brought back.
+///
+class SceneHistory
+{
+	public:
+		bool 	init( physx::PxScene& scene, size_t budgetBytes );
+		void 	deinit( void );
+
+		/// After fetchResults(), the state that follows step.
+		void 	record( unsigned step );
+		/// Joint created by the application, undone when rewinding before it.
+		void 	jointAdded( physx::PxJoint* joint );
+		/// Bodies about to be released: their states are dropped from every step.
+		void 	bodiesRemoved( physx::PxRigidActor* const* actors, size_t count );
+
+		/// Call outside simulate()/fetchResults(); false when the step is not buffered.
+		bool 	rewind( unsigned step, std::vector<physx::PxJoint*>& jointsToRelease );
+
+		bool 		empty( void ) const { return _frames.empty(); }
+		size_t 		size( void ) const { return _frames.size(); }
+		unsigned 	getOldestStep( void ) const { return _frames.front().step; }
+		unsigned 	getNewestStep( void ) const { return _frames.back().step; }
+		size_t 		getUsedBytes( void ) const { return _usedBytes; }
+		size_t 		getBudgetBytes( void ) const { return _budgetBytes; }
+
+	private:
+		struct Frame
+		{
+			unsigned 								step = 0;
+			ArenaVector<BodyState> 					bodies;
+			std::vector<physx::PxJoint*> 			addedJoints;  ///< since the previous frame
+
+			size_t 	getBytes( void ) const {
+				return bodies.capacity() * sizeof(BodyState) + addedJoints.capacity() * sizeof(physx::PxJoint*);
+			}
+		};
+
+		void 	dropOldest( void );
+
+		physx::PxScene* 					_scene = nullptr;
+		size_t 								_budgetBytes = 0;
+		size_t 								_usedBytes = 0;
+		std::deque<Frame> 					_frames;
+		std::vector<Frame> 					_spares;  ///< dropped frames, storage kept
+		std::vector<physx::PxJoint*> 		_addedJoints;  ///< for the next record
+		std::vector<physx::PxActor*> 		_actors;  ///< scratch
+		std::vector<physx::PxRigidActor*> 	_removed;  ///< scratch
+};
+
+#endif // __MCPLANE_SCENEHISTORY_HPP__
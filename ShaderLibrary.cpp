@@ -0,0 +1,283 @@
+
+#include <chrono>
+#include <string>
+#include <iostream>
+#include <SDL2/SDL.h>
+#include "ShaderLibrary.hpp"
+
+typedef void (APIENTRY *MaxShaderCompilerThreadsProc)( GLuint count );
+
+//// Sources ////
+
+static const char* kindDefines[SHADER_KIND_COUNT] = {
+	"#define BOX\n",
+	"#define CAPSULE\n",
+	"#define TERRAIN\n",
+	"#define LINE\n",
+};
+
+static const char* featureDefines[SHADER_FEATURE_BITS] = {
+	"#define LIT\n",
+	"#define DEBUG_NORMALS\n",
+};
+
+/// Output block and surface() shared by every vertex path.
+static const char* vertexCommon = R"str(
+uniform mat4 proj;
+uniform mat4 view;
+
+out VS_OUT
+{
+	float light;
+	vec3 color;
+} vs_out;
+
+void surface(vec3 N, vec3 albedo) {
+#if defined(DEBUG_NORMALS)
+	vs_out.light = 1.0;
+	vs_out.color = N * 0.5 + 0.5;
+#elif defined(LIT)
+	// direction of the sun
+	vec3 sunDir = normalize(vec3(0.5, 1, 0.25));
+	vs_out.light = max(dot(N, sunDir), 0.0);
+	vs_out.color = albedo;
+#else
+	vs_out.light = 1.0;
+	vs_out.color = albedo;
+#endif
+}
+
+)str";
+
+static const char* vertexBodies[SHADER_KIND_COUNT] = {
+// BOX
+R"str(
+layout (location = 0) in vec3 Position;
+layout (location = 1) in vec3 Normal;
+layout (location = 2) in mat4 InstanceModel; // uses locations 2 to 5
+layout (location = 6) in vec3 InstanceColor;
+
+void main() {
+	mat4 rot = InstanceModel;
+	rot[3][0] = 0;
+	rot[3][1] = 0;
+	rot[3][2] = 0;
+	surface(normalize((rot*vec4(Normal, 1.0)).xyz), InstanceColor);
+	gl_Position = proj * view * InstanceModel * vec4(Position, 1.0);
+}
+)str",
+// CAPSULE
+R"str(
+layout (location = 0) in vec3 Position;  // on the unit sphere, also the normal
+layout (location = 1) in float Side;     // +1 for the top hemisphere, -1 for the bottom one
+layout (location = 2) in vec4 InstanceCenterRadius;
+layout (location = 3) in float InstanceHalfHeight;
+layout (location = 4) in vec3 InstanceColor;
+
+void main() {
+	surface(Position, InstanceColor);
+
+	vec3 world = InstanceCenterRadius.xyz + Position * InstanceCenterRadius.w
+		+ vec3(0.0, Side * InstanceHalfHeight, 0.0);
+	gl_Position = proj * view * vec4(world, 1.0);
+}
+)str",
+// TERRAIN
+R"str(
+uniform float cellSize;
+uniform int samples;
+uniform sampler2DArray heights;
+
+layout (location = 0) in vec2 GridPos;  // (row, column) of the sample
+layout (location = 1) in vec3 Patch;    // tile origin x, origin z, texture layer
+
+float heightAt(ivec2 rc, int layer) {
+	rc = clamp(rc, ivec2(0), ivec2(samples - 1));
+	return texelFetch(heights, ivec3(rc.y, rc.x, layer), 0).r;
+}
+
+void main() {
+	ivec2 rc = ivec2(GridPos);
+	int layer = int(Patch.z);
+	float y = heightAt(rc, layer);
+
+	// central differences, rows run along x and columns along z
+	float dx = heightAt(rc + ivec2(1, 0), layer) - heightAt(rc - ivec2(1, 0), layer);
+	float dz = heightAt(rc + ivec2(0, 1), layer) - heightAt(rc - ivec2(0, 1), layer);
+	vec3 N = normalize(vec3(-dx, 2.0 * cellSize, -dz));
+
+	surface(N, mix(vec3(0.2, 0.2, 1.0), vec3(0.35, 0.6, 0.3), clamp(y / 8.0, 0.0, 1.0)));
+
+	vec3 world = vec3(Patch.x + GridPos.x * cellSize, y, Patch.y + GridPos.y * cellSize);
+	gl_Position = proj * view * vec4(world, 1.0);
+}
+)str",
+// LINE
+R"str(
+layout (location = 0) in vec3 Position;
+layout (location = 1) in vec3 Color;
+
+void main() {
+	surface(vec3(0.0, 1.0, 0.0), Color);
+	gl_Position = proj * view * vec4(Position, 1.0);
+}
+)str",
+};
+
+static const char* fragmentSource = R"str(
+#version 330 core
+
+layout (location = 0) out vec4 OutColor;
+
+in VS_OUT
+{
+	float light;
+	vec3 color;
+} fs_in;
+
+void main() {
+	OutColor = vec4(fs_in.color * fs_in.light, 1.0);
+}
+
+)str";
+
+//// Library ////
+
+static std::string 	variantName( const ShaderVariant& variant )
+{
+	static const char* kinds[SHADER_KIND_COUNT] = { "box", "capsule", "terrain", "line" };
+	static const char* features[SHADER_FEATURE_BITS] = { "lit", "debug normals" };
+
+	std::string name = kinds[variant.kind];
+	for (unsigned bit = 0; bit < SHADER_FEATURE_BITS; ++bit)
+		if (variant.features & (1u << bit))
+			name = name + " + " + features[bit];
+	return name;
+}
+
+static bool 	checkShader( GLuint shaderId, const std::string& name )
+{
+	GLint status = GL_FALSE;
+	glGetShaderiv(shaderId, GL_COMPILE_STATUS, &status);
+	if (status == GL_TRUE)
+		return true;
+
+	char buffer[512];
+	glGetShaderInfoLog(shaderId, sizeof(buffer), NULL, buffer);
+	std::cout << "error while compiling shader " << name << ": \n" << buffer << std::endl;
+	return false;
+}
+
+bool 	ShaderLibrary::init( void )
+{
+	if (_fragId)
+		return false; // already init
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const bool parallel = SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile");
+	if (parallel)
+	{
+		MaxShaderCompilerThreadsProc maxThreads =
+			(MaxShaderCompilerThreadsProc)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR");
+		if (maxThreads)
+			maxThreads(0xffffffff); // as many as the driver likes
+	}
+
+	// Everything is issued first: nothing below waits on the driver
+	_fragId = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(_fragId, 1, &fragmentSource, NULL);
+	glCompileShader(_fragId);
+
+	std::string preambles[SHADER_VARIANT_COUNT];
+	for (unsigned i = 0; i < SHADER_VARIANT_COUNT; ++i)
+	{
+		const ShaderVariant& variant = SHADER_VARIANTS[i];
+		std::string& preamble = preambles[i];
+		preamble = "#version 330 core\n";
+		preamble += kindDefines[variant.kind];
+		for (unsigned bit = 0; bit < SHADER_FEATURE_BITS; ++bit)
+			if (variant.features & (1u << bit))
+				preamble += featureDefines[bit];
+
+		const char* sources[3] = { preamble.c_str(), vertexCommon, vertexBodies[variant.kind] };
+		ShaderProgram& p = _programs[i];
+		p.vertId = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(p.vertId, 3, sources, NULL);
+		glCompileShader(p.vertId);
+	}
+	for (ShaderProgram& p : _programs)
+	{
+		p.program = glCreateProgram();
+		glAttachShader(p.program, p.vertId);
+		glAttachShader(p.program, _fragId);
+		glBindFragDataLocation(p.program, 0, "OutColor");
+		glLinkProgram(p.program);
+	}
+
+	// Then the results, in order
+	bool ok = checkShader(_fragId, "fragment");
+	for (unsigned i = 0; i < SHADER_VARIANT_COUNT; ++i)
+	{
+		ShaderProgram& p = _programs[i];
+		const std::string name = variantName(SHADER_VARIANTS[i]);
+		if (!checkShader(p.vertId, name))
+		{
+			ok = false;
+			continue;
+		}
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(p.program, GL_LINK_STATUS, &linked);
+		if (linked != GL_TRUE)
+		{
+			std::cout << "failed to link shader program " << name << std::endl;
+			ok = false;
+			continue;
+		}
+
+		p.proj = glGetUniformLocation(p.program, "proj");
+		p.view = glGetUniformLocation(p.program, "view");
+		p.cellSize = glGetUniformLocation(p.program, "cellSize");
+		p.samples = glGetUniformLocation(p.program, "samples");
+		p.heights = glGetUniformLocation(p.program, "heights");
+	}
+
+	// the first variant of each kind stands in for its missing ones
+	for (unsigned slot = 0; slot < (SHADER_KIND_COUNT << SHADER_FEATURE_BITS); ++slot)
+	{
+		const unsigned kind = slot >> SHADER_FEATURE_BITS;
+		const unsigned features = slot & SHADER_FEATURE_MASK;
+		int fallback = -1;
+		for (unsigned i = 0; i < SHADER_VARIANT_COUNT; ++i)
+		{
+			if (SHADER_VARIANTS[i].kind != kind)
+				continue;
+			if (fallback < 0)
+				fallback = i;
+			if (SHADER_VARIANTS[i].features == features)
+			{
+				fallback = i;
+				break;
+			}
+		}
+		_slots[slot] = (fallback < 0)? 0 : fallback;
+	}
+
+	_buildMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "built " << SHADER_VARIANT_COUNT << " shader variants in " << _buildMs << " ms"
+		<< (parallel? " (parallel compile)" : "") << std::endl;
+	return ok;
+}
+
+void 	ShaderLibrary::deinit( void )
+{
+	for (ShaderProgram& p : _programs)
+	{
+		if (p.vertId) glDeleteShader(p.vertId);
+		if (p.program) glDeleteProgram(p.program);
+		p = ShaderProgram();
+	}
+	if (_fragId) glDeleteShader(_fragId);
+	_fragId = 0;
+}
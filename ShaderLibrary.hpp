@@ -0,0 +1,107 @@
+
+#ifndef __MCPLANE_SHADERLIBRARY_HPP__
+# define __MCPLANE_SHADERLIBRARY_HPP__
+
+# define GLEW_STATIC
+# include <GL/glew.h>
+
+/// What is drawn: selects the vertex path of a variant.
+enum ShaderKind
+{
+	SHADER_BOX,
+	SHADER_CAPSULE,
+	SHADER_TERRAIN,
+	SHADER_LINE,
+	SHADER_KIND_COUNT
+};
+
+/// Feature bits of a variant, each one a #define in its preamble.
+enum ShaderFeature
+{
+	SHADER_LIT 				= 1 << 0,  ///< sun lighting
+	SHADER_DEBUG_NORMALS 	= 1 << 1,  ///< world normals as colors, unlit
+};
+const unsigned SHADER_FEATURE_BITS = 2;
+const unsigned SHADER_FEATURE_MASK = (1u << SHADER_FEATURE_BITS) - 1;
+
+struct ShaderVariant
+{
+	ShaderKind 	kind;
+	unsigned 	features;
+};
+
+/// Every variant built at startup, the first one of a kind is its fallback.
+constexpr ShaderVariant SHADER_VARIANTS[] = {
+	{ SHADER_BOX, 		SHADER_LIT },
+	{ SHADER_BOX, 		SHADER_DEBUG_NORMALS },
+	{ SHADER_CAPSULE, 	SHADER_LIT },
+	{ SHADER_CAPSULE, 	SHADER_DEBUG_NORMALS },
+	{ SHADER_TERRAIN, 	SHADER_LIT },
+	{ SHADER_TERRAIN, 	SHADER_DEBUG_NORMALS },
+	{ SHADER_LINE, 		0 },
+};
+const unsigned SHADER_VARIANT_COUNT = sizeof(SHADER_VARIANTS) / sizeof(SHADER_VARIANTS[0]);
+
+constexpr unsigned 	shaderSlot( ShaderKind kind, unsigned features )
+{
+	return (unsigned(kind) << SHADER_FEATURE_BITS) | (features & SHADER_FEATURE_MASK);
+}
+
+constexpr bool 		hasShaderVariant( ShaderKind kind, unsigned features, unsigned i = 0 )
+{
+	return i < SHADER_VARIANT_COUNT
+		&& ((SHADER_VARIANTS[i].kind == kind && SHADER_VARIANTS[i].features == features)
+			|| hasShaderVariant(kind, features, i + 1));
+}
+
+/// A linked variant and its uniforms (-1 when the variant does not use them).
+struct ShaderProgram
+{
+	GLuint 	program 	= 0;
+	GLuint 	vertId 		= 0;
+	GLint 	proj 		= -1;
+	GLint 	view 		= -1;
+	GLint 	cellSize 	= -1;  ///< terrain only
+	GLint 	samples 	= -1;  ///< terrain only
+	GLint 	heights 	= -1;  ///< terrain only
+};
+
+///
+/// Shader permutations: one program per entry of SHADER_VARIANTS, built
+/// from a shared source with a #define preamble, so each draw runs only
+/// the code of the features it needs.
+///
+/// init() issues every compile and link before checking any of them, which
+/// lets the driver build them in parallel (with KHR_parallel_shader_compile
+/// it is asked to use all its threads). Lookups are a table access: get()
+/// for features chosen at run time, get<Kind, Features>() checks at compile
+/// time that the variant exists.
+///
+class ShaderLibrary
+{
+	public:
+		/// Needs the GL context current.
+		bool 	init( void );
+		void 	deinit( void );
+
+		/// Missing variants fall back to the first one of their kind.
+		const ShaderProgram& 	get( ShaderKind kind, unsigned features ) const {
+			return _programs[_slots[shaderSlot(kind, features)]];
+		}
+
+		template<ShaderKind K, unsigned F>
+		const ShaderProgram& 	get( void ) const {
+			static_assert(hasShaderVariant(K, F), "variant missing from SHADER_VARIANTS");
+			return _programs[_slots[shaderSlot(K, F)]];
+		}
+
+		float 	getBuildMs( void ) const { return _buildMs; }
+
+	private:
+		ShaderProgram 	_programs[SHADER_VARIANT_COUNT];
+		unsigned char 	_slots[SHADER_KIND_COUNT << SHADER_FEATURE_BITS] = {};  ///< index in _programs
+		GLuint 			_fragId = 0;  ///< shared by every variant
+		float 			_buildMs = 0.f;
+};
+
+#endif // __MCPLANE_SHADERLIBRARY_HPP__
@@ -0,0 +1,46 @@
+
+#include <algorithm>
+#include <vector>
+#include "ShapeOffsets.hpp"
+
+using namespace physx;
+
+/// Thinnest dimension, 0 when the geometry has none.
+static float 	getThickness( const PxGeometry& geometry )
+{
+	switch (geometry.getType())
+	{
+		case PxGeometryType::eSPHERE:
+			return 2.f * static_cast<const PxSphereGeometry&>(geometry).radius;
+		case PxGeometryType::eCAPSULE:
+			return 2.f * static_cast<const PxCapsuleGeometry&>(geometry).radius;
+		case PxGeometryType::eBOX:
+			return 2.f * static_cast<const PxBoxGeometry&>(geometry).halfExtents.minElement();
+		case PxGeometryType::eCONVEXMESH:
+			return PxGeometryQuery::getWorldBounds(geometry, PxTransform(PxIdentity), 1.f).getDimensions().minElement();
+		default:
+			return 0.f;
+	}
+}
+
+float 	computeContactOffset( const PxGeometry& geometry, float expectedSpeed, const OffsetSettings& settings )
+{
+	const float thickness = getThickness(geometry);
+	const float cap = (thickness > 0.f)? thickness * settings.thicknessFraction : settings.maxContactOffset;
+	const float offset = std::min(expectedSpeed * settings.stepDuration, std::min(cap, settings.maxContactOffset));
+	return std::max(offset, std::max(settings.minContactOffset, settings.restOffset + settings.minContactOffset));
+}
+
+void 	applyContactOffsets( PxRigidActor& actor, float expectedSpeed, const OffsetSettings& settings )
+{
+	std::vector<PxShape*> shapes(actor.getNbShapes());
+	if (!shapes.empty())
+		actor.getShapes(shapes.data(), shapes.size());
+	for (PxShape* shape : shapes)
+	{
+		// the rest offset must stay below the contact offset while both change
+		shape->setRestOffset(std::min(shape->getRestOffset(), settings.restOffset));
+		shape->setContactOffset(computeContactOffset(shape->getGeometry().any(), expectedSpeed, settings));
+		shape->setRestOffset(settings.restOffset);
+	}
+}
@@ -0,0 +1,34 @@
+
+#ifndef __MCPLANE_SHAPEOFFSETS_HPP__
+# define __MCPLANE_SHAPEOFFSETS_HPP__
+
+# include <PxPhysicsAPI.h>
+
+struct OffsetSettings
+{
+	float 	stepDuration 		= 1.f / 60.f;
+	float 	minContactOffset 	= 0.002f;
+	float 	maxContactOffset 	= 0.1f;   ///< for the shapes without a thickness (planes, heightfields, meshes)
+	float 	thicknessFraction 	= 0.1f;   ///< of the thinnest dimension, upper bound of the offset
+	float 	restOffset 			= 0.f;    ///< kept below the contact offset
+};
+
+///
+/// Contact offset of a shape from its size and the speed it is expected to
+/// move at, instead of the single PxTolerancesScale default.
+///
+/// The offset covers the distance moved in one step, so that contacts are
+/// generated a step before the shapes touch. It is capped by a fraction
+/// of the thinnest dimension of the shape: a thin slab keeps a thin margin
+/// and does not pair with everything around it. What the cap misses at high
+/// speeds is for CCD, not for the offset.
+///
+float 	computeContactOffset( const physx::PxGeometry& geometry, float expectedSpeed,
+		const OffsetSettings& settings = OffsetSettings() );
+
+/// Set the contact and rest offsets of every shape of the actor. Call it
+/// before the actor is added to a scene.
+void 	applyContactOffsets( physx::PxRigidActor& actor, float expectedSpeed,
+		const OffsetSettings& settings = OffsetSettings() );
+
+#endif // __MCPLANE_SHAPEOFFSETS_HPP__
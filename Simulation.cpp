@@ -0,0 +1,226 @@
+
+#include <chrono>
+#include <iostream>
+#include "Simulation.hpp"
+#include "HugePageAllocator.hpp"
+
+using namespace physx;
+
+/// Process-wide PhysX objects, counted by the Simulations using them.
+struct SharedPhysics
+{
+	unsigned 					users = 0;
+	PxDefaultErrorCallback 		errorCallback;
+	PxFoundation* 				foundation = nullptr;
+	PxProfileZoneManager* 		profileZoneManager = nullptr;
+	PxPhysics* 					physics = nullptr;
+	PxCooking* 					cooking = nullptr;
+};
+
+static SharedPhysics 	gShared;
+
+static bool 	acquireShared( void )
+{
+	if (gShared.users++)
+		return true;
+
+	gShared.foundation = PxCreateFoundation(PX_PHYSICS_VERSION, HugePageAllocator::instance(), gShared.errorCallback);
+	if (!gShared.foundation)
+	{
+		std::cout << "PxCreateFoundation failed!" << std::endl;
+		gShared.users = 0;
+		return false;
+	}
+	gShared.profileZoneManager = &PxProfileZoneManager::createProfileZoneManager(gShared.foundation);
+	gShared.physics = PxCreatePhysics(PX_PHYSICS_VERSION, *gShared.foundation,
+			PxTolerancesScale(), true, gShared.profileZoneManager);
+	if (!gShared.physics)
+	{
+		std::cout << "PxCreatePhysics failed!" << std::endl;
+		gShared.profileZoneManager->release();
+		gShared.foundation->release();
+		gShared = SharedPhysics();
+		return false;
+	}
+
+	gShared.cooking = PxCreateCooking(PX_PHYSICS_VERSION, *gShared.foundation,
+			PxCookingParams(gShared.physics->getTolerancesScale()));
+	if (!gShared.cooking)
+		std::cout << "PxCreateCooking failed!" << std::endl;
+
+	// joints are serialized by the extensions, for the forks
+	if (!PxInitExtensions(*gShared.physics))
+		std::cout << "PxInitExtensions failed!" << std::endl;
+	return true;
+}
+
+static void 	releaseShared( void )
+{
+	if (!gShared.users || --gShared.users)
+		return;
+
+	PxCloseExtensions();
+	if (gShared.cooking)
+		gShared.cooking->release();
+	gShared.physics->release();
+	gShared.profileZoneManager->release();
+	gShared.foundation->release();
+	gShared.cooking = nullptr;
+	gShared.physics = nullptr;
+	gShared.profileZoneManager = nullptr;
+	gShared.foundation = nullptr;
+}
+
+bool 	Simulation::init( const SimulationSettings& settings )
+{
+	if (_scene)
+		return false; // already init
+
+	if (!acquireShared())
+		return false;
+	PxPhysics& physics = *gShared.physics;
+
+	_material = physics.createMaterial(0.5f, 0.5f, 0.6f); //static friction, dynamic friction, restitution
+
+	if (!settings.dispatcher)
+		_dispatcher = PxDefaultCpuDispatcherCreate(settings.threads);
+
+	_desc = PxSceneDesc(physics.getTolerancesScale());
+	_desc.gravity = settings.gravity;
+	_desc.cpuDispatcher = settings.dispatcher? settings.dispatcher : _dispatcher;
+	_desc.filterShader = settings.filterShader;
+	_desc.contactModifyCallback = settings.contactModifyCallback;
+	_desc.simulationEventCallback = settings.simulationEventCallback;
+	_scene = physics.createScene(_desc);
+	if (!_scene)
+	{
+		std::cout << "createScene failed!" << std::endl;
+		deinit();
+		return false;
+	}
+	return true;
+}
+
+void 	Simulation::deinit( void )
+{
+	if (!_material)
+		return;
+
+	if (_scene)
+		_scene->release();
+	if (_dispatcher)
+		_dispatcher->release();
+	_material->release();
+	_scene = nullptr;
+	_dispatcher = nullptr;
+	_material = nullptr;
+	releaseShared();
+}
+
+PxPhysics& 	Simulation::getPhysics( void )
+{
+	return *gShared.physics;
+}
+
+PxCooking* 	Simulation::getCooking( void )
+{
+	return gShared.cooking;
+}
+
+PxRigidDynamic* 	Simulation::createBox( float mass, const PxVec3& halfsize, const PxVec3& position, bool kinematic )
+{
+	PxRigidDynamic* body = getPhysics().createRigidDynamic(PxTransform(position));
+	body->createShape(PxBoxGeometry(halfsize), *_material);
+
+	PxRigidBodyExt::updateMassAndInertia(*body, 10.f);
+	body->setMass(mass);
+	if (kinematic)
+		body->setRigidBodyFlag(PxRigidBodyFlag::eKINEMATIC, true);
+	return body;
+}
+
+PxRigidStatic* 	Simulation::createStaticBox( const PxVec3& halfsize, const PxVec3& position )
+{
+	PxRigidStatic* body = getPhysics().createRigidStatic(PxTransform(position));
+	body->createShape(PxBoxGeometry(halfsize), *_material);
+	return body;
+}
+
+float 	Simulation::step( float elapsedTime )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	_scene->simulate(elapsedTime);
+	_scene->fetchResults(true);
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+PxFixedJoint* 	createFixedJoint( PxPhysics& physics, JointFactory& factory,
+		PxRigidDynamic* bodyA, const PxVec3& posA, PxRigidDynamic* bodyB, const PxVec3& posB,
+		bool useWorkaround, const JointProjection& projection )
+{
+	//bodyA->clearForce();
+	//bodyA->clearForce(PxForceMode::eIMPULSE);
+	//bodyA->clearTorque();
+	//bodyA->clearTorque(PxForceMode::eIMPULSE);
+	//bodyA->setLinearVelocity(PxVec3(0, 0, 0));
+	//bodyA->setAngularVelocity(PxVec3(0, 0, 0));
+	//PxRigidBodyExt::updateMassAndInertia(*bodyA, 10.f);
+
+	PxTransform otherPXTr = bodyB->getGlobalPose();
+	PxTransform meAnchor( posA, PxQuat(PxIdentity) );
+	PxTransform otherAnchor( posB, PxQuat(PxIdentity) );
+
+	PxTransform newMeTr = meAnchor.getInverse() * otherPXTr * otherAnchor;
+	bodyA->setGlobalPose(newMeTr);
+
+	// the workaround: the filter data of A (only) is restored once the contacts are disabled
+	JointDescs descs;
+	descs.add(JOINT_FIXED, bodyB, otherAnchor, bodyA, meAnchor, useWorkaround? JOINT_KEEP_FILTER_DATA1 : 0);
+	descs.projections[0] = projection;
+	PxJoint* joint = nullptr;
+	factory.create(physics, descs, &joint);
+	return static_cast<PxFixedJoint*>(joint);
+}
+
+std::vector<PxFilterData> 	getFilterData( PxRigidActor* actor )
+{
+	std::vector<PxShape*> 	shapes(actor->getNbShapes());
+	if (!shapes.empty())
+		actor->getShapes(&shapes[0], shapes.size());
+
+	std::vector<PxFilterData> 	filterData(shapes.size());
+	for (size_t i = 0; i < shapes.size(); ++i)
+		filterData[i] = shapes[i]->getSimulationFilterData();
+	return filterData;
+}
+
+void 	BodyArrays::gather( PxRigidDynamic* const* bodies, size_t count )
+{
+	_count = count;
+	_poses.resize(count * POSE_FLOATS);
+	_velocities.resize(count * VELOCITY_FLOATS);
+	_filterData.resize(count * FILTER_WORDS);
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const PxRigidDynamic& body = *bodies[i];
+		const PxTransform pose = body.getGlobalPose();
+		float* p = &_poses[i * POSE_FLOATS];
+		p[0] = pose.p.x; p[1] = pose.p.y; p[2] = pose.p.z;
+		p[3] = pose.q.x; p[4] = pose.q.y; p[5] = pose.q.z; p[6] = pose.q.w;
+
+		const bool kinematic = body.getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC;
+		const PxVec3 linear = kinematic? PxVec3(0.f) : body.getLinearVelocity();
+		const PxVec3 angular = kinematic? PxVec3(0.f) : body.getAngularVelocity();
+		float* v = &_velocities[i * VELOCITY_FLOATS];
+		v[0] = linear.x; v[1] = linear.y; v[2] = linear.z;
+		v[3] = angular.x; v[4] = angular.y; v[5] = angular.z;
+
+		PxShape* shape = nullptr;
+		PxFilterData fd;
+		if (body.getShapes(&shape, 1) == 1)
+			fd = shape->getSimulationFilterData();
+		PxU32* f = &_filterData[i * FILTER_WORDS];
+		f[0] = fd.word0; f[1] = fd.word1; f[2] = fd.word2; f[3] = fd.word3;
+	}
+}
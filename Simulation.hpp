@@ -0,0 +1,98 @@
+
+#ifndef __MCPLANE_SIMULATION_HPP__
+# define __MCPLANE_SIMULATION_HPP__
+
+# include <vector>
+# include <PxPhysicsAPI.h>
+# include "JointFactory.hpp"
+
+struct SimulationSettings
+{
+	physx::PxVec3 							gravity 		= physx::PxVec3(0.f, -9.81f, 0.f);
+	unsigned 								threads 		= 2;        ///< of the default dispatcher
+	physx::PxCpuDispatcher* 				dispatcher 		= nullptr;  ///< used instead of a default one when set
+	physx::PxSimulationFilterShader 		filterShader 	= physx::PxDefaultSimulationFilterShader;
+	physx::PxContactModifyCallback* 		contactModifyCallback 	= nullptr;
+	physx::PxSimulationEventCallback* 		simulationEventCallback = nullptr;
+};
+
+///
+/// Physics core of the demo, without any window: one scene and the objects
+/// it needs.
+///
+/// PhysX allows a single foundation per process, so the foundation, the
+/// physics (with the extensions) and the cooking are shared by every
+/// Simulation: the first init() creates them with HugePageAllocator, the
+/// last deinit() releases them. Enable the huge pages before.
+///
+class Simulation
+{
+	public:
+		bool 	init( const SimulationSettings& settings = SimulationSettings() );
+		void 	deinit( void );
+		bool 	isInit( void ) const { return _scene != nullptr; }
+
+		physx::PxPhysics& 			getPhysics( void );
+		physx::PxCooking* 			getCooking( void );
+		physx::PxScene& 			getScene( void ) { return *_scene; }
+		physx::PxMaterial& 			getMaterial( void ) { return *_material; }
+		/// The description the scene was created from, e.g. for SceneForker.
+		const physx::PxSceneDesc& 	getSceneDesc( void ) const { return _desc; }
+
+		/// Box bodies with the default material, not added to the scene.
+		physx::PxRigidDynamic* 	createBox( float mass, const physx::PxVec3& halfsize, const physx::PxVec3& position,
+				bool kinematic = false );
+		physx::PxRigidStatic* 	createStaticBox( const physx::PxVec3& halfsize, const physx::PxVec3& position );
+
+		/// simulate() then fetchResults(), returns the duration in ms.
+		float 	step( float elapsedTime );
+
+	private:
+		physx::PxDefaultCpuDispatcher* 		_dispatcher = nullptr;
+		physx::PxScene* 					_scene = nullptr;
+		physx::PxMaterial* 					_material = nullptr;
+		physx::PxSceneDesc 					_desc = physx::PxSceneDesc(physx::PxTolerancesScale());
+};
+
+/// Move A so that the anchors meet and join the bodies with a fixed joint,
+/// in the scene of the bodies. With the workaround, the filter data of A is
+/// restored once their contacts are disabled; B keeps what PhysX left.
+physx::PxFixedJoint* 	createFixedJoint( physx::PxPhysics& physics, JointFactory& factory,
+		physx::PxRigidDynamic* bodyA, const physx::PxVec3& posA,
+		physx::PxRigidDynamic* bodyB, const physx::PxVec3& posB,
+		bool useWorkaround, const JointProjection& projection = JointProjection() );
+
+/// Simulation filter data of every shape of the actor, in shape order.
+std::vector<physx::PxFilterData> 	getFilterData( physx::PxRigidActor* actor );
+
+///
+/// Contiguous copies of the state of some bodies, for consumers that read
+/// them in bulk (the Python module maps them as arrays without copy).
+///
+/// Per body: the pose as 7 floats (position xyz, rotation xyzw), the
+/// velocities as 6 floats (linear then angular, 0 for kinematics) and the
+/// filter data of the first shape as 4 words. The storage only moves when
+/// the body count grows.
+///
+class BodyArrays
+{
+	public:
+		static const unsigned 	POSE_FLOATS = 7;
+		static const unsigned 	VELOCITY_FLOATS = 6;
+		static const unsigned 	FILTER_WORDS = 4;
+
+		void 	gather( physx::PxRigidDynamic* const* bodies, size_t count );
+
+		size_t 					size( void ) const { return _count; }
+		const float* 			getPoses( void ) const { return _poses.data(); }
+		const float* 			getVelocities( void ) const { return _velocities.data(); }
+		const physx::PxU32* 	getFilterData( void ) const { return _filterData.data(); }
+
+	private:
+		size_t 						_count = 0;
+		std::vector<float> 			_poses;
+		std::vector<float> 			_velocities;
+		std::vector<physx::PxU32> 	_filterData;
+};
+
+#endif // __MCPLANE_SIMULATION_HPP__
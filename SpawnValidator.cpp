@@ -0,0 +1,238 @@
+
+#include <chrono>
+#include <iostream>
+#include "SpawnValidator.hpp"
+
+using namespace physx;
+
+static PxQueryHitType::Enum 	spawnOverlapPreFilter( PxFilterData, PxFilterData, const void*, PxU32, PxHitFlags& )
+{
+	return PxQueryHitType::eTOUCH; // every overlapping shape is wanted
+}
+
+/// Triggers and query-only shapes do not push anything.
+static bool 	isSolid( const PxShape& shape )
+{
+	return shape.getFlags() & PxShapeFlag::eSIMULATION_SHAPE;
+}
+
+/// Direction and distance moving a out of b, or straight up over b when the
+/// pair has no penetration test.
+static PxVec3 	getPenetration( const PxGeometry& a, const PxTransform& poseA,
+		const PxGeometry& b, const PxTransform& poseB, float separation )
+{
+	PxVec3 direction;
+	PxF32 depth;
+	if (PxGeometryQuery::computePenetration(direction, depth, a, poseA, b, poseB))
+		return direction * (depth + separation);
+
+	const PxBounds3 boundsA = PxGeometryQuery::getWorldBounds(a, poseA, 1.f);
+	const PxBounds3 boundsB = PxGeometryQuery::getWorldBounds(b, poseB, 1.f);
+	return PxVec3(0.f, boundsB.maximum.y - boundsA.minimum.y + separation, 0.f);
+}
+
+void 	SpawnValidator::Push::add( const PxVec3& v )
+{
+	positive = positive.maximum(v.maximum(PxVec3(0.f)));
+	negative = negative.minimum(v.minimum(PxVec3(0.f)));
+}
+
+SpawnValidator::~SpawnValidator( void )
+{
+	reset();
+}
+
+void 	SpawnValidator::add( PxRigidActor& actor, unsigned group )
+{
+	Pending p;
+	p.actor = &actor;
+	p.group = group;
+	p.firstShape = _shapes.size();
+	p.shapeCount = actor.getNbShapes();
+	p.accepted = false;
+	_shapes.resize(p.firstShape + p.shapeCount);
+	if (p.shapeCount)
+		actor.getShapes(&_shapes[p.firstShape], p.shapeCount);
+	_pending.push_back(p);
+}
+
+bool 	SpawnValidator::createQuery( PxScene& scene, unsigned shapes, unsigned maxTouches )
+{
+	if (_batchQuery && _queryScene == &scene && _queryShapes >= shapes && _queryTouches == maxTouches)
+		return true;
+	releaseQuery();
+
+	_results.resize(shapes);
+	_hits.resize(shapes * maxTouches);
+	PxBatchQueryDesc desc(0, 0, shapes);
+	desc.queryMemory.userOverlapResultBuffer = _results.data();
+	desc.queryMemory.userOverlapTouchBuffer = _hits.data();
+	desc.queryMemory.overlapTouchBufferSize = _hits.size();
+	desc.preFilterShader = spawnOverlapPreFilter;
+	_batchQuery = scene.createBatchQuery(desc);
+	if (!_batchQuery)
+	{
+		std::cout << "SpawnValidator: createBatchQuery failed!" << std::endl;
+		return false;
+	}
+	_queryScene = &scene;
+	_queryShapes = shapes;
+	_queryTouches = maxTouches;
+	return true;
+}
+
+void 	SpawnValidator::reset( void )
+{
+	_pending.clear();
+	_shapes.clear();
+	releaseQuery();
+}
+
+void 	SpawnValidator::releaseQuery( void )
+{
+	if (_batchQuery)
+		_batchQuery->release();
+	_batchQuery = nullptr;
+	_queryScene = nullptr;
+	_queryShapes = 0;
+	_queryTouches = 0;
+}
+
+bool 	SpawnValidator::pushOutOfScene( const Pending& p, const PxOverlapQueryResult* results,
+		Push& push, float separation ) const
+{
+	bool overlapping = false;
+	for (unsigned s = 0; s < p.shapeCount; ++s)
+	{
+		const PxShape& shape = *_shapes[p.firstShape + s];
+		if (!isSolid(shape))
+			continue;
+		const PxTransform pose = PxShapeExt::getGlobalPose(shape, *p.actor);
+		for (PxU32 h = 0; h < results[s].nbTouches; ++h)
+		{
+			const PxOverlapHit& hit = results[s].touches[h];
+			if (!isSolid(*hit.shape))
+				continue;
+			overlapping = true;
+			push.add(getPenetration(shape.getGeometry().any(), pose, hit.shape->getGeometry().any(),
+					PxShapeExt::getGlobalPose(*hit.shape, *hit.actor), separation));
+		}
+	}
+	return overlapping;
+}
+
+bool 	SpawnValidator::pushOutOfPending( size_t index, Push& push, float separation ) const
+{
+	const Pending& p = _pending[index];
+	const PxBounds3 bounds = p.actor->getWorldBounds();
+	bool overlapping = false;
+	for (size_t i = 0; i < index; ++i)
+	{
+		const Pending& other = _pending[i];
+		if (!other.accepted || (p.group != 0 && p.group == other.group))
+			continue;
+		if (!bounds.intersects(other.actor->getWorldBounds()))
+			continue;
+
+		for (unsigned s = 0; s < p.shapeCount; ++s)
+		{
+			const PxShape& shape = *_shapes[p.firstShape + s];
+			if (!isSolid(shape))
+				continue;
+			const PxTransform pose = PxShapeExt::getGlobalPose(shape, *p.actor);
+			for (unsigned o = 0; o < other.shapeCount; ++o)
+			{
+				const PxShape& otherShape = *_shapes[other.firstShape + o];
+				if (!isSolid(otherShape))
+					continue;
+				const PxTransform otherPose = PxShapeExt::getGlobalPose(otherShape, *other.actor);
+				if (!PxGeometryQuery::overlap(shape.getGeometry().any(), pose, otherShape.getGeometry().any(), otherPose))
+					continue;
+				overlapping = true;
+				push.add(getPenetration(shape.getGeometry().any(), pose, otherShape.getGeometry().any(), otherPose, separation));
+			}
+		}
+	}
+	return overlapping;
+}
+
+void 	SpawnValidator::flush( PxScene& scene, std::vector<PxRigidActor*>& rejected, const SpawnSettings& settings )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	_lastStats = SpawnStats();
+	_lastStats.checked = _pending.size();
+	if (_pending.empty())
+		return;
+
+	// one overlap per shape, all at the requested poses
+	const bool batched = createQuery(scene, _shapes.size(), settings.maxTouches);
+	if (batched)
+	{
+		const PxQueryFilterData filter(PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC | PxQueryFlag::ePREFILTER);
+		for (const Pending& p : _pending)
+			for (unsigned s = 0; s < p.shapeCount; ++s)
+			{
+				const PxShape& shape = *_shapes[p.firstShape + s];
+				_batchQuery->overlap(shape.getGeometry().any(), PxShapeExt::getGlobalPose(shape, *p.actor),
+						settings.maxTouches, filter);
+			}
+		_batchQuery->execute();
+	}
+
+	// the scene is not changed until the end: later spawns are checked
+	// against the accepted earlier ones directly
+	const PxQueryFilterData recheckFilter(PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC | PxQueryFlag::eNO_BLOCK);
+	std::vector<PxOverlapQueryResult> recheck;
+	std::vector<PxActor*> accepted;
+	accepted.reserve(_pending.size());
+	for (size_t i = 0; i < _pending.size(); ++i)
+	{
+		Pending& p = _pending[i];
+		Push push;
+		bool overlapping = batched && pushOutOfScene(p, &_results[p.firstShape], push, settings.separation);
+		overlapping |= pushOutOfPending(i, push, settings.separation);
+		if (overlapping)
+		{
+			++_lastStats.overlapping;
+			const PxTransform requested = p.actor->getGlobalPose();
+			for (unsigned n = 0; settings.nudge && overlapping && n < settings.maxNudges; ++n)
+			{
+				PxTransform pose = p.actor->getGlobalPose();
+				pose.p += push.get();
+				p.actor->setGlobalPose(pose);
+
+				// the moved actor alone, through the scene
+				push = Push();
+				recheck.resize(p.shapeCount);
+				_recheckHits.resize(p.shapeCount * settings.maxTouches);
+				for (unsigned s = 0; s < p.shapeCount; ++s)
+				{
+					const PxShape& shape = *_shapes[p.firstShape + s];
+					PxOverlapBuffer hits(&_recheckHits[s * settings.maxTouches], settings.maxTouches);
+					scene.overlap(shape.getGeometry().any(), PxShapeExt::getGlobalPose(shape, *p.actor), hits, recheckFilter);
+					recheck[s].touches = hits.touches;
+					recheck[s].nbTouches = hits.nbTouches;
+				}
+				overlapping = pushOutOfScene(p, recheck.data(), push, settings.separation);
+				overlapping |= pushOutOfPending(i, push, settings.separation);
+			}
+			if (overlapping)
+			{
+				p.actor->setGlobalPose(requested);
+				rejected.push_back(p.actor);
+				++_lastStats.rejected;
+				continue;
+			}
+			++_lastStats.nudged;
+		}
+		p.accepted = true;
+		accepted.push_back(p.actor);
+	}
+
+	if (!accepted.empty())
+		scene.addActors(accepted.data(), accepted.size());
+	_pending.clear();
+	_shapes.clear();
+	_lastStats.validateMs = std::chrono::duration<float, std::milli>(
+			std::chrono::high_resolution_clock::now() - start).count();
+}
@@ -0,0 +1,95 @@
+
+#ifndef __MCPLANE_SPAWNVALIDATOR_HPP__
+# define __MCPLANE_SPAWNVALIDATOR_HPP__
+
+# include <vector>
+# include <PxPhysicsAPI.h>
+
+struct SpawnSettings
+{
+	bool 		nudge 			= true;    ///< push overlapping spawns out, or reject them right away
+	unsigned 	maxNudges 		= 4;       ///< then rejected
+	float 		separation 		= 0.01f;   ///< extra distance added to each push
+	unsigned 	maxTouches 		= 16;      ///< scene hits kept per shape
+};
+
+struct SpawnStats
+{
+	unsigned 	checked 		= 0;
+	unsigned 	overlapping 	= 0;  ///< at their requested pose
+	unsigned 	nudged 			= 0;  ///< moved to a free pose
+	unsigned 	rejected 		= 0;
+	float 		validateMs 		= 0.f;
+};
+
+///
+/// Keeps new actors out of the scene until they are checked for overlaps,
+/// so that the solver does not start by pushing them apart.
+///
+/// flush() runs one batched overlap query per shape of every pending actor
+/// against the scene, then checks the pending actors against each other in
+/// spawn order (the earlier one stays). An overlapping actor is pushed out
+/// along the penetration directions and checked again, up to maxNudges
+/// times; the accepted ones go in the scene with a single addActors().
+///
+/// Actors added with the same non-zero group (e.g. welded parts) may overlap
+/// each other.
+///
+class SpawnValidator
+{
+	public:
+		~SpawnValidator( void );
+
+		/// The actor must not be in a scene yet.
+		void 	add( physx::PxRigidActor& actor, unsigned group = 0 );
+		size_t 	getPendingCount( void ) const { return _pending.size(); }
+
+		/// Rejected actors are appended to rejected, not released nor added.
+		void 	flush( physx::PxScene& scene, std::vector<physx::PxRigidActor*>& rejected,
+				const SpawnSettings& settings = SpawnSettings() );
+
+		const SpawnStats& 	getLastStats( void ) const { return _lastStats; }
+
+		/// Forget the pending actors and release the query, before the scene goes.
+		void 	reset( void );
+
+	private:
+		struct Pending
+		{
+			physx::PxRigidActor* 	actor;
+			unsigned 				group;
+			unsigned 				firstShape;  ///< in _shapes
+			unsigned 				shapeCount;
+			bool 					accepted;
+		};
+
+		/// Penetrations are not summed: the largest one wins on each axis.
+		struct Push
+		{
+			physx::PxVec3 	positive = physx::PxVec3(0.f);
+			physx::PxVec3 	negative = physx::PxVec3(0.f);
+
+			void 			add( const physx::PxVec3& v );
+			physx::PxVec3 	get( void ) const { return positive + negative; }
+		};
+
+		bool 	createQuery( physx::PxScene& scene, unsigned shapes, unsigned maxTouches );
+		void 	releaseQuery( void );
+		bool 	pushOutOfScene( const Pending& p, const physx::PxOverlapQueryResult* results, Push& push, float separation ) const;
+		bool 	pushOutOfPending( size_t index, Push& push, float separation ) const;
+
+		std::vector<Pending> 					_pending;
+		std::vector<physx::PxShape*> 			_shapes;
+
+		physx::PxScene* 						_queryScene = nullptr;
+		physx::PxBatchQuery* 					_batchQuery = nullptr;
+		unsigned 								_queryShapes = 0;
+		unsigned 								_queryTouches = 0;  ///< per shape
+		std::vector<physx::PxOverlapQueryResult> 	_results;
+		std::vector<physx::PxOverlapHit> 			_hits;
+		std::vector<physx::PxOverlapHit> 			_recheckHits;
+
+		SpawnStats 								_lastStats;
+};
+
+#endif // __MCPLANE_SPAWNVALIDATOR_HPP__
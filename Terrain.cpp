@@ -0,0 +1,301 @@
+
+#include <cmath>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include "Terrain.hpp"
+
+using namespace physx;
+
+//// Terrain function ////
+
+static float 	hash2( int x, int z )
+{
+	uint32_t h = (uint32_t)x * 374761393u + (uint32_t)z * 668265263u;
+	h = (h ^ (h >> 13)) * 1274126177u;
+	return ((h ^ (h >> 16)) & 0xffff) / 65535.f;
+}
+
+static float 	valueNoise( float x, float z )
+{
+	int xi = (int)std::floor(x);
+	int zi = (int)std::floor(z);
+	float fx = x - xi;
+	float fz = z - zi;
+	fx = fx * fx * (3.f - 2.f * fx);
+	fz = fz * fz * (3.f - 2.f * fz);
+
+	float a = hash2(xi, zi) + (hash2(xi + 1, zi) - hash2(xi, zi)) * fx;
+	float b = hash2(xi, zi + 1) + (hash2(xi + 1, zi + 1) - hash2(xi, zi + 1)) * fx;
+	return a + (b - a) * fz;
+}
+
+float 	Terrain::getHeight( float x, float z ) const
+{
+	float h = 0.f;
+	float amplitude = 6.f;
+	float frequency = 1.f / 40.f;
+	for (int octave = 0; octave < 4; ++octave)
+	{
+		h += amplitude * valueNoise(x * frequency, z * frequency);
+		amplitude *= 0.5f;
+		frequency *= 2.f;
+	}
+
+	// flat around the origin, then smoothly rising hills
+	float d = std::sqrt(x * x + z * z);
+	float t = std::min(std::max((d - _settings.plateauRadius) / _settings.plateauRadius, 0.f), 1.f);
+	t = t * t * (3.f - 2.f * t);
+	return _settings.plateauHeight + t * h;
+}
+
+//// Terrain ////
+
+bool 	Terrain::init( PxPhysics& physics, PxScene& scene, PxMaterial& material, const TerrainSettings& settings )
+{
+	if (_physics)
+		return false; // already init
+
+	if (settings.samplesPerSide < 2 || settings.maxTiles == 0)
+	{
+		std::cout << "invalid terrain settings" << std::endl;
+		return false;
+	}
+
+	_physics = &physics;
+	_scene = &scene;
+	_material = &material;
+	_settings = settings;
+
+	_freeSlots.clear();
+	for (unsigned i = settings.maxTiles; i > 0; --i)
+		_freeSlots.push_back(i - 1);
+
+	_stopping = false;
+	_worker = std::thread(&Terrain::workerLoop, this);
+	return true;
+}
+
+void 	Terrain::deinit( void )
+{
+	if (!_physics)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+		_requests.clear();
+	}
+	_cond.notify_one();
+	_worker.join();
+
+	for (Tile& tile : _ready)
+		releaseTile(tile);
+	_ready.clear();
+	for (auto& it : _resident)
+		releaseTile(it.second);
+	_resident.clear();
+	_pending.clear();
+
+	_physics = nullptr;
+	_scene = nullptr;
+	_material = nullptr;
+}
+
+void 	Terrain::update( const PxVec3* pointsOfInterest, size_t count )
+{
+	const float tileSize = getTileSize();
+	const int radius = _settings.loadRadius;
+
+	_centers.clear();
+	for (size_t i = 0; i < count; ++i)
+	{
+		TileKey key((int)std::floor(pointsOfInterest[i].x / tileSize),
+				(int)std::floor(pointsOfInterest[i].z / tileSize));
+		if (std::find(_centers.begin(), _centers.end(), key) == _centers.end())
+			_centers.push_back(key);
+	}
+
+	// Evict the tiles out of reach, with one tile of hysteresis
+	for (auto it = _resident.begin(); it != _resident.end(); )
+	{
+		if (isWanted(it->first, radius + 1))
+		{
+			++it;
+			continue;
+		}
+		_freeSlots.push_back(it->second.slot);
+		releaseTile(it->second);
+		it = _resident.erase(it);
+	}
+
+	// Swap in the tiles built since the last update
+	std::deque<Tile> ready;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		ready.swap(_ready);
+	}
+	for (Tile& tile : ready)
+	{
+		_pending.erase(tile.key);
+		if (!tile.heightField || !isWanted(tile.key, radius + 1) || _freeSlots.empty())
+		{
+			releaseTile(tile);
+			continue;
+		}
+
+		PxTransform pose(PxVec3(tile.key.first * tileSize, 0.f, tile.key.second * tileSize));
+		tile.actor = _physics->createRigidStatic(pose);
+		tile.actor->createShape(PxHeightFieldGeometry(tile.heightField, PxMeshGeometryFlags(),
+					_settings.heightScale, _settings.cellSize, _settings.cellSize), *_material);
+		_scene->addActor(*tile.actor);
+
+		tile.slot = _freeSlots.back();
+		_freeSlots.pop_back();
+		tile.id = _nextId++;
+		_resident[tile.key] = tile;
+	}
+
+	// Request the missing tiles, closest first, without exceeding maxTiles
+	if (_freeSlots.size() <= _pending.size())
+		return;
+	size_t budget = _freeSlots.size() - _pending.size();
+
+	std::vector<std::pair<int, TileKey>> missing;
+	for (const TileKey& c : _centers)
+		for (int dx = -radius; dx <= radius; ++dx)
+			for (int dz = -radius; dz <= radius; ++dz)
+			{
+				TileKey key(c.first + dx, c.second + dz);
+				if (_resident.count(key) || _pending.count(key))
+					continue;
+				missing.push_back(std::make_pair(dx * dx + dz * dz, key));
+			}
+	std::sort(missing.begin(), missing.end());
+	missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (size_t i = 0; i < missing.size() && budget > 0; ++i)
+	{
+		if (!_pending.insert(missing[i].second).second)
+			continue; // same tile around two points of interest
+		_requests.push_back(missing[i].second);
+		--budget;
+	}
+	_cond.notify_one();
+}
+
+void 	Terrain::load( const PxVec3* pointsOfInterest, size_t count )
+{
+	update(pointsOfInterest, count);
+	while (!_pending.empty())
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		update(pointsOfInterest, count);
+	}
+}
+
+bool 	Terrain::isResident( float x, float z ) const
+{
+	const float tileSize = getTileSize();
+	return _resident.count(TileKey((int)std::floor(x / tileSize), (int)std::floor(z / tileSize))) != 0;
+}
+
+void 	Terrain::fillRenderData( TerrainRenderData& data ) const
+{
+	data.samplesPerSide = _settings.samplesPerSide;
+	data.maxTiles = _settings.maxTiles;
+	data.cellSize = _settings.cellSize;
+	data.patches.clear();
+	data.patches.reserve(_resident.size());
+
+	const float tileSize = getTileSize();
+	for (const auto& it : _resident)
+	{
+		const Tile& tile = it.second;
+		TerrainPatch patch;
+		patch.origin = vec2(tile.key.first * tileSize, tile.key.second * tileSize);
+		patch.slot = tile.slot;
+		patch.id = tile.id;
+		patch.heights = tile.heights;
+		data.patches.push_back(patch);
+	}
+}
+
+void 	Terrain::workerLoop( void )
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true)
+	{
+		_cond.wait(lock, [this]{ return _stopping || !_requests.empty(); });
+		if (_stopping)
+			break;
+
+		Tile tile;
+		tile.key = _requests.front();
+		_requests.pop_front();
+		lock.unlock();
+
+		buildTile(tile);
+
+		lock.lock();
+		_ready.push_back(tile);
+	}
+}
+
+void 	Terrain::buildTile( Tile& tile ) const
+{
+	const unsigned n = _settings.samplesPerSide;
+	const float tileSize = getTileSize();
+	const float originX = tile.key.first * tileSize;
+	const float originZ = tile.key.second * tileSize;
+
+	std::vector<PxHeightFieldSample> 	samples(n * n);
+	std::shared_ptr<std::vector<float>> heights(new std::vector<float>(n * n));
+
+	for (unsigned row = 0; row < n; ++row)
+		for (unsigned col = 0; col < n; ++col)
+		{
+			float h = getHeight(originX + row * _settings.cellSize, originZ + col * _settings.cellSize);
+			float q = std::min(std::max(std::round(h / _settings.heightScale), -32768.f), 32767.f);
+
+			PxHeightFieldSample& s = samples[row * n + col];
+			s.height = (PxI16)q;
+			s.materialIndex0 = 0;
+			s.materialIndex1 = 0;
+
+			// render the quantized height, exactly what the physics sees
+			(*heights)[row * n + col] = q * _settings.heightScale;
+		}
+
+	PxHeightFieldDesc desc;
+	desc.format = PxHeightFieldFormat::eS16_TM;
+	desc.nbRows = n;
+	desc.nbColumns = n;
+	desc.samples.data = samples.data();
+	desc.samples.stride = sizeof(PxHeightFieldSample);
+
+	tile.heightField = _physics->createHeightField(desc);
+	tile.heights = heights;
+	if (!tile.heightField)
+		std::cout << "failed to create terrain tile " << tile.key.first << ", " << tile.key.second << std::endl;
+}
+
+void 	Terrain::releaseTile( Tile& tile )
+{
+	if (tile.actor)
+		tile.actor->release();
+	if (tile.heightField)
+		tile.heightField->release();
+	tile.actor = nullptr;
+	tile.heightField = nullptr;
+	tile.heights.reset();
+}
+
+bool 	Terrain::isWanted( const TileKey& key, int radius ) const
+{
+	for (const TileKey& c : _centers)
+		if (std::abs(key.first - c.first) <= radius && std::abs(key.second - c.second) <= radius)
+			return true;
+	return false;
+}
@@ -0,0 +1,98 @@
+
+#ifndef __MCPLANE_TERRAIN_HPP__
+# define __MCPLANE_TERRAIN_HPP__
+
+# include <map>
+# include <set>
+# include <deque>
+# include <vector>
+# include <thread>
+# include <mutex>
+# include <condition_variable>
+# include <PxPhysicsAPI.h>
+# include "Graphics.hpp"
+
+struct TerrainSettings
+{
+	unsigned 	samplesPerSide 	= 33;    ///< per tile, neighbours share their edge samples
+	float 		cellSize 		= 2.f;
+	float 		heightScale 	= 0.01f; ///< meters per heightfield unit
+	int 		loadRadius 		= 2;     ///< in tiles around each point of interest
+	unsigned 	maxTiles 		= 64;
+	float 		plateauHeight 	= 0.5f;  ///< flat area around the origin
+	float 		plateauRadius 	= 30.f;
+};
+
+///
+/// Heightfield ground made of square tiles streamed around points of interest.
+///
+/// Tile heights are generated and their PxHeightField created on a background
+/// thread; update() swaps finished tiles into the scene and evicts far ones,
+/// so it must be called between fetchResults() and the next simulate().
+/// The number of resident tiles is bounded (maxTiles), which bounds memory
+/// whatever the size of the world.
+///
+class Terrain
+{
+	public:
+		bool 	init( physx::PxPhysics& physics, physx::PxScene& scene, physx::PxMaterial& material,
+				const TerrainSettings& settings = TerrainSettings() );
+		void 	deinit( void );
+
+		/// Stream tiles around the given points, between two simulation steps.
+		void 	update( const physx::PxVec3* pointsOfInterest, size_t count );
+		/// Same as update() but blocks until every wanted tile is in the scene.
+		void 	load( const physx::PxVec3* pointsOfInterest, size_t count );
+
+		/// Height of the (unquantized) terrain function.
+		float 	getHeight( float x, float z ) const;
+
+		float 	getTileSize( void ) const { return (_settings.samplesPerSide - 1) * _settings.cellSize; }
+		size_t 	getResidentCount( void ) const { return _resident.size(); }
+		/// Whether tiles are still being built for the scene.
+		bool 	isStreaming( void ) const { return !_pending.empty(); }
+		/// Whether the tile under a point is in the scene.
+		bool 	isResident( float x, float z ) const;
+
+		/// Patches of the resident tiles, for the render packet.
+		void 	fillRenderData( TerrainRenderData& data ) const;
+
+	private:
+		using TileKey = std::pair<int, int>;
+
+		struct Tile
+		{
+			TileKey 						key;
+			physx::PxHeightField* 			heightField = nullptr;
+			physx::PxRigidStatic* 			actor = nullptr;
+			TerrainPatch::Heights 			heights;
+			unsigned 						slot = 0;
+			unsigned 						id = 0;
+		};
+
+		void 	workerLoop( void );
+		void 	buildTile( Tile& tile ) const;
+		void 	releaseTile( Tile& tile );
+		bool 	isWanted( const TileKey& key, int radius ) const;
+
+		physx::PxPhysics* 		_physics = nullptr;
+		physx::PxScene* 		_scene = nullptr;
+		physx::PxMaterial* 		_material = nullptr;
+		TerrainSettings 		_settings;
+
+		std::map<TileKey, Tile> 		_resident;
+		std::vector<unsigned> 			_freeSlots;
+		std::vector<TileKey> 			_centers;  ///< tiles holding the current points of interest
+		unsigned 						_nextId = 1;
+
+		// shared with the worker thread
+		std::thread 					_worker;
+		std::mutex 						_mutex;
+		std::condition_variable 		_cond;
+		std::deque<TileKey> 			_requests;
+		std::deque<Tile> 				_ready;
+		std::set<TileKey> 				_pending;  ///< requested or being built
+		bool 							_stopping = false;
+};
+
+#endif // __MCPLANE_TERRAIN_HPP__
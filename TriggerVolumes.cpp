@@ -0,0 +1,94 @@
+
+#include <vector>
+#include "TriggerVolumes.hpp"
+
+using namespace physx;
+
+TriggerVolumes::TriggerVolumes( size_t capacity )
+{
+	_writing.reserve(capacity);
+	_collected.reserve(capacity);
+}
+
+PxShape* 	TriggerVolumes::createTriggerShape( PxRigidActor& actor, const PxGeometry& geometry,
+		const PxMaterial& material, PxU32 groups )
+{
+	PxShape* shape = actor.createShape(geometry, material);
+	if (!shape)
+		return nullptr;
+	shape->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);
+	shape->setFlag(PxShapeFlag::eTRIGGER_SHAPE, true);
+
+	PxFilterData fd = shape->getSimulationFilterData();
+	fd.word1 = (fd.word1 & ~GROUP_MASK) | ((groups << GROUP_SHIFT) & GROUP_MASK);
+	shape->setSimulationFilterData(fd);
+	return shape;
+}
+
+void 	TriggerVolumes::setActorGroups( PxRigidActor& actor, PxU32 groups )
+{
+	std::vector<PxShape*> shapes(actor.getNbShapes());
+	if (shapes.empty())
+		return;
+	actor.getShapes(&shapes[0], shapes.size());
+
+	for (PxShape* shape : shapes)
+	{
+		PxFilterData fd = shape->getSimulationFilterData();
+		fd.word1 = (fd.word1 & ~GROUP_MASK) | ((groups << GROUP_SHIFT) & GROUP_MASK);
+		shape->setSimulationFilterData(fd);
+	}
+
+	// pairs already found keep their flags until filtered again
+	if (actor.getScene())
+		actor.getScene()->resetFiltering(actor);
+}
+
+bool 	TriggerVolumes::filterPair( PxFilterObjectAttributes attributes0, const PxFilterData& filterData0,
+		PxFilterObjectAttributes attributes1, const PxFilterData& filterData1 )
+{
+	const bool trigger0 = PxFilterObjectIsTrigger(attributes0);
+	const bool trigger1 = PxFilterObjectIsTrigger(attributes1);
+	if (!trigger0 && !trigger1)
+		return true;
+	if (trigger0 && trigger1)
+		return false; // trigger against trigger reports nothing
+
+	const PxU32 triggerGroups = (trigger0? filterData0 : filterData1).word1 & GROUP_MASK;
+	const PxU32 otherGroups = (trigger0? filterData1 : filterData0).word1 & GROUP_MASK;
+	return !triggerGroups || (triggerGroups & otherGroups);
+}
+
+TriggerSpan 	TriggerVolumes::collect( void )
+{
+	_collected.swap(_writing);
+	_writing.clear();
+
+	TriggerSpan span;
+	span.data = _collected.data();
+	span.size = _collected.size();
+	return span;
+}
+
+void 	TriggerVolumes::onTrigger( PxTriggerPair* pairs, PxU32 count )
+{
+	for (PxU32 i = 0; i < count; ++i)
+	{
+		const PxTriggerPair& pair = pairs[i];
+		if (pair.flags & (PxTriggerPairFlag::eREMOVED_SHAPE_TRIGGER | PxTriggerPairFlag::eREMOVED_SHAPE_OTHER))
+			continue; // released since, nothing left to report on
+		if (_writing.size() == _writing.capacity())
+		{
+			_dropped += count - i;
+			return;
+		}
+
+		TriggerEvent e;
+		e.trigger = pair.triggerShape;
+		e.triggerActor = pair.triggerShape->getActor();
+		e.other = pair.otherShape;
+		e.otherActor = pair.otherShape->getActor();
+		e.entered = (pair.status == PxPairFlag::eNOTIFY_TOUCH_FOUND);
+		_writing.push_back(e);
+	}
+}
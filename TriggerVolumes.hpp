@@ -0,0 +1,78 @@
+
+#ifndef __MCPLANE_TRIGGERVOLUMES_HPP__
+# define __MCPLANE_TRIGGERVOLUMES_HPP__
+
+# include <vector>
+# include <PxPhysicsAPI.h>
+
+/// A shape entering or leaving a trigger volume.
+struct TriggerEvent
+{
+	physx::PxShape* 		trigger;
+	physx::PxRigidActor* 	triggerActor;
+	physx::PxShape* 		other;
+	physx::PxRigidActor* 	otherActor;
+	bool 					entered;  ///< false when it left
+};
+
+/// Contiguous view of the events of a step.
+struct TriggerSpan
+{
+	const TriggerEvent* 	data = nullptr;
+	size_t 					size = 0;
+
+	const TriggerEvent* 	begin( void ) const { return data; }
+	const TriggerEvent* 	end( void ) const { return data + size; }
+	bool 					empty( void ) const { return size == 0; }
+};
+
+///
+/// Trigger volumes and their events.
+///
+/// Bits 16 to 31 of the simulation filter data word1 are trigger groups
+/// (bits 0 to 7 are the contact tuning groups). A trigger shape with groups
+/// only reports the shapes sharing one of them, a trigger shape without
+/// any reports every shape. The pairs that do not match are suppressed in
+/// filterPair(), before any event exists.
+///
+/// onTrigger(), called from fetchResults(), writes the events of a step
+/// into a buffer allocated once: when it is full the extra events are
+/// counted and dropped. After fetchResults(), collect() hands the events of
+/// the step over as a span, valid until the next collect().
+///
+class TriggerVolumes : public physx::PxSimulationEventCallback
+{
+	public:
+		static const unsigned 		GROUP_SHIFT = 16;
+		static const physx::PxU32 	GROUP_MASK = 0xffffu << GROUP_SHIFT;
+
+		explicit TriggerVolumes( size_t capacity = 4096 );
+
+		/// Trigger shape with the given groups (0 for every shape).
+		static physx::PxShape* 	createTriggerShape( physx::PxRigidActor& actor, const physx::PxGeometry& geometry,
+				const physx::PxMaterial& material, physx::PxU32 groups = 0 );
+		/// Set the trigger groups of every shape of the actor (other filter data is kept).
+		static void 			setActorGroups( physx::PxRigidActor& actor, physx::PxU32 groups );
+
+		/// False when a trigger pair must be suppressed, to call first in the scene filter shader.
+		static bool 	filterPair( physx::PxFilterObjectAttributes attributes0, const physx::PxFilterData& filterData0,
+				physx::PxFilterObjectAttributes attributes1, const physx::PxFilterData& filterData1 );
+
+		/// Events since the previous call.
+		TriggerSpan 	collect( void );
+		/// Events dropped by the last collected steps, then reset.
+		unsigned 		collectDropped( void ) { unsigned d = _dropped; _dropped = 0; return d; }
+
+		void 	onTrigger( physx::PxTriggerPair* pairs, physx::PxU32 count ) override;
+		void 	onConstraintBreak( physx::PxConstraintInfo*, physx::PxU32 ) override {}
+		void 	onWake( physx::PxActor**, physx::PxU32 ) override {}
+		void 	onSleep( physx::PxActor**, physx::PxU32 ) override {}
+		void 	onContact( const physx::PxContactPairHeader&, const physx::PxContactPair*, physx::PxU32 ) override {}
+
+	private:
+		std::vector<TriggerEvent> 	_writing;  ///< filled during fetchResults()
+		std::vector<TriggerEvent> 	_collected;
+		unsigned 					_dropped = 0;
+};
+
+#endif // __MCPLANE_TRIGGERVOLUMES_HPP__
@@ -0,0 +1,232 @@
+
+#include <cmath>
+#include <chrono>
+#include <iostream>
+#include "Vehicles.hpp"
+
+using namespace physx;
+
+// Query filter data word3 of the vehicle shapes: their own suspension
+// raycasts must not hit them. Everything else is drivable.
+#define UNDRIVABLE_SURFACE 	0xffff0000
+
+static PxQueryHitType::Enum 	wheelRaycastPreFilter( PxFilterData, PxFilterData objectFilterData, const void*, PxU32, PxHitFlags& )
+{
+	return (objectFilterData.word3 == UNDRIVABLE_SURFACE)? PxQueryHitType::eNONE : PxQueryHitType::eBLOCK;
+}
+
+bool 	Vehicles::init( PxPhysics& physics, PxScene& scene, PxMaterial& drivableMaterial,
+		unsigned maxVehicles, const VehicleSettings& settings )
+{
+	if (_physics)
+		return false; // already init
+
+	if (maxVehicles == 0)
+		return false;
+
+	if (!PxInitVehicleSDK(physics))
+	{
+		std::cout << "PxInitVehicleSDK failed!" << std::endl;
+		return false;
+	}
+	PxVehicleSetBasisVectors(PxVec3(0.f, 1.f, 0.f), PxVec3(0.f, 0.f, 1.f));
+
+	_physics = &physics;
+	_scene = &scene;
+	_material = &drivableMaterial;
+	_settings = settings;
+	_capacity = maxVehicles;
+	_time = 0.f;
+
+	setupWheels();
+
+	// One surface type, one tire type
+	const PxMaterial* surfaceMaterials[1] = { _material };
+	PxVehicleDrivableSurfaceType surfaceTypes[1];
+	surfaceTypes[0].mType = 0;
+	_frictionPairs = PxVehicleDrivableSurfaceToTireFrictionPairs::allocate(1, 1);
+	_frictionPairs->setup(1, 1, surfaceMaterials, surfaceTypes);
+	_frictionPairs->setTypePairFriction(0, 0, 1.f);
+
+	// Everything the per-step update needs
+	const PxU32 raycasts = maxVehicles * WHEEL_COUNT;
+	_raycastResults.resize(raycasts);
+	_raycastHits.resize(raycasts);
+	_wheelResults.resize(raycasts);
+	_vehicleResults.resize(maxVehicles);
+	for (unsigned i = 0; i < maxVehicles; ++i)
+	{
+		_vehicleResults[i].wheelQueryResults = &_wheelResults[i * WHEEL_COUNT];
+		_vehicleResults[i].nbWheelQueryResults = WHEEL_COUNT;
+	}
+	_vehicles.reserve(maxVehicles);
+
+	PxBatchQueryDesc desc(raycasts, 0, 0);
+	desc.queryMemory.userRaycastResultBuffer = _raycastResults.data();
+	desc.queryMemory.userRaycastTouchBuffer = _raycastHits.data();
+	desc.queryMemory.raycastTouchBufferSize = raycasts;
+	desc.preFilterShader = wheelRaycastPreFilter;
+	_batchQuery = scene.createBatchQuery(desc);
+	if (!_batchQuery)
+	{
+		std::cout << "createBatchQuery failed!" << std::endl;
+		deinit();
+		return false;
+	}
+	return true;
+}
+
+void 	Vehicles::deinit( void )
+{
+	if (!_physics)
+		return;
+
+	for (PxVehicleWheels* vehicle : _vehicles)
+	{
+		vehicle->getRigidDynamicActor()->release();
+		vehicle->free();
+	}
+	_vehicles.clear();
+
+	if (_batchQuery)
+		_batchQuery->release();
+	_batchQuery = nullptr;
+	_raycastResults.clear();
+	_raycastHits.clear();
+	_wheelResults.clear();
+	_vehicleResults.clear();
+
+	if (_frictionPairs)
+		_frictionPairs->release();
+	_frictionPairs = nullptr;
+	if (_wheelsSimData)
+		_wheelsSimData->free();
+	_wheelsSimData = nullptr;
+
+	PxCloseVehicleSDK();
+	_physics = nullptr;
+	_scene = nullptr;
+	_material = nullptr;
+}
+
+void 	Vehicles::setupWheels( void )
+{
+	const PxVec3& he = _settings.chassisHalfExtents;
+	const float r = _settings.wheelRadius;
+
+	// wheel centers relative to the chassis, at the bottom corners
+	_wheelOffsets[0] = PxVec3(-he.x, -he.y, he.z * 0.7f);
+	_wheelOffsets[1] = PxVec3(he.x, -he.y, he.z * 0.7f);
+	_wheelOffsets[2] = PxVec3(-he.x, -he.y, -he.z * 0.7f);
+	_wheelOffsets[3] = PxVec3(he.x, -he.y, -he.z * 0.7f);
+	_centerOfMass = PxVec3(0.f, -he.y * 0.5f, 0.f);
+
+	PxVec3 offsets[WHEEL_COUNT];
+	for (unsigned i = 0; i < WHEEL_COUNT; ++i)
+		offsets[i] = _wheelOffsets[i] - _centerOfMass;
+	float sprungMasses[WHEEL_COUNT];
+	PxVehicleComputeSprungMasses(WHEEL_COUNT, offsets, PxVec3(0.f), _settings.chassisMass, 1, sprungMasses);
+
+	_wheelsSimData = PxVehicleWheelsSimData::allocate(WHEEL_COUNT);
+	for (unsigned i = 0; i < WHEEL_COUNT; ++i)
+	{
+		const bool front = (i < 2);
+
+		PxVehicleWheelData wheel;
+		wheel.mRadius = r;
+		wheel.mWidth = _settings.wheelWidth;
+		wheel.mMass = _settings.wheelMass;
+		wheel.mMOI = 0.5f * _settings.wheelMass * r * r;
+		wheel.mMaxSteer = front? _settings.maxSteer : 0.f;
+		wheel.mMaxHandBrakeTorque = front? 0.f : 4000.f;
+
+		PxVehicleTireData tire;
+		tire.mType = 0;
+
+		PxVehicleSuspensionData suspension;
+		suspension.mMaxCompression = _settings.maxCompression;
+		suspension.mMaxDroop = _settings.maxDroop;
+		suspension.mSpringStrength = _settings.springStrength;
+		suspension.mSpringDamperRate = _settings.springDamperRate;
+		suspension.mSprungMass = sprungMasses[i];
+
+		PxFilterData queryFilterData;
+		queryFilterData.word3 = UNDRIVABLE_SURFACE;
+
+		_wheelsSimData->setWheelData(i, wheel);
+		_wheelsSimData->setTireData(i, tire);
+		_wheelsSimData->setSuspensionData(i, suspension);
+		_wheelsSimData->setSuspTravelDirection(i, PxVec3(0.f, -1.f, 0.f));
+		_wheelsSimData->setWheelCentreOffset(i, offsets[i]);
+		_wheelsSimData->setSuspForceAppPointOffset(i, PxVec3(offsets[i].x, -0.3f, offsets[i].z));
+		_wheelsSimData->setTireForceAppPointOffset(i, PxVec3(offsets[i].x, -0.3f, offsets[i].z));
+		_wheelsSimData->setSceneQueryFilterData(i, queryFilterData);
+		_wheelsSimData->setWheelShapeMapping(i, i);
+	}
+}
+
+bool 	Vehicles::spawn( const PxTransform& pose )
+{
+	if (_vehicles.size() >= _capacity)
+		return false;
+
+	const PxVec3& he = _settings.chassisHalfExtents;
+	PxFilterData queryFilterData;
+	queryFilterData.word3 = UNDRIVABLE_SURFACE;
+
+	// Shapes 0 to 3 are the wheels (moved by the vehicle SDK), 4 the chassis
+	PxRigidDynamic* actor = _physics->createRigidDynamic(pose);
+	for (unsigned i = 0; i < WHEEL_COUNT; ++i)
+	{
+		PxShape* wheel = actor->createShape(PxSphereGeometry(_settings.wheelRadius), *_material,
+				PxTransform(_wheelOffsets[i]));
+		wheel->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);
+		wheel->setQueryFilterData(queryFilterData);
+	}
+	PxShape* chassis = actor->createShape(PxBoxGeometry(he), *_material);
+	chassis->setQueryFilterData(queryFilterData);
+
+	const float m = _settings.chassisMass;
+	actor->setMass(m);
+	actor->setMassSpaceInertiaTensor(PxVec3(he.y * he.y + he.z * he.z, he.x * he.x + he.z * he.z,
+				he.x * he.x + he.y * he.y) * (m / 3.f));
+	actor->setCMassLocalPose(PxTransform(_centerOfMass));
+
+	PxVehicleNoDrive* vehicle = PxVehicleNoDrive::allocate(WHEEL_COUNT);
+	vehicle->setup(_physics, actor, *_wheelsSimData);
+	vehicle->setToRestState();
+	_scene->addActor(*actor);
+
+	_vehicles.push_back(vehicle);
+	return true;
+}
+
+void 	Vehicles::update( float elapsedTime )
+{
+	if (_vehicles.empty())
+		return;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	_time += elapsedTime;
+
+	// Drive in slowly changing curves, each vehicle with its own phase
+	for (size_t i = 0; i < _vehicles.size(); ++i)
+	{
+		PxVehicleNoDrive* vehicle = static_cast<PxVehicleNoDrive*>(_vehicles[i]);
+		float steer = _settings.maxSteer * 0.5f * std::sin(_time * 0.4f + i * 0.7f);
+		vehicle->setSteerAngle(0, steer);
+		vehicle->setSteerAngle(1, steer);
+		vehicle->setDriveTorque(2, _settings.driveTorque);
+		vehicle->setDriveTorque(3, _settings.driveTorque);
+	}
+
+	const PxU32 count = _vehicles.size();
+	PxVehicleSuspensionRaycasts(_batchQuery, count, _vehicles.data(), count * WHEEL_COUNT, _raycastResults.data());
+	auto raycastEnd = std::chrono::high_resolution_clock::now();
+
+	PxVehicleUpdates(elapsedTime, _scene->getGravity(), *_frictionPairs, count, _vehicles.data(), _vehicleResults.data());
+
+	auto end = std::chrono::high_resolution_clock::now();
+	_lastRaycastMs = std::chrono::duration<float, std::milli>(raycastEnd - start).count();
+	_lastUpdateMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
@@ -0,0 +1,87 @@
+
+#ifndef __MCPLANE_VEHICLES_HPP__
+# define __MCPLANE_VEHICLES_HPP__
+
+# include <vector>
+# include <PxPhysicsAPI.h>
+
+struct VehicleSettings
+{
+	physx::PxVec3 	chassisHalfExtents 	= physx::PxVec3(0.9f, 0.4f, 2.f);
+	float 			chassisMass 		= 1200.f;
+	float 			wheelRadius 		= 0.4f;
+	float 			wheelWidth 			= 0.3f;
+	float 			wheelMass 			= 20.f;
+	float 			maxSteer 			= 0.6f;    ///< radians, front wheels
+	float 			driveTorque 		= 400.f;   ///< per rear wheel
+	float 			springStrength 		= 35000.f;
+	float 			springDamperRate 	= 4500.f;
+	float 			maxCompression 		= 0.3f;
+	float 			maxDroop 			= 0.1f;
+};
+
+///
+/// Four-wheeled vehicles (PxVehicleNoDrive) driving around on their own.
+///
+/// Every buffer the per-step update needs (batch query, raycast results and
+/// hits, wheel query results) is allocated by init() for maxVehicles, so
+/// update() does not allocate: it sets the inputs, runs the suspension
+/// raycasts of all vehicles as one batch query, then a single
+/// PxVehicleUpdates() call. It must be called between fetchResults() and
+/// the next simulate().
+///
+/// The chassis actors have no userData. Their shapes 0 to WHEEL_COUNT - 1
+/// are the wheels (spheres, posed by the vehicle SDK), the last one the
+/// chassis box. Drawing them is left to the caller.
+///
+class Vehicles
+{
+	public:
+		static const unsigned WHEEL_COUNT = 4;  ///< front left, front right, rear left, rear right
+
+		bool 	init( physx::PxPhysics& physics, physx::PxScene& scene, physx::PxMaterial& drivableMaterial,
+				unsigned maxVehicles, const VehicleSettings& settings = VehicleSettings() );
+		void 	deinit( void );
+
+		/// Returns false once maxVehicles are spawned. The pose is the chassis' at rest.
+		bool 	spawn( const physx::PxTransform& pose );
+
+		void 	update( float elapsedTime );
+
+		size_t 		size( void ) const { return _vehicles.size(); }
+		unsigned 	getCapacity( void ) const { return _capacity; }
+		float 		getLastRaycastMs( void ) const { return _lastRaycastMs; }
+		float 		getLastUpdateMs( void ) const { return _lastUpdateMs; }  ///< raycasts included
+
+		physx::PxRigidDynamic* 	getActor( size_t i ) const { return _vehicles[i]->getRigidDynamicActor(); }
+		const VehicleSettings& 	getSettings( void ) const { return _settings; }
+
+	private:
+		void 	setupWheels( void );
+
+		physx::PxPhysics* 		_physics = nullptr;
+		physx::PxScene* 		_scene = nullptr;
+		physx::PxMaterial* 		_material = nullptr;
+		VehicleSettings 		_settings;
+		unsigned 				_capacity = 0;
+		float 					_time = 0.f;
+
+		physx::PxVehicleWheelsSimData* 						_wheelsSimData = nullptr;  ///< copied by every vehicle
+		physx::PxVec3 										_wheelOffsets[WHEEL_COUNT];
+		physx::PxVec3 										_centerOfMass;
+		physx::PxVehicleDrivableSurfaceToTireFrictionPairs* _frictionPairs = nullptr;
+
+		// preallocated for _capacity vehicles
+		physx::PxBatchQuery* 							_batchQuery = nullptr;
+		std::vector<physx::PxRaycastQueryResult> 		_raycastResults;
+		std::vector<physx::PxRaycastHit> 				_raycastHits;
+		std::vector<physx::PxWheelQueryResult> 			_wheelResults;
+		std::vector<physx::PxVehicleWheelQueryResult> 	_vehicleResults;
+
+		std::vector<physx::PxVehicleWheels*> 	_vehicles;
+
+		float 		_lastRaycastMs = 0.f;
+		float 		_lastUpdateMs = 0.f;
+};
+
+#endif // __MCPLANE_VEHICLES_HPP__
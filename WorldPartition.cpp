@@ -0,0 +1,305 @@
+
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+#include "WorldPartition.hpp"
+
+using namespace physx;
+
+bool 	WorldPartition::init( PxPhysics& physics, PxScene& scene, PxMaterial& material, const WorldPartitionSettings& settings )
+{
+	if (_physics)
+		return false; // already init
+
+	if (settings.cellSize <= 0.f || settings.cellsPerUpdate == 0)
+	{
+		std::cout << "invalid world partition settings" << std::endl;
+		return false;
+	}
+
+	_physics = &physics;
+	_scene = &scene;
+	_material = &material;
+	_settings = settings;
+	return true;
+}
+
+void 	WorldPartition::deinit( void )
+{
+	if (!_physics)
+		return;
+
+	for (LiveJoint& j : _liveJoints)
+		j.joint->release();
+	_removed.clear();
+	for (LiveBody& b : _live)
+		_removed.push_back(b.actor);
+	releaseActors();
+	_liveJoints.clear();
+	_live.clear();
+	_cells.clear();
+	_loaded.clear();
+	_storedBodies = 0;
+
+	_physics = nullptr;
+	_scene = nullptr;
+	_material = nullptr;
+}
+
+WorldPartition::CellKey 	WorldPartition::getCellKey( const PxVec3& p ) const
+{
+	return CellKey((int)std::floor(p.x / _settings.cellSize), (int)std::floor(p.z / _settings.cellSize));
+}
+
+bool 	WorldPartition::isWanted( const CellKey& key, int radius ) const
+{
+	for (const CellKey& c : _centers)
+		if (std::abs(key.first - c.first) <= radius && std::abs(key.second - c.second) <= radius)
+			return true;
+	return false;
+}
+
+bool 	WorldPartition::isGroundReady( const CellKey& key ) const
+{
+	if (!_groundCheck)
+		return true;
+
+	// corners slightly inside the cell, so that a neighbour is not checked instead
+	const float size = _settings.cellSize;
+	const float inset = size * 0.01f;
+	const float x0 = key.first * size + inset;
+	const float z0 = key.second * size + inset;
+	const float x1 = x0 + size - 2.f * inset;
+	const float z1 = z0 + size - 2.f * inset;
+	return _groundCheck(x0, z0) && _groundCheck(x1, z0) && _groundCheck(x0, z1) && _groundCheck(x1, z1);
+}
+
+void 	WorldPartition::addGroup( const BodyRecord* bodies, size_t bodyCount, const JointRecord* joints, size_t jointCount )
+{
+	if (bodyCount == 0)
+		return;
+
+	Cell& cell = _cells[getCellKey(bodies[0].pose.p)];
+	const unsigned offset = cell.bodies.size();
+
+	cell.bodies.insert(cell.bodies.end(), bodies, bodies + bodyCount);
+	for (size_t i = 0; i < jointCount; ++i)
+	{
+		JointRecord j = joints[i];
+		j.body0 += offset;
+		j.body1 += offset;
+		cell.joints.push_back(j);
+	}
+	_storedBodies += bodyCount;
+}
+
+void 	WorldPartition::update( const PxVec3* pointsOfInterest, size_t count )
+{
+	const int radius = _settings.loadRadius;
+
+	_centers.clear();
+	for (size_t i = 0; i < count; ++i)
+	{
+		CellKey key = getCellKey(pointsOfInterest[i]);
+		if (std::find(_centers.begin(), _centers.end(), key) == _centers.end())
+			_centers.push_back(key);
+	}
+
+	// Unload what went out of reach, with one cell of hysteresis
+	unloadFarGroups(radius + 1);
+	for (auto it = _loaded.begin(); it != _loaded.end(); )
+	{
+		if (isWanted(*it, radius + 1))
+			++it;
+		else
+			it = _loaded.erase(it);
+	}
+
+	// Load the missing cells, closest first
+	std::vector<std::pair<int, CellKey>> missing;
+	for (const CellKey& c : _centers)
+		for (int dx = -radius; dx <= radius; ++dx)
+			for (int dz = -radius; dz <= radius; ++dz)
+			{
+				CellKey key(c.first + dx, c.second + dz);
+				if (!_loaded.count(key))
+					missing.push_back(std::make_pair(dx * dx + dz * dz, key));
+			}
+	std::sort(missing.begin(), missing.end());
+
+	unsigned budget = _settings.cellsPerUpdate;
+	for (size_t i = 0; i < missing.size() && budget > 0; ++i)
+	{
+		const CellKey& key = missing[i].second;
+		if (_loaded.count(key) || !isGroundReady(key))
+			continue; // same cell around two points of interest, or not walkable yet
+		loadCell(key);
+		--budget;
+	}
+}
+
+void 	WorldPartition::loadCell( const CellKey& key )
+{
+	_loaded.insert(key);
+
+	auto it = _cells.find(key);
+	if (it == _cells.end())
+		return;
+	Cell& cell = it->second;
+
+	// Bodies linked by joints share a group
+	std::vector<unsigned> groups(cell.bodies.size());
+	for (size_t i = 0; i < groups.size(); ++i)
+		groups[i] = i;
+	std::function<unsigned (unsigned)> root = [&]( unsigned i ) {
+		return (groups[i] == i)? i : (groups[i] = root(groups[i]));
+	};
+	for (const JointRecord& j : cell.joints)
+		groups[root(j.body0)] = root(j.body1);
+
+	const size_t first = _live.size();
+	const unsigned groupBase = _nextGroup;
+	_nextGroup += cell.bodies.size();
+
+	std::vector<PxRigidDynamic*> asleep;
+	for (size_t i = 0; i < cell.bodies.size(); ++i)
+	{
+		const BodyRecord& r = cell.bodies[i];
+
+		LiveBody b;
+		b.actor = _physics->createRigidDynamic(r.pose);
+		b.actor->createShape(PxBoxGeometry(r.halfExtents), *_material);
+		PxRigidBodyExt::updateMassAndInertia(*b.actor, 10.f);
+		b.actor->setMass(r.mass);
+		b.actor->setLinearVelocity(r.linearVelocity);
+		b.actor->setAngularVelocity(r.angularVelocity);
+		b.halfExtents = r.halfExtents;
+		b.color = r.color;
+		b.group = groupBase + root(i);
+		_live.push_back(b);
+
+		_scene->addActor(*b.actor);
+		if (r.sleeping)
+			asleep.push_back(b.actor);
+	}
+
+	for (const JointRecord& r : cell.joints)
+	{
+		LiveJoint j;
+		j.joint = PxFixedJointCreate(*_physics, _live[first + r.body0].actor, r.localPose0,
+				_live[first + r.body1].actor, r.localPose1);
+		j.joint->setConstraintFlag(PxConstraintFlag::eCOLLISION_ENABLED, false);
+		j.group = _live[first + r.body0].group;
+		_liveJoints.push_back(j);
+	}
+
+	// once the joints are there, so that they do not wake the bodies up
+	for (PxRigidDynamic* actor : asleep)
+		actor->putToSleep();
+
+	_storedBodies -= cell.bodies.size();
+	_cells.erase(it);
+}
+
+void 	WorldPartition::unloadFarGroups( int radius )
+{
+	// A group is stored in the cell of its first body
+	std::map<unsigned, CellKey> farGroups;
+	std::set<unsigned> nearGroups;
+	for (const LiveBody& b : _live)
+	{
+		if (farGroups.count(b.group) || nearGroups.count(b.group))
+			continue;
+		CellKey key = getCellKey(b.actor->getGlobalPose().p);
+		if (isWanted(key, radius))
+			nearGroups.insert(b.group);
+		else
+			farGroups[b.group] = key;
+	}
+	if (farGroups.empty())
+		return;
+
+	// Actor -> index in its cell, to rebuild the joint records
+	std::map<PxRigidActor*, unsigned> indices;
+	std::vector<LiveBody> kept;
+	kept.reserve(_live.size());
+	for (LiveBody& b : _live)
+	{
+		auto g = farGroups.find(b.group);
+		if (g == farGroups.end())
+		{
+			kept.push_back(b);
+			continue;
+		}
+
+		BodyRecord r;
+		r.pose = b.actor->getGlobalPose();
+		r.linearVelocity = b.actor->getLinearVelocity();
+		r.angularVelocity = b.actor->getAngularVelocity();
+		r.halfExtents = b.halfExtents;
+		r.mass = b.actor->getMass();
+		r.color = b.color;
+		r.sleeping = b.actor->isSleeping();
+
+		Cell& cell = _cells[g->second];
+		indices[b.actor] = cell.bodies.size();
+		cell.bodies.push_back(r);
+		++_storedBodies;
+	}
+
+	std::vector<LiveJoint> keptJoints;
+	keptJoints.reserve(_liveJoints.size());
+	for (LiveJoint& j : _liveJoints)
+	{
+		auto g = farGroups.find(j.group);
+		if (g == farGroups.end())
+		{
+			keptJoints.push_back(j);
+			continue;
+		}
+
+		PxRigidActor* actors[2] = { nullptr, nullptr };
+		j.joint->getActors(actors[0], actors[1]);
+
+		JointRecord r;
+		r.body0 = indices[actors[0]];
+		r.body1 = indices[actors[1]];
+		r.localPose0 = j.joint->getLocalPose(PxJointActorIndex::eACTOR0);
+		r.localPose1 = j.joint->getLocalPose(PxJointActorIndex::eACTOR1);
+		_cells[g->second].joints.push_back(r);
+		j.joint->release();
+	}
+
+	_removed.clear();
+	for (LiveBody& b : _live)
+		if (farGroups.count(b.group))
+			_removed.push_back(b.actor);
+	releaseActors();
+
+	_live.swap(kept);
+	_liveJoints.swap(keptJoints);
+}
+
+void 	WorldPartition::releaseActors( void )
+{
+	if (_actorsRemoved && !_removed.empty())
+		_actorsRemoved(_removed.data(), _removed.size());
+	for (PxRigidActor* actor : _removed)
+		actor->release();
+	_removed.clear();
+}
+
+void 	WorldPartition::appendBoxes( BoxInstances& boxes ) const
+{
+	for (const LiveBody& b : _live)
+	{
+		PxTransform pose = b.actor->getGlobalPose();
+
+		BoxInstance instance;
+		mat4 model = mat4_cast(quat(pose.q.w, pose.q.x, pose.q.y, pose.q.z));
+		model = model * glm::scale(mat4(1.f), vec3(b.halfExtents.x, b.halfExtents.y, b.halfExtents.z) * 2.f);
+		instance.model = glm::translate(mat4(1.f), vec3(pose.p.x, pose.p.y, pose.p.z)) * model;
+		instance.color = b.color;
+		boxes.push_back(instance);
+	}
+}
@@ -0,0 +1,131 @@
+
+#ifndef __MCPLANE_WORLDPARTITION_HPP__
+# define __MCPLANE_WORLDPARTITION_HPP__
+
+# include <map>
+# include <set>
+# include <vector>
+# include <functional>
+# include <PxPhysicsAPI.h>
+# include "Graphics.hpp"
+
+struct WorldPartitionSettings
+{
+	float 		cellSize 		= 32.f;
+	int 		loadRadius 		= 2;  ///< in cells around each point of interest
+	unsigned 	cellsPerUpdate 	= 4;  ///< bounds the cost of a single update
+};
+
+/// Stored state of a box body, enough to recreate it.
+struct BodyRecord
+{
+	physx::PxTransform 	pose 				= physx::PxTransform(physx::PxIdentity);
+	physx::PxVec3 		linearVelocity 		= physx::PxVec3(0.f);
+	physx::PxVec3 		angularVelocity 	= physx::PxVec3(0.f);
+	physx::PxVec3 		halfExtents 		= physx::PxVec3(0.5f);
+	float 				mass 				= 1.f;
+	Color 				color 				= Color(1.f, 1.f, 1.f);
+	bool 				sleeping 			= false;
+};
+
+/// Fixed joint between two bodies of the same group (indices in that group).
+struct JointRecord
+{
+	unsigned 			body0 		= 0;
+	unsigned 			body1 		= 0;
+	physx::PxTransform 	localPose0 	= physx::PxTransform(physx::PxIdentity);
+	physx::PxTransform 	localPose1 	= physx::PxTransform(physx::PxIdentity);
+};
+
+///
+/// Splits the world into square cells and only keeps in the scene the bodies
+/// of the cells around points of interest.
+///
+/// Far cells hold their bodies and joints as plain records; update() turns
+/// records into actors when a cell comes in reach and back into records when
+/// it goes out of reach, so it must be called between fetchResults() and the
+/// next simulate(). Bodies connected by joints form a group that always moves
+/// in and out as a whole, stored in the cell of its first body.
+///
+/// The actors created here have no userData.
+///
+class WorldPartition
+{
+	public:
+		/// Tells whether the ground under a point is in the scene yet.
+		using GroundCheck = std::function<bool (float x, float z)>;
+		/// Gets the actors about to be released, to forget them (their
+		/// addresses may be reused by the next actors created).
+		using ActorsRemoved = std::function<void (physx::PxRigidActor* const* actors, size_t count)>;
+
+		bool 	init( physx::PxPhysics& physics, physx::PxScene& scene, physx::PxMaterial& material,
+				const WorldPartitionSettings& settings = WorldPartitionSettings() );
+		void 	deinit( void );
+
+		/// Cells are not loaded until their ground is there (e.g. terrain tiles).
+		void 	setGroundCheck( const GroundCheck& check ) { _groundCheck = check; }
+		void 	setActorsRemoved( const ActorsRemoved& callback ) { _actorsRemoved = callback; }
+
+		/// Store a group of bodies; it enters the scene with its cell.
+		void 	addGroup( const BodyRecord* bodies, size_t bodyCount,
+				const JointRecord* joints = nullptr, size_t jointCount = 0 );
+
+		/// Load and unload cells around the given points, between two simulation steps.
+		void 	update( const physx::PxVec3* pointsOfInterest, size_t count );
+
+		size_t 	getLoadedCellCount( void ) const { return _loaded.size(); }
+		size_t 	getLiveBodyCount( void ) const { return _live.size(); }
+		size_t 	getStoredBodyCount( void ) const { return _storedBodies; }
+
+		/// Boxes of the bodies in the scene, for the render packet.
+		void 	appendBoxes( BoxInstances& boxes ) const;
+
+	private:
+		using CellKey = std::pair<int, int>;
+
+		struct Cell
+		{
+			std::vector<BodyRecord> 	bodies;
+			std::vector<JointRecord> 	joints;
+		};
+
+		struct LiveBody
+		{
+			physx::PxRigidDynamic* 		actor;
+			physx::PxVec3 				halfExtents;
+			Color 						color;
+			unsigned 					group;
+		};
+
+		struct LiveJoint
+		{
+			physx::PxFixedJoint* 		joint;
+			unsigned 					group;
+		};
+
+		CellKey 	getCellKey( const physx::PxVec3& p ) const;
+		bool 		isWanted( const CellKey& key, int radius ) const;
+		bool 		isGroundReady( const CellKey& key ) const;
+		void 		loadCell( const CellKey& key );
+		void 		unloadFarGroups( int radius );
+		void 		releaseActors( void );
+
+		physx::PxPhysics* 		_physics = nullptr;
+		physx::PxScene* 		_scene = nullptr;
+		physx::PxMaterial* 		_material = nullptr;
+		WorldPartitionSettings 	_settings;
+		GroundCheck 			_groundCheck;
+		ActorsRemoved 			_actorsRemoved;
+
+		std::map<CellKey, Cell> 	_cells;    ///< stored records, by cell
+		std::set<CellKey> 			_loaded;
+		std::vector<CellKey> 		_centers;  ///< cells holding the current points of interest
+		size_t 						_storedBodies = 0;
+
+		std::vector<LiveBody> 		_live;
+		std::vector<LiveJoint> 		_liveJoints;
+		std::vector<physx::PxRigidActor*> 	_removed;  ///< for releaseActors()
+		unsigned 					_nextGroup = 0;
+};
+
+#endif // __MCPLANE_WORLDPARTITION_HPP__
@@ -0,0 +1,97 @@
+
+# include <vector>
+# include <chrono>
+# include <cstdio>
+# include <cmath>
+# include <algorithm>
+# include <iostream>
+# include "HugePageAllocator.hpp"
+# include "BenchCommon.hpp"
+# include <PxPhysicsAPI.h>
+
+using namespace physx;
+
+///
+/// Headless benchmark of the huge-page allocator: the same scene of many
+/// boxes is built and stepped once with huge pages off, then once on, each
+/// time with a fresh foundation so that every PhysX allocation follows the
+/// mode. The scene step and a walk over every body pose (what the demo does
+/// after each step) are averaged, then the arena coverage is reported.
+///
+/// usage: allocator_bench [steps] [bodies]
+///
+
+struct Result
+{
+	float 	simulateMs = 0.f;
+	float 	walkMs = 0.f;
+};
+
+static Result 	runMode( bool hugePages, unsigned bodies, unsigned steps )
+{
+	Result result;
+	HugePageAllocator& allocator = HugePageAllocator::instance();
+	allocator.setEnabled(hugePages);
+
+	PxDefaultErrorCallback 	errorCallback;
+	PxFoundation* foundation = PxCreateFoundation(PX_PHYSICS_VERSION, allocator, errorCallback);
+	PxPhysics* physics = PxCreatePhysics(PX_PHYSICS_VERSION, *foundation, PxTolerancesScale());
+	PxDefaultCpuDispatcher* dispatcher = PxDefaultCpuDispatcherCreate(2);
+
+	PxSceneDesc sceneDesc(physics->getTolerancesScale());
+	sceneDesc.gravity = PxVec3(0.0f, -9.81f, 0.0f);
+	sceneDesc.cpuDispatcher	= dispatcher;
+	sceneDesc.filterShader	= PxDefaultSimulationFilterShader;
+	PxScene* scene = physics->createScene(sceneDesc);
+	PxMaterial* material = physics->createMaterial(0.5f, 0.5f, 0.6f);
+	scene->addActor(*PxCreatePlane(*physics, PxPlane(0.f, 1.f, 0.f, 0.f), *material));
+
+	// stacks of 8 boxes on a square grid
+	const unsigned stackHeight = 8;
+	const unsigned side = 1 + (unsigned)std::sqrt((float)(bodies / stackHeight));
+	for (unsigned i = 0; i < bodies; ++i)
+	{
+		const unsigned stack = i / stackHeight;
+		PxVec3 position((stack % side) * 3.f, 0.5f + (i % stackHeight) * 1.01f, (stack / side) * 3.f);
+		PxRigidDynamic* body = PxCreateDynamic(*physics, PxTransform(position), PxBoxGeometry(0.5f, 0.5f, 0.5f), *material, 10.f);
+		scene->addActor(*body);
+	}
+
+	ArenaVector<PxActor*> actors;
+	ArenaVector<PxTransform> poses;
+	result.simulateMs = benchSteps(WARMUP_STEPS, steps, [scene]( void ) { return benchSimulate(*scene); },
+			[&result, scene, &actors, &poses]( unsigned, float ) {
+		auto start = std::chrono::high_resolution_clock::now();
+		const PxU32 count = scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC);
+		actors.resize(count);
+		poses.resize(count);
+		scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, actors.data(), count);
+		for (PxU32 i = 0; i < count; ++i)
+			poses[i] = static_cast<PxRigidDynamic*>(actors[i])->getGlobalPose();
+		result.walkMs += benchMsSince(start);
+	});
+	result.walkMs /= steps;
+
+	allocator.report(std::cout);
+
+	scene->release();
+	material->release();
+	dispatcher->release();
+	physics->release();
+	foundation->release();
+	return result;
+}
+
+int 	main( int argc, char** argv )
+{
+	const unsigned steps = benchArg(argc, argv, 1, 300u);
+	const unsigned bodies = benchArg(argc, argv, 2, 20000u);
+
+	Result off = runMode(false, bodies, steps);
+	Result on = runMode(true, bodies, steps);
+
+	printf("\n%10s %12s %12s\n", "huge pages", "simulate ms", "walk ms");
+	printf("%10s %12.3f %12.3f\n", "off", off.simulateMs, off.walkMs);
+	printf("%10s %12.3f %12.3f\n", "on", on.simulateMs, on.walkMs);
+	return 0;
+}
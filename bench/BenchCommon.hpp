@@ -0,0 +1,73 @@
+
+#ifndef __MCPLANE_BENCHCOMMON_HPP__
+# define __MCPLANE_BENCHCOMMON_HPP__
+
+# include <chrono>
+# include <cstdlib>
+# include <algorithm>
+# include <PxPhysicsAPI.h>
+
+///
+/// Skeleton shared by the headless benchmarks: positional arguments and the
+/// timed step loop. Each bench keeps its scene setup and measurements.
+///
+
+const float STEP_DURATION = 1.f/60.f;
+const unsigned WARMUP_STEPS = 60;
+
+/// Positional argument (1 for the first), fallback when missing, never below minimum.
+inline unsigned 	benchArg( int argc, char** argv, int index, unsigned fallback, unsigned minimum = 1 )
+{
+	if (index >= argc)
+		return fallback;
+	return (unsigned)std::max((int)minimum, atoi(argv[index]));
+}
+
+inline float 	benchArgFloat( int argc, char** argv, int index, float fallback, float minimum = 0.f )
+{
+	if (index >= argc)
+		return fallback;
+	return std::max(minimum, (float)atof(argv[index]));
+}
+
+inline float 	benchMsSince( std::chrono::high_resolution_clock::time_point start )
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+/// simulate() then fetchResults(), returns the duration in ms.
+inline float 	benchSimulate( physx::PxScene& scene, float elapsedTime = STEP_DURATION )
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	scene.simulate(elapsedTime);
+	scene.fetchResults(true);
+	return benchMsSince(start);
+}
+
+///
+/// Runs warmup then measured steps. step() does one step and returns its
+/// duration in ms; measure(index, ms) follows every measured step (index
+/// from 0) and is not timed. Returns the average ms of the measured steps.
+///
+template<class Step, class Measure>
+float 	benchSteps( unsigned warmup, unsigned steps, Step step, Measure measure )
+{
+	float totalMs = 0.f;
+	for (unsigned i = 0; i < warmup + steps; ++i)
+	{
+		const float ms = step();
+		if (i < warmup)
+			continue;
+		totalMs += ms;
+		measure(i - warmup, ms);
+	}
+	return steps? totalMs / steps : 0.f;
+}
+
+template<class Step>
+float 	benchSteps( unsigned warmup, unsigned steps, Step step )
+{
+	return benchSteps(warmup, steps, step, []( unsigned, float ) {});
+}
+
+#endif // __MCPLANE_BENCHCOMMON_HPP__
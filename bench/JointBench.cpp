@@ -0,0 +1,125 @@
+
+# include <vector>
+# include <cstdio>
+# include <cmath>
+# include <algorithm>
+# include "Simulation.hpp"
+# include "BenchCommon.hpp"
+# include <PxPhysicsAPI.h>
+
+using namespace physx;
+
+///
+/// Headless benchmark of joint projection against solver iterations: many
+/// horizontal cantilevers of boxes welded with fixed joints, each ending
+/// with a heavy box, hang from the world. Every run steps the same scene
+/// with one setting (position iterations, projection or not) and reports
+/// the step time and the joint errors once the chains have loaded.
+///
+/// usage: joint_bench [chains] [links] [steps]
+///
+
+const float LINK_MASS = 1.f;
+const float TIP_MASS = 50.f;
+
+struct Setting
+{
+	const char* 	name;
+	PxU32 			positionIters;
+	bool 			projection;
+};
+
+struct Result
+{
+	float 	stepMs = 0.f;
+	float 	meanLinear = 0.f;  ///< over the joints and the measured steps
+	float 	maxLinear = 0.f;
+	float 	meanAngular = 0.f;
+	float 	maxAngular = 0.f;
+};
+
+static Result 	runSetting( const Setting& setting, unsigned chains, unsigned links, unsigned steps )
+{
+	Result result;
+	Simulation simulation;
+	if (!simulation.init())
+		return result;
+	PxPhysics* physics = &simulation.getPhysics();
+	PxScene* scene = &simulation.getScene();
+	PxMaterial* material = &simulation.getMaterial();
+
+	JointProjection projection;
+	projection.enabled = setting.projection;
+	const PxBoxGeometry box(0.5f, 0.25f, 0.25f);
+	const PxTransform right(PxVec3(0.5f, 0.f, 0.f));
+	const PxTransform left(PxVec3(-0.5f, 0.f, 0.f));
+	JointDescs descs;
+	descs.reserve(chains * links);
+	for (unsigned c = 0; c < chains; ++c)
+	{
+		// chains are 2 apart on z: no contacts between them
+		const PxVec3 origin(0.f, 10.f, c * 2.f);
+		PxRigidActor* previous = nullptr;
+		PxTransform previousFrame(origin);
+		for (unsigned l = 0; l < links; ++l)
+		{
+			PxRigidDynamic* body = PxCreateDynamic(*physics, PxTransform(origin + PxVec3(0.5f + l, 0.f, 0.f)), box, *material, 1.f);
+			PxRigidBodyExt::setMassAndUpdateInertia(*body, (l + 1 == links)? TIP_MASS : LINK_MASS);
+			body->setSolverIterationCounts(setting.positionIters);
+			scene->addActor(*body);
+
+			const size_t j = descs.add(JOINT_FIXED, previous, previousFrame, body, left);
+			descs.projections[j] = projection;
+			previous = body;
+			previousFrame = right;
+		}
+	}
+	std::vector<PxJoint*> joints(descs.size());
+	JointFactory factory;
+	factory.create(*physics, descs, joints.data());
+
+	result.stepMs = benchSteps(WARMUP_STEPS, steps, [&simulation]( void ) { return simulation.step(STEP_DURATION); },
+			[&result, &joints]( unsigned, float ) {
+		for (PxJoint* joint : joints)
+		{
+			float linear, angular;
+			getJointError(*joint, linear, angular);
+			result.meanLinear += linear;
+			result.meanAngular += angular;
+			result.maxLinear = std::max(result.maxLinear, linear);
+			result.maxAngular = std::max(result.maxAngular, angular);
+		}
+	});
+	result.meanLinear /= steps * joints.size();
+	result.meanAngular /= steps * joints.size();
+
+	simulation.deinit();
+	return result;
+}
+
+int 	main( int argc, char** argv )
+{
+	const unsigned chains = benchArg(argc, argv, 1, 256u);
+	const unsigned links = benchArg(argc, argv, 2, 16u);
+	const unsigned steps = benchArg(argc, argv, 3, 120u);
+
+	const Setting settings[] = {
+		{ "4 iterations", 4, false },
+		{ "8 iterations", 8, false },
+		{ "16 iterations", 16, false },
+		{ "32 iterations", 32, false },
+		{ "64 iterations", 64, false },
+		{ "4 + projection", 4, true },
+		{ "8 + projection", 8, true },
+	};
+
+	printf("%u chains of %u links, %u joints\n\n", chains, links, chains * links);
+	printf("%-16s %9s %11s %11s %11s %11s\n", "setting", "step ms", "mean dist", "max dist", "mean rad", "max rad");
+	for (const Setting& setting : settings)
+	{
+		Result r = runSetting(setting, chains, links, steps);
+		printf("%-16s %9.3f %11.5f %11.5f %11.5f %11.5f\n", setting.name,
+				r.stepMs, r.meanLinear, r.maxLinear, r.meanAngular, r.maxAngular);
+	}
+	return 0;
+}
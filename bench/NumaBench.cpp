@@ -0,0 +1,126 @@
+
+# include <mutex>
+# include <thread>
+# include <vector>
+# include <cstdio>
+# include <cmath>
+# include <algorithm>
+# include <iostream>
+# include "HugePageAllocator.hpp"
+# include "Numa.hpp"
+# include "BenchCommon.hpp"
+# include <PxPhysicsAPI.h>
+
+using namespace physx;
+
+///
+/// Headless benchmark of NUMA placement: one scene per node (a simulation
+/// shard), all stepped at the same time from their own thread. The shards
+/// run once with free-floating PxDefaultCpuDispatcher threads, then once
+/// pinned, each with a NumaDispatcher and its memory on its node. The
+/// average step time of every shard and the remote arena pages are reported.
+///
+/// usage: numa_bench [steps] [bodies per shard] [threads per shard]
+///
+
+struct Shard
+{
+	unsigned 	node = 0;
+	float 		simulateMs = 0.f;
+};
+
+static void 	runShard( PxPhysics& physics, std::mutex& setupMutex, Shard& shard, bool pinned,
+		unsigned bodies, unsigned threads, unsigned steps )
+{
+	NumaDispatcher numaDispatcher;
+	PxDefaultCpuDispatcher* defaultDispatcher = nullptr;
+	if (pinned)
+	{
+		numaPinThread(shard.node);
+		numaDispatcher.init(shard.node, threads);
+	}
+	else
+		defaultDispatcher = PxDefaultCpuDispatcherCreate(threads);
+
+	// creation goes through the shared PxPhysics: one shard at a time, but
+	// still from the shard's thread so its memory lands on its node
+	PxScene* scene = nullptr;
+	PxMaterial* material = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(setupMutex);
+		PxSceneDesc sceneDesc(physics.getTolerancesScale());
+		sceneDesc.gravity = PxVec3(0.0f, -9.81f, 0.0f);
+		sceneDesc.cpuDispatcher	= pinned? static_cast<PxCpuDispatcher*>(&numaDispatcher) : defaultDispatcher;
+		sceneDesc.filterShader	= PxDefaultSimulationFilterShader;
+		scene = physics.createScene(sceneDesc);
+		material = physics.createMaterial(0.5f, 0.5f, 0.6f);
+		scene->addActor(*PxCreatePlane(physics, PxPlane(0.f, 1.f, 0.f, 0.f), *material));
+
+		const unsigned stackHeight = 8;
+		const unsigned side = 1 + (unsigned)std::sqrt((float)(bodies / stackHeight));
+		for (unsigned i = 0; i < bodies; ++i)
+		{
+			const unsigned stack = i / stackHeight;
+			PxVec3 position((stack % side) * 3.f, 0.5f + (i % stackHeight) * 1.01f, (stack / side) * 3.f);
+			scene->addActor(*PxCreateDynamic(physics, PxTransform(position), PxBoxGeometry(0.5f, 0.5f, 0.5f), *material, 10.f));
+		}
+	}
+
+	shard.simulateMs = benchSteps(WARMUP_STEPS, steps, [scene]( void ) { return benchSimulate(*scene); });
+
+	{
+		std::lock_guard<std::mutex> lock(setupMutex);
+		scene->release();
+		material->release();
+	}
+	if (defaultDispatcher)
+		defaultDispatcher->release();
+	numaDispatcher.deinit();
+}
+
+static std::vector<Shard> 	runShards( PxPhysics& physics, bool pinned, unsigned bodies, unsigned threads, unsigned steps )
+{
+	const NumaTopology& topology = NumaTopology::get();
+	std::vector<Shard> shards(topology.getNodeCount());
+	std::vector<std::thread> shardThreads;
+	std::mutex setupMutex;
+	for (unsigned node = 0; node < shards.size(); ++node)
+	{
+		shards[node].node = node;
+		shardThreads.push_back(std::thread(runShard, std::ref(physics), std::ref(setupMutex),
+					std::ref(shards[node]), pinned, bodies, threads, steps));
+	}
+	for (std::thread& thread : shardThreads)
+		thread.join();
+	return shards;
+}
+
+int 	main( int argc, char** argv )
+{
+	const unsigned steps = benchArg(argc, argv, 1, 300u);
+	const unsigned bodies = benchArg(argc, argv, 2, 10000u);
+	const unsigned threads = benchArg(argc, argv, 3, 2u, 0u);
+
+	const NumaTopology& topology = NumaTopology::get();
+	if (!topology.isNuma())
+		std::cout << "single NUMA node: both runs place the same way" << std::endl;
+
+	HugePageAllocator& allocator = HugePageAllocator::instance();
+	allocator.setEnabled(true);
+	PxDefaultErrorCallback 	errorCallback;
+	PxFoundation* foundation = PxCreateFoundation(PX_PHYSICS_VERSION, allocator, errorCallback);
+	PxPhysics* physics = PxCreatePhysics(PX_PHYSICS_VERSION, *foundation, PxTolerancesScale());
+
+	printf("%10s %6s %12s\n", "placement", "node", "simulate ms");
+	for (int pinned = 0; pinned < 2; ++pinned)
+	{
+		std::vector<Shard> shards = runShards(*physics, pinned, bodies, threads, steps);
+		for (const Shard& shard : shards)
+			printf("%10s %6d %12.3f\n", pinned? "pinned" : "floating", topology.getNodeId(shard.node), shard.simulateMs);
+		allocator.report(std::cout);
+	}
+
+	physics->release();
+	foundation->release();
+	return 0;
+}
@@ -0,0 +1,103 @@
+
+# include <vector>
+# include <cstdio>
+# include <cmath>
+# include <algorithm>
+# include "Simulation.hpp"
+# include "ShapeOffsets.hpp"
+# include "BenchCommon.hpp"
+# include <PxPhysicsAPI.h>
+
+using namespace physx;
+
+///
+/// Headless benchmark of the per-shape contact offsets: the same scene of
+/// stacks mixing thin planks and large crates is stepped with the default
+/// offset of every shape, then with the offsets from applyContactOffsets().
+/// The broad phase (new pairs found) and narrow phase (pairs processed,
+/// pairs with contacts) counts are averaged per step with the step time.
+///
+/// usage: offset_bench [steps] [stacks] [speed]
+///
+
+const unsigned STACK_HEIGHT = 10;
+
+struct Result
+{
+	float 	stepMs = 0.f;
+	float 	newPairs = 0.f;  ///< broad phase, per step
+	float 	pairs = 0.f;     ///< narrow phase, per step
+	float 	contacts = 0.f;  ///< pairs with contacts, per step
+};
+
+static Result 	runMode( bool automatic, unsigned stacks, unsigned steps, float speed )
+{
+	Result result;
+	Simulation simulation;
+	if (!simulation.init())
+		return result;
+	PxPhysics* physics = &simulation.getPhysics();
+	PxScene* scene = &simulation.getScene();
+	PxMaterial* material = &simulation.getMaterial();
+
+	const unsigned side = 1 + (unsigned)std::sqrt((float)stacks);
+	const float extent = side * 3.f;
+	PxRigidStatic* ground = PxCreateStatic(*physics, PxTransform(PxVec3(extent * 0.5f, -0.5f, extent * 0.5f)),
+			PxBoxGeometry(extent, 0.5f, extent), *material);
+	if (automatic)
+		applyContactOffsets(*ground, 0.f);
+	scene->addActor(*ground);
+
+	// planks (like B and C) and crates, alternating in each stack
+	const PxBoxGeometry plank(1.2f, 0.05f, 0.4f);
+	const PxBoxGeometry crate(0.5f, 0.5f, 0.5f);
+	for (unsigned s = 0; s < stacks; ++s)
+	{
+		float y = 0.f;
+		for (unsigned i = 0; i < STACK_HEIGHT; ++i)
+		{
+			const PxBoxGeometry& box = (i % 2)? crate : plank;
+			y += box.halfExtents.y;
+			PxVec3 position((s % side) * 3.f, y, (s / side) * 3.f);
+			y += box.halfExtents.y + 0.001f;
+			PxRigidDynamic* body = PxCreateDynamic(*physics, PxTransform(position), box, *material, 10.f);
+			if (automatic)
+				applyContactOffsets(*body, speed);
+			scene->addActor(*body);
+		}
+	}
+
+	result.stepMs = benchSteps(0, steps, [&simulation]( void ) { return simulation.step(STEP_DURATION); },
+			[&result, scene]( unsigned, float ) {
+		PxSimulationStatistics stats;
+		scene->getSimulationStatistics(stats);
+		result.newPairs += stats.nbNewPairs;
+		result.pairs += stats.nbDiscreteContactPairsTotal;
+		result.contacts += stats.nbDiscreteContactPairsWithContacts;
+	});
+	result.newPairs /= steps;
+	result.pairs /= steps;
+	result.contacts /= steps;
+
+	simulation.deinit();
+	return result;
+}
+
+int 	main( int argc, char** argv )
+{
+	const unsigned steps = benchArg(argc, argv, 1, 300u);
+	const unsigned stacks = benchArg(argc, argv, 2, 1000u);
+	const float speed = benchArgFloat(argc, argv, 3, 10.f);
+
+	Result def = runMode(false, stacks, steps, speed);
+	Result automatic = runMode(true, stacks, steps, speed);
+
+	printf("%u stacks of %u, expected speed %.1f m/s, per step:\n\n", stacks, STACK_HEIGHT, speed);
+	printf("%10s %10s %12s %12s %12s\n", "offsets", "step ms", "new pairs", "narrow", "contacts");
+	printf("%10s %10.3f %12.1f %12.1f %12.1f\n", "default", def.stepMs, def.newPairs, def.pairs, def.contacts);
+	printf("%10s %10.3f %12.1f %12.1f %12.1f\n", "per shape", automatic.stepMs, automatic.newPairs, automatic.pairs, automatic.contacts);
+	if (def.pairs > 0.f)
+		printf("\nnarrow phase pairs %+.1f%%, step time %+.1f%%\n",
+				100.f * (automatic.pairs / def.pairs - 1.f), 100.f * (automatic.stepMs / def.stepMs - 1.f));
+	return 0;
+}
@@ -0,0 +1,124 @@
+
+# include <vector>
+# include <cstdio>
+# include <cmath>
+# include <cstdlib>
+# include <algorithm>
+# include "Simulation.hpp"
+# include "SpawnValidator.hpp"
+# include "BenchCommon.hpp"
+# include <PxPhysicsAPI.h>
+
+using namespace physx;
+
+///
+/// Headless benchmark of the spawn validation: the same random pile of
+/// boxes, many of them overlapping, is spawned once straight into the scene
+/// and once through SpawnValidator. The first step (where the solver pushes
+/// the overlapping pairs apart) and the following ones are timed, with the
+/// contact pairs and the peak speed the bodies got from being pushed out.
+///
+/// usage: spawn_bench [bodies] [steps]
+///
+
+const unsigned SEED = 1234;
+
+struct Result
+{
+	float 		validateMs = 0.f;
+	float 		firstStepMs = 0.f;
+	float 		nextStepsMs = 0.f;  ///< average of the steps after the first
+	unsigned 	firstContacts = 0;
+	float 		maxSpeed = 0.f;  ///< after the first step
+	SpawnStats 	spawns;
+};
+
+static float 	randomRange( float lo, float hi )
+{
+	return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+}
+
+static Result 	runMode( bool validate, unsigned bodies, unsigned steps )
+{
+	Result result;
+	Simulation simulation;
+	if (!simulation.init())
+		return result;
+	PxPhysics* physics = &simulation.getPhysics();
+	PxScene* scene = &simulation.getScene();
+	PxMaterial* material = &simulation.getMaterial();
+	scene->addActor(*PxCreatePlane(*physics, PxPlane(0.f, 1.f, 0.f, 0.f), *material));
+
+	// about 4 boxes per cubic unit of pile: plenty of overlaps, some with the ground
+	srand(SEED);
+	const float side = std::cbrt(bodies / 4.f) * 2.f;
+	std::vector<PxRigidDynamic*> spawned;
+	spawned.reserve(bodies);
+	for (unsigned i = 0; i < bodies; ++i)
+	{
+		PxVec3 position(randomRange(-side, side), randomRange(0.f, side), randomRange(-side, side));
+		PxVec3 halfsize(randomRange(0.2f, 0.6f), randomRange(0.2f, 0.6f), randomRange(0.2f, 0.6f));
+		PxQuat rotation(randomRange(0.f, PxTwoPi), PxVec3(0.f, 1.f, 0.f));
+		spawned.push_back(PxCreateDynamic(*physics, PxTransform(position, rotation), PxBoxGeometry(halfsize), *material, 10.f));
+	}
+
+	SpawnValidator validator;
+	if (validate)
+	{
+		for (PxRigidDynamic* body : spawned)
+			validator.add(*body);
+		std::vector<PxRigidActor*> rejected;
+		validator.flush(*scene, rejected);
+		for (PxRigidActor* actor : rejected)
+			actor->release();
+		result.spawns = validator.getLastStats();
+		result.validateMs = result.spawns.validateMs;
+	}
+	else
+		for (PxRigidDynamic* body : spawned)
+			scene->addActor(*body);
+
+	const PxU32 count = scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC);
+	std::vector<PxActor*> actors(count);
+	scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, actors.data(), count);
+	benchSteps(0, 1 + steps, [&simulation]( void ) { return simulation.step(STEP_DURATION); },
+			[&result, scene, &actors]( unsigned step, float ms ) {
+		if (step > 0)
+		{
+			result.nextStepsMs += ms;
+			return;
+		}
+
+		result.firstStepMs = ms;
+		PxSimulationStatistics stats;
+		scene->getSimulationStatistics(stats);
+		result.firstContacts = stats.nbDiscreteContactPairsWithContacts;
+		for (PxActor* actor : actors)
+			result.maxSpeed = std::max(result.maxSpeed, static_cast<PxRigidDynamic*>(actor)->getLinearVelocity().magnitude());
+	});
+	result.nextStepsMs /= std::max(steps, 1u);
+
+	validator.reset();
+	simulation.deinit();
+	return result;
+}
+
+int 	main( int argc, char** argv )
+{
+	const unsigned bodies = benchArg(argc, argv, 1, 4000u);
+	const unsigned steps = benchArg(argc, argv, 2, 60u, 0u);
+
+	Result off = runMode(false, bodies, steps);
+	Result on = runMode(true, bodies, steps);
+
+	printf("%u boxes: %u overlapping, %u nudged, %u rejected\n",
+			bodies, on.spawns.overlapping, on.spawns.nudged, on.spawns.rejected);
+	printf("\n%10s %12s %14s %12s %12s %10s\n", "validated", "validate ms", "first step ms", "contacts", "max speed", "next ms");
+	printf("%10s %12.3f %14.3f %12u %12.3f %10.3f\n", "no", off.validateMs, off.firstStepMs, off.firstContacts, off.maxSpeed, off.nextStepsMs);
+	printf("%10s %12.3f %14.3f %12u %12.3f %10.3f\n", "yes", on.validateMs, on.firstStepMs, on.firstContacts, on.maxSpeed, on.nextStepsMs);
+	if (off.firstStepMs > 0.f)
+		printf("\nfirst step: %.1f%% less solver time, %.1f%% including the validation\n",
+				100.f * (1.f - on.firstStepMs / off.firstStepMs),
+				100.f * (1.f - (on.firstStepMs + on.validateMs) / off.firstStepMs));
+	return 0;
+}
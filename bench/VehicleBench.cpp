@@ -0,0 +1,94 @@
+
+# include <vector>
+# include <cstdio>
+# include <cmath>
+# include <algorithm>
+# include <iostream>
+# include "Simulation.hpp"
+# include "Vehicles.hpp"
+# include "BenchCommon.hpp"
+# include <PxPhysicsAPI.h>
+
+using namespace physx;
+
+///
+/// Headless benchmark of the Vehicles subsystem: for every vehicle count,
+/// a fresh scene with a ground plane is stepped and the time spent in the
+/// suspension raycasts, the vehicle updates and the scene step is averaged.
+///
+/// usage: vehicle_bench [steps] [count...]
+///
+
+struct Result
+{
+	unsigned 	vehicles = 0;
+	float 		raycastMs = 0.f;
+	float 		updateMs = 0.f;   ///< raycasts included
+	float 		simulateMs = 0.f;
+};
+
+static Result 	runCount( unsigned count, unsigned steps )
+{
+	Result result;
+	result.vehicles = count;
+
+	Simulation simulation;
+	if (!simulation.init())
+		return result;
+	PxPhysics& physics = simulation.getPhysics();
+	PxRigidStatic* ground = PxCreatePlane(physics, PxPlane(0.f, 1.f, 0.f, 0.f), simulation.getMaterial());
+	simulation.getScene().addActor(*ground);
+
+	Vehicles vehicles;
+	if (vehicles.init(physics, simulation.getScene(), simulation.getMaterial(), count) == false)
+	{
+		std::cout << "failed to init " << count << " vehicles" << std::endl;
+		ground->release();
+		simulation.deinit();
+		return result;
+	}
+
+	// a square grid, far enough apart not to collide while curving
+	const unsigned side = 1 + (unsigned)std::sqrt((float)count);
+	const float spacing = 12.f;
+	for (unsigned i = 0; i < count; ++i)
+		vehicles.spawn(PxTransform(PxVec3((i % side) * spacing, 1.2f, (i / side) * spacing)));
+
+	result.simulateMs = benchSteps(WARMUP_STEPS, steps, [&simulation, &vehicles]( void ) {
+		vehicles.update(STEP_DURATION);
+		return simulation.step(STEP_DURATION);
+	}, [&result, &vehicles]( unsigned, float ) {
+		result.raycastMs += vehicles.getLastRaycastMs();
+		result.updateMs += vehicles.getLastUpdateMs();
+	});
+	result.raycastMs /= steps;
+	result.updateMs /= steps;
+
+	vehicles.deinit();
+	ground->release();
+	simulation.deinit();
+	return result;
+}
+
+int 	main( int argc, char** argv )
+{
+	const unsigned steps = benchArg(argc, argv, 1, 300u);
+	std::vector<unsigned> counts = { 1, 4, 16, 64, 256, 1024 };
+	if (argc > 2)
+	{
+		counts.clear();
+		for (int i = 2; i < argc; ++i)
+			counts.push_back(benchArg(argc, argv, i, 1u));
+	}
+
+	printf("%10s %12s %12s %12s %12s %14s\n", "vehicles", "raycast ms", "update ms", "simulate ms", "total ms", "us/vehicle");
+	for (unsigned count : counts)
+	{
+		Result r = runCount(count, steps);
+		float total = r.updateMs + r.simulateMs;
+		printf("%10u %12.3f %12.3f %12.3f %12.3f %14.2f\n", r.vehicles, r.raycastMs, r.updateMs,
+				r.simulateMs, total, total * 1000.f / r.vehicles);
+	}
+
+	return 0;
+}
@@ -0,0 +1,121 @@
+
+# include <cstdio>
+# include <cstdlib>
+# include <algorithm>
+# include "Mcplane.hpp"
+
+using namespace physx;
+
+///
+/// The joint test case of the demo without any window: C and B welded
+/// above the ground, A dropped on B, then A fixed to B at JOINT_STEP with
+/// or without the workaround. Prints the step times, the peak speeds of A
+/// and B once joined, the joint error and the filter data of A at the end
+/// ("kept" or "changed" against A's before the joint), for CI runs and
+/// profilers.
+///
+/// Exits with 2 when the joined bodies move (peak speed over
+/// MAX_PEAK_SPEED) or the joint drifts (error over MAX_JOINT_ERROR): what
+/// happens when A and B keep colliding inside each other. The ctest cases
+/// check that exit code.
+///
+/// usage: headless_runner [steps] [workaround 0/1] [huge pages 0/1]
+///
+
+const float STEP_DURATION = 1.f/60.f;
+const unsigned JOINT_STEP = 180;
+const float MAX_PEAK_SPEED = 1.f;      ///< m/s, A and B rest on C
+const float MAX_JOINT_ERROR = 0.01f;   ///< m and rad
+
+int 	main( int argc, char** argv )
+{
+	unsigned steps = 600;
+	bool workaround = false;
+	bool hugePages = true;
+	if (argc > 1)
+		steps = std::max(JOINT_STEP + 1, (unsigned)std::max(0, atoi(argv[1])));
+	if (argc > 2)
+		workaround = atoi(argv[2]) != 0;
+	if (argc > 3)
+		hugePages = atoi(argv[3]) != 0;
+
+	HugePageAllocator::instance().setEnabled(hugePages);
+	Simulation simulation;
+	if (!simulation.init())
+		return 1;
+	PxPhysics& physics = simulation.getPhysics();
+	PxScene& scene = simulation.getScene();
+	JointFactory factory;
+
+	PxRigidStatic* ground = simulation.createStaticBox(PxVec3(90.f, 0.5f, 90.f), PxVec3(0.f));
+	PxRigidDynamic* C = simulation.createBox(1000.f, PxVec3(8.f, 0.25f, 1.5f), PxVec3(0.f, 2.f, 0.f));
+	PxRigidDynamic* B = simulation.createBox(1000.f, PxVec3(8.f, 0.25f, 1.5f), PxVec3(0.f, 4.f, 0.f));
+	PxRigidDynamic* A = simulation.createBox(50.f, PxVec3(0.5f), PxVec3(0.f, 5.f, 0.f));
+	scene.addActor(*ground);
+	scene.addActor(*C);
+	scene.addActor(*B);
+	scene.addActor(*A);
+	PxJoint* joints[2] = {
+		createFixedJoint(physics, factory, C, PxVec3(0.f, 1.f, 0.f), B, PxVec3(0.f, -1.f, 0.f), false),
+		nullptr
+	};
+
+	float totalMs = 0.f;
+	float maxMs = 0.f;
+	float peakA = 0.f;
+	float peakB = 0.f;
+	std::vector<PxFilterData> filterDataBefore;
+	for (unsigned step = 0; step < steps; ++step)
+	{
+		if (step == JOINT_STEP)
+		{
+			filterDataBefore = getFilterData(A);
+			joints[1] = createFixedJoint(physics, factory, A, PxVec3(0.f), B, PxVec3(0.f), workaround);
+		}
+
+		const float ms = simulation.step(STEP_DURATION);
+		totalMs += ms;
+		maxMs = std::max(maxMs, ms);
+		if (step >= JOINT_STEP)
+		{
+			peakA = std::max(peakA, A->getLinearVelocity().magnitude());
+			peakB = std::max(peakB, B->getLinearVelocity().magnitude());
+		}
+	}
+
+	float linear = 0.f, angular = 0.f;
+	if (joints[1])
+		getJointError(*joints[1], linear, angular);
+	const std::vector<PxFilterData> filterData = getFilterData(A);
+	const PxVec3 position = A->getGlobalPose().p;
+
+	printf("%u steps, joint at %u, workaround %s, huge pages %s\n", steps, JOINT_STEP,
+			workaround? "on" : "off", hugePages? "on" : "off");
+	printf("step ms: mean %.3f, max %.3f\n", totalMs / steps, maxMs);
+	printf("peak speed after the joint: A %.3f m/s, B %.3f m/s\n", peakA, peakB);
+	printf("A at (%.3f, %.3f, %.3f), joint error %.5f m %.5f rad\n",
+			position.x, position.y, position.z, linear, angular);
+	bool kept = filterData.size() == filterDataBefore.size();
+	for (size_t i = 0; kept && i < filterData.size(); ++i)
+		kept = filterData[i] == filterDataBefore[i];
+	if (!filterData.empty())
+		printf("A filter data: %08x %08x %08x %08x, %s\n", filterData[0].word0, filterData[0].word1,
+				filterData[0].word2, filterData[0].word3, kept? "kept" : "changed");
+
+	const bool calm = peakA <= MAX_PEAK_SPEED && peakB <= MAX_PEAK_SPEED;
+	const bool held = linear <= MAX_JOINT_ERROR && angular <= MAX_JOINT_ERROR;
+	if (!calm)
+		printf("FAILED: peak speed over %.2f m/s after the joint\n", MAX_PEAK_SPEED);
+	if (!held)
+		printf("FAILED: joint error over %.3f\n", MAX_JOINT_ERROR);
+
+	for (PxJoint* joint : joints)
+		if (joint)
+			joint->release();
+	A->release();
+	B->release();
+	C->release();
+	ground->release();
+	simulation.deinit();
+	return (calm && held)? 0 : 2;
+}
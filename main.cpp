@@ -1,56 +1,99 @@
-# include <unistd.h>
 # include <map>
 # include <vector>
+# include <string>
+# include <cmath>
+# include <cstdio>
 # include <iostream>
 # include <chrono>
+# include <thread>
+# include <algorithm>
+# include <functional>
 
 # include "Graphics.hpp"
+# include "RenderThread.hpp"
+# include "Terrain.hpp"
+# include "WorldPartition.hpp"
+# include "BodyCommands.hpp"
+# include "KinematicDriver.hpp"
+# include "CharacterCrowd.hpp"
+# include "Vehicles.hpp"
+# include "ContactTuning.hpp"
+# include "HugePageAllocator.hpp"
+# include "Numa.hpp"
+# include "Ecs.hpp"
+# include "Components.hpp"
+# include "SceneHistory.hpp"
+# include "SceneFork.hpp"
+# include "SpawnValidator.hpp"
+# include "Simulation.hpp"
+# include "ShapeOffsets.hpp"
+# include "TriggerVolumes.hpp"
 # include <PxPhysicsAPI.h>
 
 
 using namespace physx;
-using EntityID = int;
 
 //// Globals ////
-PxDefaultAllocator			gAllocator;
-PxDefaultErrorCallback		gErrorCallback;
-PxFoundation*				gFoundation = nullptr;
-PxDefaultCpuDispatcher*		gDispatcher = nullptr;
-PxCooking*					gCooking = nullptr;
+HugePageAllocator& 			gAllocator = HugePageAllocator::instance();
+Simulation 					gSimulation;
+NumaDispatcher 				gNumaDispatcher;
 PxPhysics*					gPhysics = nullptr;
 PxMaterial*					gPhysicsMaterial = nullptr;
 PxScene* 					gPhysicsScene = nullptr;
+ContactModifier 			gContactModifier;
+SceneForker 				gForker;
+SpawnValidator 				gSpawns;
+JointFactory 				gJointFactory;
+TriggerVolumes 				gTriggers;
+World 						gWorld;
 
 const vec3 VEC3_ZERO = vec3(0.f, 0.f, 0.f);
+const float STEP_DURATION = 1.f/60.f;
+
+//// Demo settings ////
+const bool USE_TERRAIN = true; ///< streamed heightfield ground instead of a single box
+const bool USE_WORLD_PARTITION = true; ///< scatter streamed bodies across the world
+const bool USE_PLATFORMS = true; ///< animated kinematic platforms carrying welded boxes
+const unsigned CROWD_SIZE = 1024; ///< character controllers wandering behind the joint test case, 0 for none
+const unsigned VEHICLE_COUNT = 16; ///< vehicles driving in front of the joint test case, 0 for none
+const bool SOFT_AB_CONTACTS = true; ///< frictionless, soft A/B contacts until the joint has settled
+const unsigned SETTLING_GROUP = 0; ///< contact tuning group of A and B
+const bool USE_HUGE_PAGES = true; ///< serve large PhysX blocks and frame arrays from huge-page arenas
+const bool USE_NUMA_PLACEMENT = true; ///< keep simulation threads and memory on one node (multi-socket hosts only)
+const bool IDLE_WHEN_ASLEEP = true; ///< stop stepping and presenting while nothing can change
+const unsigned JOINT_STEP = 180; ///< step creating the A/B joint (3 s), replayed after a rewind
+const unsigned SETTLED_STEP = 240; ///< step ending the soft A/B contacts
+const size_t REWIND_BUDGET = 256 << 20; ///< memory of the rewind buffer, in bytes
+const unsigned REWIND_STEPS = 60; ///< steps undone by a rewind key press
+const bool FORK_AT_JOINT = true; ///< compare joint creation variants in forks of the scene first
+const unsigned FORK_STEPS = 120; ///< steps simulated by each fork
+const bool VALIDATE_SPAWNS = true; ///< nudge or reject the boxes spawned overlapping something
+const bool AUTO_CONTACT_OFFSETS = true; ///< contact offsets from the size of each box instead of the default
+const float EXPECTED_SPEED = 10.f; ///< of the dynamic boxes, for their contact offsets
+const bool USE_KILL_ZONE = true; ///< trigger volume under the world putting fallen bodies back on the ground
+const float KILL_HEIGHT = -50.f;
 
 
 //// Structs ////
-struct Entity
+struct Camera
 {
-	vec3 			position 	= vec3(1.f, 1.f, 1.f);
-	quat 			rotation 	= quat(0.f, 0.f, 0.f, 1.f);
-	vec3 			scale 		= vec3(1.f, 1.f, 1.f);
+	vec3 			eye 		= vec3(15.f, 18.f, 15.f);
+	vec3 			center 		= vec3(0.f, 0.f, -30.f);
 
-	mat4 			getModelMatrix( void ) {
-		mat4 model = mat4_cast(rotation);
-		model = model*glm::scale(mat4(1.f), scale);
-		model = glm::translate(mat4(1.f), position)*model;
-		return model;
+	mat4 			getView( void ) const {
+		return lookAt(eye, center, vec3(0.f, 1.f, 0.f));
 	};
-};
-
-struct DynamicEntity : public Entity
-{
-	using Ptr = std::shared_ptr<DynamicEntity>;
-
-	PxRigidDynamic*	body = nullptr;
-};
-
-struct StaticEntity : public Entity
-{
-	using Ptr = std::shared_ptr<StaticEntity>;
 
-	PxRigidStatic*	body = nullptr;
+	/// Move eye and center together, on the horizontal plane.
+	void 			pan( float right, float forward ) {
+		vec3 f = center - eye;
+		f.y = 0.f;
+		f = normalize(f);
+		vec3 r = cross(f, vec3(0.f, 1.f, 0.f));
+		vec3 delta = r * right + f * forward;
+		eye += delta;
+		center += delta;
+	};
 };
 
 
@@ -60,15 +103,22 @@ inline physx::PxQuat 	toPxQuat( quat q ) { return physx::PxQuat(q.x, q.y, q.z, q
 inline vec3 			toVec3( PxVec3 v ) { return vec3(v.x, v.y, v.z); }
 inline quat 			toQuat( PxQuat q ) { return quat(q.w, q.x, q.y, q.z); }
 
+/// The dynamic body of an entity, nullptr for static ones.
+static PxRigidDynamic* 	getDynamic( EntityId entity )
+{
+	PhysicsBody* body = gWorld.get<PhysicsBody>(entity);
+	return body? body->actor->is<PxRigidDynamic>() : nullptr;
+}
+
 static void 	printBinary( PxU32 word )
 {
 	for (uint i = 0; i < 32; ++i)
 		std::cout << int(((1 << i) & word)? 1 : 0);
 }
 
-static void 	debugDisplayFilterData( DynamicEntity& entity )
+static void 	debugDisplayFilterData( EntityId entity )
 {
-	PxRigidDynamic* dyn = entity.body;
+	PxRigidDynamic* dyn = getDynamic(entity);
 
 	std::vector<PxShape*> 	shapes(dyn->getNbShapes());
 	dyn->getShapes(&shapes[0], shapes.size());
@@ -90,180 +140,672 @@ static void 	debugDisplayFilterData( DynamicEntity& entity )
 }
 
 //// Physics Functions ////
+
+/// Trigger groups first, then the contact tuning.
+static PxFilterFlags 	sceneFilterShader(
+		PxFilterObjectAttributes attributes0, PxFilterData filterData0,
+		PxFilterObjectAttributes attributes1, PxFilterData filterData1,
+		PxPairFlags& pairFlags, const void* constantBlock, PxU32 constantBlockSize )
+{
+	if (!TriggerVolumes::filterPair(attributes0, filterData0, attributes1, filterData1))
+		return PxFilterFlag::eSUPPRESS;
+	return ContactModifier::filterShader(attributes0, filterData0, attributes1, filterData1,
+			pairFlags, constantBlock, constantBlockSize);
+}
+
 static bool 	initPhysics( void )
 {
-	if (gFoundation)
+	if (gSimulation.isInit())
 		return false; // already init
 
-	gFoundation = PxCreateFoundation(PX_PHYSICS_VERSION, gAllocator, gErrorCallback);
-	PxProfileZoneManager* profileZoneManager = 
-		&PxProfileZoneManager::createProfileZoneManager(gFoundation);
-	gPhysics = PxCreatePhysics(PX_PHYSICS_VERSION, *gFoundation, 
-			PxTolerancesScale(),true,profileZoneManager);
-
-	gDispatcher = PxDefaultCpuDispatcherCreate(2);
-
-	gCooking = PxCreateCooking(PX_PHYSICS_VERSION, *gFoundation, 
-			PxCookingParams(gPhysics->getTolerancesScale()));
-	//PxCookingParams(toleranceScale));
-
-	if (!gCooking)
-		std::cout << "PxCreateCooking failed!" << std::endl;
-
-	gPhysicsMaterial = 
-		gPhysics->createMaterial(0.5f, 0.5f, 0.6f); //static friction, dynamic friction, restitution
-
-	PxSceneDesc sceneDesc(gPhysics->getTolerancesScale());
-	sceneDesc.gravity = PxVec3(0.0f, -9.81f, 0.0f);
-	sceneDesc.cpuDispatcher	= gDispatcher;
-	sceneDesc.filterShader	= PxDefaultSimulationFilterShader;
-	gPhysicsScene = gPhysics->createScene(sceneDesc);
+	// Pin before anything is allocated so the whole scene is local
+	const NumaTopology& topology = NumaTopology::get();
+	const bool numa = USE_NUMA_PLACEMENT && topology.isNuma();
+	if (numa)
+	{
+		const unsigned node = topology.getCurrentNode();
+		numaPinThread(node);
+		gNumaDispatcher.init(node, 2);
+		std::cout << "simulation on NUMA node " << topology.getNodeId(node)
+			<< " of " << topology.getNodeCount() << std::endl;
+	}
 
+	SimulationSettings settings;
+	settings.dispatcher = numa? &gNumaDispatcher : nullptr;
+	settings.filterShader = sceneFilterShader;
+	settings.contactModifyCallback = &gContactModifier;
+	settings.simulationEventCallback = &gTriggers;
+	if (!gSimulation.init(settings))
+		return false;
+
+	gPhysics = &gSimulation.getPhysics();
+	gPhysicsMaterial = &gSimulation.getMaterial();
+	gPhysicsScene = &gSimulation.getScene();
+	gForker.init(*gPhysics, gSimulation.getSceneDesc());
+	gForker.setContactModifier(&gContactModifier);
 	return true;
 }
 
 static void 	deinitPhysics( void )
 {
-	if (gFoundation == nullptr)
+	if (!gSimulation.isInit())
 		return;
 
-	gPhysicsScene->release();
-
-	gDispatcher->release();
-	PxProfileZoneManager* profileZoneManager = gPhysics->getProfileZoneManager();
+	gSpawns.reset();
+	gForker.deinit();
+	gSimulation.deinit();
+	gNumaDispatcher.deinit();
 
-	gPhysics->release();	
-	profileZoneManager->release();
-	gCooking->release();
-	gFoundation->release();
-
-	gDispatcher = nullptr;
 	gPhysics = nullptr;
-	gCooking = nullptr;
-	gFoundation = nullptr;
+	gPhysicsMaterial = nullptr;
+	gPhysicsScene = nullptr;
 }
 
-static DynamicEntity::Ptr 	addEntityBox( float mass, vec3 halfsize, vec3 position )
+/// With VALIDATE_SPAWNS the body waits in gSpawns until flushSpawns(); bodies
+/// of the same non-zero spawn group may overlap each other.
+static EntityId 	addEntityBox( float mass, vec3 halfsize, vec3 position, bool kinematic=false, unsigned spawnGroup=0 )
 {
-	DynamicEntity::Ptr entity(new DynamicEntity());
+	PxRigidDynamic* body = gSimulation.createBox(mass, toPxVec3(halfsize), toPxVec3(position), kinematic);
+	if (AUTO_CONTACT_OFFSETS)
+		applyContactOffsets(*body, EXPECTED_SPEED);
 
-	entity->scale = halfsize * 2.f;
-	entity->position = position;
+	if (VALIDATE_SPAWNS)
+		gSpawns.add(*body, spawnGroup);
+	else
+		gPhysicsScene->addActor(*body);
+
+	Transform transform;
+	transform.position = position;
+	transform.scale = halfsize * 2.f;
+	PhysicsBody physicsBody;
+	physicsBody.actor = body;
+	return gWorld.create(transform, physicsBody, RenderColor(), Visibility());
+}
 
-	PxTransform pxtr(PxVec3(position.x, position.y, position.z), PxQuat(PxIdentity));
-	entity->body = gPhysics->createRigidDynamic(pxtr);
-	entity->body->createShape( PxBoxGeometry(halfsize.x, halfsize.y, halfsize.z), *gPhysicsMaterial );
-	entity->body->userData = (void*)entity.get();
+EntityId 		initGround( vec3 halfsize, vec3 position )
+{
+	PxRigidStatic* body = gSimulation.createStaticBox(toPxVec3(halfsize), toPxVec3(position));
+	if (AUTO_CONTACT_OFFSETS)
+		applyContactOffsets(*body, 0.f);
+
+	gPhysicsScene->addActor(*body);
+
+	Transform transform;
+	transform.position = position;
+	transform.scale = halfsize * 2.f;
+	PhysicsBody physicsBody;
+	physicsBody.actor = body;
+	return gWorld.create(transform, physicsBody, RenderColor(), Visibility());
+}
 
-	PxRigidBodyExt::updateMassAndInertia(*entity->body, 10.f);
-	entity->body->setMass(mass);
+/// Static trigger volume reporting the shapes of the given trigger groups
+/// (0 for all) to gTriggers. Not an entity: it is not drawn.
+static PxRigidStatic* 	addTriggerBox( vec3 halfsize, vec3 position, PxU32 groups=0 )
+{
+	PxRigidStatic* body = gPhysics->createRigidStatic(PxTransform(toPxVec3(position)));
+	TriggerVolumes::createTriggerShape(*body, PxBoxGeometry(halfsize.x, halfsize.y, halfsize.z), *gPhysicsMaterial, groups);
+	gPhysicsScene->addActor(*body);
+	return body;
+}
 
-	gPhysicsScene->addActor(*entity->body);
+static void 	setName( EntityId entity, const char* name )
+{
+	Name n;
+	snprintf(n.text, sizeof(n.text), "%s", name);
+	gWorld.add(entity, n);
+}
 
-	return entity;
+static void 	setColor( EntityId entity, Color color )
+{
+	RenderColor c;
+	c.color = color;
+	gWorld.add(entity, c);
 }
 
-void 	updateStates( void )
+
+//// Filter data watch ////
+
+///
+/// Remembers the filter data of some entities and reports when it changes
+/// (the bug this project isolates: creating a joint alters the filter data).
+///
+struct FilterDataWatch
 {
-	PxU32 nbActors = gPhysicsScene->getNbActors(
-			PxActorTypeSelectionFlag::eRIGID_DYNAMIC);// | PxActorTypeSelectionFlag::eRIGID_STATIC);
+	struct Entry
+	{
+		EntityId 					entity;
+		std::vector<PxFilterData> 	filterData;
+	};
+
+	std::vector<Entry> 	entries;
+	unsigned 			changes = 0;
+	char 				lastAlert[64] = {};
 
-	if(nbActors)
+	void 	watch( EntityId entity )
 	{
-		std::vector<PxRigidActor*> actors(nbActors);
-		gPhysicsScene->getActors(
-				PxActorTypeSelectionFlag::eRIGID_DYNAMIC/* | PxActorTypeSelectionFlag::eRIGID_STATIC*/, 
-				(PxActor**)&actors[0], nbActors);
+		Entry e;
+		e.entity = entity;
+		e.filterData = getFilterData(getDynamic(entity));
+		entries.push_back(e);
+	}
 
-		for (PxRigidActor* actor : actors)
+	/// Returns true when some filter data changed since the last call.
+	bool 	check( void )
+	{
+		bool changed = false;
+		for (Entry& e : entries)
 		{
-			PxTransform localTm = actor->getGlobalPose();
-			DynamicEntity* entity = (DynamicEntity*)actor->userData;
-			entity->position = toVec3(localTm.p);
-			entity->rotation = toQuat(localTm.q);
+			std::vector<PxFilterData> current = getFilterData(getDynamic(e.entity));
+			if (current == e.filterData)
+				continue;
+
+			++changes;
+			changed = true;
+			const Name* name = gWorld.get<Name>(e.entity);
+			snprintf(lastAlert, sizeof(lastAlert), "%s", name? name->text : "?");
+			e.filterData.swap(current);
 		}
+		return changed;
+	}
+};
+
+//// Function for creating joints ////
+
+/// Record the joint on both entities.
+static void 	linkEntities( EntityId entityA, EntityId entityB, PxJoint* joint )
+{
+	const EntityId ends[2] = { entityA, entityB };
+	for (int i = 0; i < 2; ++i)
+	{
+		if (!gWorld.has<JointLink>(ends[i]))
+			gWorld.add(ends[i], JointLink());
+		JointLink& link = *gWorld.get<JointLink>(ends[i]);
+		if (link.count == JointLink::MAX_LINKS)
+			continue;
+		link.joints[link.count] = joint;
+		link.others[link.count] = ends[1 - i];
+		++link.count;
 	}
 }
 
+PxFixedJoint* 	addFixedJoint( EntityId entityA, vec3 posA, EntityId entityB, vec3 posB, bool useWorkaround=false,
+		const JointProjection& projection = JointProjection() )
+{
+	PxFixedJoint* joint = createFixedJoint(*gPhysics, gJointFactory, getDynamic(entityA), toPxVec3(posA),
+			getDynamic(entityB), toPxVec3(posB), useWorkaround, projection);
+	linkEntities(entityA, entityB, joint);
+	return joint;
+}
 
-StaticEntity::Ptr 		initGround( vec3 halfsize, vec3 position )
+/// Create the A/B joint in forks of the scene with other settings, and print
+/// how each one behaves. The scene itself is not touched.
+static void 	forkJointVariants( EntityId entityA, EntityId entityB )
 {
-	StaticEntity::Ptr ground(new StaticEntity());
-	StaticEntity& e = *ground;
-	e.scale = halfsize * 2.f;
-	e.position = position;
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!gForker.capture(*gPhysicsScene))
+		return;
+	const PxSerialObjectId a = gForker.getId(*getDynamic(entityA));
+	const PxSerialObjectId b = gForker.getId(*getDynamic(entityB));
+
+	auto jointVariant = [a, b]( vec3 anchorA, bool workaround, PxU32 positionIters,
+			const JointProjection& projection = JointProjection() ) {
+		return [a, b, anchorA, workaround, positionIters, projection]( SceneFork& fork ) {
+			PxRigidDynamic* bodyA = fork.find<PxRigidDynamic>(a);
+			PxRigidDynamic* bodyB = fork.find<PxRigidDynamic>(b);
+			if (!bodyA || !bodyB)
+				return;
+			if (positionIters)
+			{
+				bodyA->setSolverIterationCounts(positionIters);
+				bodyB->setSolverIterationCounts(positionIters);
+			}
+			createFixedJoint(fork.getPhysics(), gJointFactory, bodyA, toPxVec3(anchorA), bodyB, PxVec3(0.f), workaround, projection);
+		};
+	};
+
+	std::vector<ForkVariant> variants;
+	variants.push_back(ForkVariant{ "no joint", nullptr });
+	variants.push_back(ForkVariant{ "joint", jointVariant(VEC3_ZERO, false, 0) });
+	variants.push_back(ForkVariant{ "joint + workaround", jointVariant(VEC3_ZERO, true, 0) });
+	variants.push_back(ForkVariant{ "joint, anchor +0.25 y", jointVariant(vec3(0.f, 0.25f, 0.f), false, 0) });
+	variants.push_back(ForkVariant{ "joint, 16 iterations", jointVariant(VEC3_ZERO, false, 16) });
+	JointProjection projection;
+	projection.enabled = true;
+	variants.push_back(ForkVariant{ "joint, projection", jointVariant(VEC3_ZERO, false, 0, projection) });
+
+	// fork step s replays step JOINT_STEP + s: settle the A/B contacts as the demo does
+	auto settle = []( SceneFork& fork, unsigned s ) {
+		if (SOFT_AB_CONTACTS && JOINT_STEP + s == SETTLED_STEP && fork.getContactModifier())
+			fork.getContactModifier()->resetGroup(SETTLING_GROUP);
+	};
 
-	PxTransform pxtr(PxVec3(position.x, position.y, position.z), PxQuat(PxIdentity));
-	e.body = gPhysics->createRigidStatic(pxtr);
-	e.body->createShape( PxBoxGeometry(halfsize.x, halfsize.y, halfsize.z), *gPhysicsMaterial );
+	std::vector<ForkMetrics> metrics;
+	if (!gForker.run(variants, FORK_STEPS, STEP_DURATION, { a, b }, metrics, settle))
+		return;
+	std::cout << variants.size() << " forks of " << (gForker.getCaptureBytes() >> 10) << " KB, "
+		<< FORK_STEPS << " steps in " << std::chrono::duration<float, std::milli>(
+				std::chrono::high_resolution_clock::now() - start).count() << " ms" << std::endl;
+	printForkMetrics(std::cout, metrics);
+}
 
-	gPhysicsScene->addActor(*e.body);
-	return ground;
+/// Unlink the joint from its entities, then release it.
+static void 	releaseJoint( PxJoint* joint )
+{
+	gWorld.each<JointLink>([joint]( EntityId, JointLink& link ) {
+		for (unsigned i = 0; i < link.count; ++i)
+			if (link.joints[i] == joint)
+			{
+				--link.count;
+				link.joints[i] = link.joints[link.count];
+				link.others[i] = link.others[link.count];
+				break;
+			}
+	});
+	joint->release();
 }
 
+/// Frictionless, soft contacts between A and B until the joint has settled.
+static ContactTuning 	getSettlingTuning( void )
+{
+	ContactTuning soft;
+	soft.staticFriction = 0.f;
+	soft.dynamicFriction = 0.f;
+	soft.maxImpulse = 20.f;
+	return soft;
+}
 
-//// My workaround functions ////
+//// Controllers ////
 
-static std::vector<PxFilterData> 	getFilterData( DynamicEntity& entity )
+/// Throws every dynamic body around a point upward, through the batched queue.
+static void 	kickBodies( BodyCommandQueue& queue, const PxVec3& center, float radius )
 {
-	PxRigidDynamic* dyn = entity.body;
+	PxU32 nbActors = gPhysicsScene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC);
+	if (nbActors == 0)
+		return;
 
-	std::vector<PxShape*> 	shapes(dyn->getNbShapes());
-	dyn->getShapes(&shapes[0], shapes.size());
+	std::vector<PxRigidDynamic*> actors(nbActors);
+	gPhysicsScene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, (PxActor**)&actors[0], nbActors);
+
+	std::vector<BodyCommand> commands;
+	commands.reserve(nbActors);
+	for (PxRigidDynamic* actor : actors)
+	{
+		PxVec3 offset = actor->getGlobalPose().p - center;
+		offset.y = 0.f;
+		if (offset.magnitudeSquared() > radius * radius)
+			continue;
+
+		BodyCommand c;
+		c.body = actor;
+		c.type = BodyCommand::eFORCE;
+		c.mode = PxForceMode::eVELOCITY_CHANGE;
+		c.value = PxVec3(0.f, 6.f, 0.f);
+		commands.push_back(c);
+
+		c.type = BodyCommand::eTORQUE;
+		c.value = PxVec3(0.f, 2.f, 0.f);
+		commands.push_back(c);
+	}
+	queue.push(commands.data(), commands.size());
+}
+
+//// Animated platforms ////
+
+struct Platform
+{
+	EntityId 			entity;
+	PxVec3 				base;
+	PxVec3 				amplitude;
+	float 				period;
+};
 
-	std::vector<PxFilterData> 	filterData(shapes.size());
+/// A kinematic slab with two welded boxes resting on it.
+static Platform 	addPlatform( vec3 position, vec3 amplitude, float period )
+{
+	Platform p;
+	p.entity = addEntityBox(100.f, vec3(2.f, 0.25f, 2.f), position, true);
+	setColor(p.entity, Color(0.6f, 0.6f, 0.6f));
+	p.base = toPxVec3(position);
+	p.amplitude = toPxVec3(amplitude);
+	p.period = period;
+
+	// welded side by side: they touch
+	static unsigned spawnGroup = 0;
+	++spawnGroup;
+	EntityId left = addEntityBox(5.f, vec3(0.5f), position + vec3(-0.5f, 0.8f, 0.f), false, spawnGroup);
+	EntityId right = addEntityBox(5.f, vec3(0.5f), position + vec3(0.5f, 0.8f, 0.f), false, spawnGroup);
+	JointDescs descs;
+	descs.add(JOINT_FIXED, getDynamic(left), PxTransform(PxVec3(0.5f, 0.f, 0.f)), getDynamic(right), PxTransform(PxVec3(-0.5f, 0.f, 0.f)));
+	PxJoint* joint = nullptr;
+	gJointFactory.create(*gPhysics, descs, &joint);
+	linkEntities(left, right, joint);
+	setColor(left, Color(1.f, 0.6f, 0.2f));
+	setColor(right, Color(1.f, 0.6f, 0.2f));
+	return p;
+}
 
-	for (int i = 0; i < shapes.size(); ++i)
-		filterData[i] = shapes[i]->getSimulationFilterData();
-	return filterData;
+/// Write the pose of every platform at the given time, in order, to targets.
+static void 	animatePlatforms( const std::vector<Platform>& platforms, float time, PxTransform* targets )
+{
+	for (size_t i = 0; i < platforms.size(); ++i)
+	{
+		const Platform& p = platforms[i];
+		float phase = std::sin(time * 2.f * PxPi / p.period);
+		targets[i] = PxTransform(p.base + p.amplitude * phase);
+	}
 }
 
+//// World population ////
 
-static void 	setFilterData( DynamicEntity& entity, const std::vector<PxFilterData>& filterData )
+///
+/// Scatters small stacks and jointed pairs of boxes over [-extent, extent]^2,
+/// stored in the partition: only those around the camera enter the scene.
+///
+static void 	populateWorld( WorldPartition& partition, float extent, const std::function<float (float, float)>& groundHeight )
 {
-	PxRigidDynamic* dyn = entity.body;
+	const float spacing = 12.f;
+	const float clearing = 16.f; // keep the joint test case alone
+	const float half = 0.5f;
+	const Color palette[3] = { Color(1.f, 0.8f, 0.2f), Color(0.8f, 0.4f, 1.f), Color(0.2f, 0.9f, 0.9f) };
+
+	const int n = (int)(extent / spacing);
+	for (int ix = -n; ix <= n; ++ix)
+		for (int iz = -n; iz <= n; ++iz)
+		{
+			const float x = ix * spacing;
+			const float z = iz * spacing;
+			if (x * x + z * z < clearing * clearing)
+				continue;
+
+			// rest on the highest point under the footprint
+			float ground = groundHeight(x, z);
+			for (float dx : { -1.5f, 1.5f })
+				for (float dz : { -half, half })
+					ground = std::max(ground, groundHeight(x + dx, z + dz));
+			ground += 0.05f;
+
+			BodyRecord bodies[3];
+			const unsigned kind = (unsigned)(ix * 7 + iz * 13) % 3;
+			for (BodyRecord& b : bodies)
+			{
+				b.halfExtents = PxVec3(half);
+				b.mass = 10.f;
+				b.color = palette[kind];
+			}
+
+			if (kind < 2)
+			{
+				// a stack of three boxes
+				for (int i = 0; i < 3; ++i)
+					bodies[i].pose = PxTransform(PxVec3(x, ground + half + i * 2.f * (half + 0.01f), z));
+				partition.addGroup(bodies, 3);
+			}
+			else
+			{
+				// two boxes welded side by side
+				bodies[0].pose = PxTransform(PxVec3(x - half, ground + half, z));
+				bodies[1].pose = PxTransform(PxVec3(x + half, ground + half, z));
+
+				JointRecord joint;
+				joint.body0 = 0;
+				joint.body1 = 1;
+				joint.localPose0 = PxTransform(PxVec3(half, 0.f, 0.f));
+				joint.localPose1 = PxTransform(PxVec3(-half, 0.f, 0.f));
+				partition.addGroup(bodies, 2, &joint, 1);
+			}
+		}
+}
 
-	std::vector<PxShape*> 	shapes(dyn->getNbShapes());
-	dyn->getShapes(&shapes[0], shapes.size());
+//// Render packets ////
 
-	for (int i = 0; i < shapes.size(); ++i)
-		shapes[i]->setSimulationFilterData(filterData[i]);
+/// Chassis and wheels, colors[i] for the chassis of vehicle i.
+static void 	appendVehicleBoxes( const Vehicles& vehicles, const std::vector<Color>& colors, BoxInstances& boxes )
+{
+	const VehicleSettings& settings = vehicles.getSettings();
+	const PxVec3& he = settings.chassisHalfExtents;
+	const vec3 chassisSize(he.x * 2.f, he.y * 2.f, he.z * 2.f);
+	const vec3 wheelSize(settings.wheelWidth, settings.wheelRadius * 2.f, settings.wheelRadius * 2.f);
+	const Color wheelColor(0.15f, 0.15f, 0.15f);
+
+	PxShape* shapes[Vehicles::WHEEL_COUNT + 1];
+	for (size_t v = 0; v < vehicles.size(); ++v)
+	{
+		PxRigidDynamic* actor = vehicles.getActor(v);
+		const PxTransform pose = actor->getGlobalPose();
+		actor->getShapes(shapes, Vehicles::WHEEL_COUNT + 1);
+
+		for (unsigned s = 0; s <= Vehicles::WHEEL_COUNT; ++s)
+		{
+			PxTransform t = pose * shapes[s]->getLocalPose();
+			const bool wheel = (s < Vehicles::WHEEL_COUNT);
+
+			BoxInstance instance;
+			mat4 model = mat4_cast(toQuat(t.q));
+			model = model * glm::scale(mat4(1.f), wheel? wheelSize : chassisSize);
+			instance.model = glm::translate(mat4(1.f), toVec3(t.p)) * model;
+			instance.color = wheel? wheelColor : colors[v];
+			boxes.push_back(instance);
+		}
+	}
 }
 
-//// Function for creating joints ////
+static void 	appendJointFrames( std::vector<DebugLine>& lines )
+{
+	PxU32 nbConstraints = gPhysicsScene->getNbConstraints();
+	if (nbConstraints == 0)
+		return;
+
+	std::vector<PxConstraint*> constraints(nbConstraints);
+	gPhysicsScene->getConstraints(&constraints[0], nbConstraints);
+
+	const float axisLength = 0.5f;
+	const Color axisColors[3] = { Color(1.f, 0.f, 0.f), Color(0.f, 1.f, 0.f), Color(0.f, 0.f, 1.f) };
+
+	for (PxConstraint* c : constraints)
+	{
+		PxU32 typeID = 0;
+		PxJoint* joint = (PxJoint*)c->getExternalReference(typeID);
+		if (typeID != PxConstraintExtIDs::eJOINT)
+			continue;
 
-void 	addFixedJoint( DynamicEntity& entityA, vec3 posA, DynamicEntity& entityB, vec3 posB, bool useWorkaround=false )
+		PxRigidActor* actors[2] = { nullptr, nullptr };
+		joint->getActors(actors[0], actors[1]);
+
+		// both anchor frames are drawn: they overlap when the joint is satisfied
+		for (int i = 0; i < 2; ++i)
+		{
+			PxTransform frame = joint->getLocalPose((PxJointActorIndex::Enum)i);
+			if (actors[i])
+				frame = actors[i]->getGlobalPose() * frame;
+
+			const PxVec3 axes[3] = { frame.q.getBasisVector0(), frame.q.getBasisVector1(), frame.q.getBasisVector2() };
+			for (int a = 0; a < 3; ++a)
+			{
+				DebugLine line;
+				line.from = toVec3(frame.p);
+				line.to = toVec3(frame.p + axes[a] * axisLength);
+				line.color = axisColors[a];
+				lines.push_back(line);
+			}
+		}
+	}
+}
+
+static void 	fillHudStats( HudStats& hud, float stepMs, const FilterDataWatch& watch )
 {
-	//gPhysicsScene->removeActor(*entityA.body);
-	//gPhysicsScene->addActor(*entityA.body);
+	PxSimulationStatistics stats;
+	gPhysicsScene->getSimulationStatistics(stats);
+
+	hud.stepMs = stepMs;
+	hud.bodies = gPhysicsScene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC);
+	hud.activeBodies = stats.nbActiveDynamicBodies + stats.nbActiveKinematicBodies;
+	hud.joints = gPhysicsScene->getNbConstraints();
+	hud.contacts = stats.nbDiscreteContactPairsWithContacts;
+	hud.pairs = stats.nbDiscreteContactPairsTotal;
+	hud.filterDataChanges = watch.changes;
+	snprintf(hud.lastAlert, sizeof(hud.lastAlert), "%s", watch.lastAlert);
+}
 
-	//entityA.body->clearForce();
-	//entityA.body->clearForce(PxForceMode::eIMPULSE);
-	//entityA.body->clearTorque();
-	//entityA.body->clearTorque(PxForceMode::eIMPULSE);
-	//entityA.body->setLinearVelocity(PxVec3(0, 0, 0));
-	//entityA.body->setAngularVelocity(PxVec3(0, 0, 0));
-	//PxRigidBodyExt::updateMassAndInertia(*entityA.body, 10.f);
+//// Entity systems ////
 
+/// Shared by the systems of one frame: inputs set before the run, outputs read after.
+struct FrameBuild
+{
+	mat4 			viewProj;
+	BoxInstances* 	boxes 		= nullptr;
+	unsigned 		entities 	= 0;
+	unsigned 		sleeping 	= 0;
+	unsigned 		joints 		= 0;
+};
 
-	PxTransform otherPXTr = entityB.body->getGlobalPose();
-	PxTransform meAnchor( toPxVec3(posA), PxQuat(PxIdentity) );
-	PxTransform otherAnchor( toPxVec3(posB), PxQuat(PxIdentity) );
+/// Tag the entities whose body does not move (asleep or static): the pose
+/// sync skips them. Changes archetypes, so it runs before the systems.
+static void 	updateSleeping( World& world )
+{
+	static std::vector<EntityId> 	fellAsleep;
+	static std::vector<EntityId> 	wokeUp;
+	fellAsleep.clear();
+	wokeUp.clear();
+
+	const ComponentMask sleeping = componentMask<Sleeping>();
+	world.each<const PhysicsBody>([&]( EntityId entity, const PhysicsBody& body ) {
+		PxRigidDynamic* dynamic = body.actor->is<PxRigidDynamic>();
+		if (!dynamic || dynamic->isSleeping())
+			fellAsleep.push_back(entity);
+	}, sleeping);
+	world.each<const PhysicsBody, const Sleeping>([&]( EntityId entity, const PhysicsBody& body, const Sleeping& ) {
+		PxRigidDynamic* dynamic = body.actor->is<PxRigidDynamic>();
+		if (dynamic && !dynamic->isSleeping())
+			wokeUp.push_back(entity);
+	});
+
+	for (EntityId entity : fellAsleep)
+		world.add(entity, Sleeping());
+	for (EntityId entity : wokeUp)
+		world.remove<Sleeping>(entity);
+}
 
-	PxTransform newMeTr = meAnchor.getInverse() * otherPXTr * otherAnchor;
-	entityA.body->setGlobalPose(newMeTr);
+/// Asleep bodies are skipped unless the exclusion is lifted (after a rewind).
+static void 	syncPoses( World& world, ComponentMask exclude = componentMask<Sleeping>() )
+{
+	world.each<Transform, const PhysicsBody>([]( EntityId, Transform& transform, const PhysicsBody& body ) {
+		PxTransform pose = body.actor->getGlobalPose();
+		transform.position = toVec3(pose.p);
+		transform.rotation = toQuat(pose.q);
+	}, exclude);
+}
+
+/// Add the validated spawns to the scene. The rejected bodies are released
+/// with their joints and entities; the nudged ones get their new pose.
+static void 	flushSpawns( void )
+{
+	if (!gSpawns.getPendingCount())
+		return;
 
-	PxFixedJoint* joint = PxFixedJointCreate(
-			*gPhysics, entityB.body, otherAnchor, entityA.body, meAnchor);
-				
-	if (useWorkaround)
+	std::vector<PxRigidActor*> rejected;
+	gSpawns.flush(*gPhysicsScene, rejected);
+	std::vector<EntityId> entities;
+	gWorld.each<const PhysicsBody>([&rejected, &entities]( EntityId entity, const PhysicsBody& body ) {
+		if (std::find(rejected.begin(), rejected.end(), body.actor) != rejected.end())
+			entities.push_back(entity);
+	});
+	for (EntityId entity : entities)
 	{
-		auto fd = getFilterData(entityA);
-		joint->setConstraintFlag( PxConstraintFlag::eCOLLISION_ENABLED, false );
-		setFilterData(entityA, fd);
+		if (JointLink* link = gWorld.get<JointLink>(entity))
+			while (link->count)
+				releaseJoint(link->joints[0]);
+		gWorld.destroy(entity);
 	}
-	else
-		joint->setConstraintFlag( PxConstraintFlag::eCOLLISION_ENABLED, false );
+	for (PxRigidActor* actor : rejected)
+		actor->release();
+	syncPoses(gWorld);
+
+	const SpawnStats& stats = gSpawns.getLastStats();
+	std::cout << "spawns: " << stats.checked << " checked, " << stats.overlapping << " overlapping, "
+		<< stats.nudged << " nudged, " << stats.rejected << " rejected in " << stats.validateMs << " ms" << std::endl;
+}
+
+static void 	countEntities( World& world, FrameBuild& frame )
+{
+	frame.entities = world.count<PhysicsBody>();
+	frame.sleeping = world.count<PhysicsBody, Sleeping>();
+	unsigned links = 0;
+	world.each<const JointLink>([&]( EntityId, const JointLink& link ) { links += link.count; });
+	frame.joints = links / 2; // seen from both ends
+}
+
+/// Bounding spheres against the view frustum.
+static void 	cullEntities( World& world, const FrameBuild& frame )
+{
+	// planes from the rows of the matrix (Gribb & Hartmann), normals inward
+	const mat4& m = frame.viewProj;
+	vec4 rows[4];
+	for (int r = 0; r < 4; ++r)
+		rows[r] = vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+	vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+		rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+	for (vec4& p : planes)
+		p /= length(vec3(p));
+
+	world.each<Visibility, const Transform>([&]( EntityId, Visibility& visibility, const Transform& transform ) {
+		const float radius = length(transform.scale) * 0.5f;
+		visibility.visible = true;
+		for (const vec4& p : planes)
+			if (dot(vec3(p), transform.position) + p.w < -radius)
+			{
+				visibility.visible = false;
+				break;
+			}
+	});
+}
+
+static void 	fillInstances( World& world, FrameBuild& frame )
+{
+	frame.boxes->reserve(frame.boxes->size() + world.count<Transform, RenderColor, Visibility>());
+	world.each<const Transform, const RenderColor, const Visibility>([&]( EntityId,
+				const Transform& transform, const RenderColor& color, const Visibility& visibility ) {
+		if (!visibility.visible)
+			return;
+		BoxInstance instance;
+		instance.model = transform.getModelMatrix();
+		instance.color = color.color;
+		frame.boxes->push_back(instance);
+	});
+}
+
+/// Pose sync and stats run together, then culling, then the instance fill.
+static void 	addEntitySystems( SystemScheduler& systems, FrameBuild& frame )
+{
+	systems.add("pose sync", accessOf<Transform, const PhysicsBody>(),
+			[]( World& world ) { syncPoses(world); });
+	systems.add("stats", accessOf<const PhysicsBody, const Sleeping, const JointLink>(),
+			[&frame]( World& world ) { countEntities(world, frame); });
+	systems.add("culling", accessOf<Visibility, const Transform>(),
+			[&frame]( World& world ) { cullEntities(world, frame); });
+	systems.add("instance fill", accessOf<const Transform, const RenderColor, const Visibility>(),
+			[&frame]( World& world ) { fillInstances(world, frame); });
+}
+
+static std::shared_ptr<FramePacket> 	buildFramePacket( SystemScheduler& systems, FrameBuild& frame,
+		const mat4& proj, const mat4& view, HudStats& hud )
+{
+	std::shared_ptr<FramePacket> packet(new FramePacket());
+
+	frame.viewProj = proj * view;
+	frame.boxes = &packet->boxes;
+	systems.run(gWorld);
+	frame.boxes = nullptr;
+
+	hud.entities = frame.entities;
+	hud.sleepingEntities = frame.sleeping;
+	hud.entityJoints = frame.joints;
+	hud.systemsMs = systems.getLastRunMs();
+
+	packet->view = view;
+	packet->hud = hud;
+	appendJointFrames(packet->lines);
+
+	return packet;
 }
 
 int 	main ( void )
@@ -279,61 +821,369 @@ int 	main ( void )
 	if (graphics.init(1280, 720) == false)
 		return 1;
 
+	gAllocator.setEnabled(USE_HUGE_PAGES);
 	if (initPhysics() == false)
 		return 0;
 
-	StaticEntity::Ptr ground = initGround(vec3(90.f, 0.5f, 90.f), VEC3_ZERO);
+	Camera camera;
+	Terrain terrain;
+	EntityId ground = INVALID_ENTITY;
+	const vec3 groundHalfsize(90.f, 0.5f, 90.f);
+	if (USE_TERRAIN && terrain.init(*gPhysics, *gPhysicsScene, *gPhysicsMaterial))
+	{
+		// the bodies below must not fall through: wait for the first tiles
+		PxVec3 origin(0.f);
+		terrain.load(&origin, 1);
+	}
+	else
+	{
+		ground = initGround(groundHalfsize, VEC3_ZERO);
+		setColor(ground, Color(0.2f, 0.2f, 1.f));
+	}
+
+	PxRigidStatic* killZone = nullptr;
+	if (USE_KILL_ZONE)
+		killZone = addTriggerBox(vec3(1000.f, 1.f, 1000.f), vec3(0.f, KILL_HEIGHT, 0.f));
 
 	// 'C' is used to make 'B' stands above the ground so that no collision will
 	// interfere between 'A' and the ground when A will be fixed to B.
-	DynamicEntity::Ptr C = addEntityBox(1000.f, vec3(8.f, 0.25f, 1.5f), vec3(0.f, 2.0, 0.f));
-	DynamicEntity::Ptr B = addEntityBox(1000.f, vec3(8.f, 0.25f, 1.5f), vec3(0.f, 4.f, 0.f));
-	addFixedJoint(*C, vec3(0.f, 1.f, 0.f), *B, vec3(0.f, -1.f, 0.f));
+	EntityId C = addEntityBox(1000.f, vec3(8.f, 0.25f, 1.5f), vec3(0.f, 2.0, 0.f));
+	EntityId B = addEntityBox(1000.f, vec3(8.f, 0.25f, 1.5f), vec3(0.f, 4.f, 0.f));
+	addFixedJoint(C, vec3(0.f, 1.f, 0.f), B, vec3(0.f, -1.f, 0.f));
+
+	EntityId A = addEntityBox(50.f, vec3(0.5f, 0.5f, 0.5f), vec3(0.f, 5.f, 0.f));
+	flushSpawns();
+
+	setName(A, "A");
+	setName(B, "B");
+	setName(C, "C");
+	setColor(A, Color(0.2f, 1.f, 0.2f));
+	setColor(B, Color(1.f, 0.2f, 0.2f));
+	setColor(C, Color(1.f, 0.2f, 0.2f));
+	std::function<float (float, float)> groundHeight;
+	if (ground != INVALID_ENTITY)
+	{
+		const float top = groundHalfsize.y;
+		groundHeight = [top]( float, float ) { return top; };
+	}
+	else
+		groundHeight = [&terrain]( float x, float z ) { return terrain.getHeight(x, z); };
 
-	DynamicEntity::Ptr A = addEntityBox(50.f, vec3(0.5f, 0.5f, 0.5f), vec3(0.f, 5.f, 0.f));
+	WorldPartition partition;
+	if (USE_WORLD_PARTITION && partition.init(*gPhysics, *gPhysicsScene, *gPhysicsMaterial))
+	{
+		if (ground == INVALID_ENTITY)
+		{
+			partition.setGroundCheck([&terrain]( float x, float z ) { return terrain.isResident(x, z); });
+			populateWorld(partition, 256.f, groundHeight);
+		}
+		else
+			populateWorld(partition, groundHalfsize.x - 4.f, groundHeight);
+		PxVec3 origin(0.f);
+		partition.update(&origin, 1);
+	}
+
+	// Characters wander on the flat area behind the joint test case, around a
+	// rotating gate that only exists for them
+	CharacterCrowd crowd;
+	const PxVec3 crowdCenter(0.f, 0.f, -20.f);
+	PxVec3 gateCenter = crowdCenter + PxVec3(0.f, groundHeight(crowdCenter.x, crowdCenter.z) + 1.f, 0.f);
+	ObstacleHandle gate = 0;
+	if (CROWD_SIZE && crowd.init(*gPhysicsScene, *gPhysicsMaterial))
+	{
+		crowd.setArea(crowdCenter);
+		gate = crowd.addBoxObstacle(gateCenter, PxVec3(6.f, 1.f, 0.3f));
 
-	auto t0 = std::chrono::high_resolution_clock::now();
+		const unsigned side = (unsigned)std::ceil(std::sqrt((float)CROWD_SIZE));
+		const float spacing = 1.f;
+		for (unsigned i = 0; i < CROWD_SIZE; ++i)
+		{
+			float x = crowdCenter.x + ((i % side) - side * 0.5f) * spacing;
+			float z = crowdCenter.z + ((i / side) - side * 0.5f) * spacing;
+			if (std::abs(z - crowdCenter.z) < 1.f)
+				continue; // leave the gate free
+			Color color(0.3f + 0.7f * (i % 7) / 6.f, 0.5f, 1.f - 0.7f * (i % 5) / 4.f);
+			crowd.spawn(PxVec3(x, groundHeight(x, z), z), color);
+		}
+	}
+
+	Vehicles vehicles;
+	std::vector<Color> vehicleColors;
+	if (VEHICLE_COUNT && vehicles.init(*gPhysics, *gPhysicsScene, *gPhysicsMaterial, VEHICLE_COUNT))
+	{
+		for (unsigned i = 0; i < VEHICLE_COUNT; ++i)
+		{
+			float x = (i % 8) * 4.f - 14.f;
+			float z = 20.f + (i / 8) * 7.f;
+			PxTransform pose(PxVec3(x, groundHeight(x, z) + 1.2f, z));
+			if (vehicles.spawn(pose))
+				vehicleColors.push_back(Color(0.9f, 0.2f + 0.1f * (i % 8), 0.2f));
+		}
+	}
+
+	std::vector<Platform> platforms;
+	KinematicDriver kinematics;
+	if (USE_PLATFORMS)
+	{
+		platforms.push_back(addPlatform(vec3(-6.f, 3.f, 8.f), vec3(0.f, 2.f, 0.f), 4.f));
+		platforms.push_back(addPlatform(vec3(6.f, 1.5f, 8.f), vec3(3.f, 0.f, 0.f), 5.f));
+		flushSpawns();
+		platforms.erase(std::remove_if(platforms.begin(), platforms.end(), []( const Platform& p ) {
+			return !gWorld.isAlive(p.entity);
+		}), platforms.end());
+		for (Platform& p : platforms)
+			kinematics.add(*getDynamic(p.entity));
+	}
+
+	if (SOFT_AB_CONTACTS)
+	{
+		gContactModifier.setGroup(SETTLING_GROUP, getSettlingTuning());
+		ContactModifier::setActorGroups(*getDynamic(A), 1u << SETTLING_GROUP);
+		ContactModifier::setActorGroups(*getDynamic(B), 1u << SETTLING_GROUP);
+	}
+
+	BodyCommandQueue bodyCommands;
+	FilterDataWatch filterDataWatch;
+	filterDataWatch.watch(A);
+	filterDataWatch.watch(B);
+	filterDataWatch.watch(C);
+	HudStats hud;
+
+	FrameBuild frame;
+	SystemScheduler systems;
+	systems.init(2);
+	addEntitySystems(systems, frame);
+	const mat4 proj = graphics.getProjection();
+
+	// From here the GL context belongs to the render thread: this thread only
+	// handles input and simulation.
+	RenderThread renderThread;
+	const bool rendering = renderThread.start(graphics);
+	if (!rendering)
+		std::cout << "failed to start the render thread" << std::endl;
+
+	SceneHistory history;
+	history.init(*gPhysicsScene, REWIND_BUDGET);
+	history.record(0);
+	// streamed out bodies must not be rewound onto the actors that reuse their addresses
+	partition.setActorsRemoved([&history]( PxRigidActor* const* actors, size_t count ) {
+		history.bodiesRemoved(actors, count);
+	});
+
+	auto nextStep = std::chrono::high_resolution_clock::now();
+	unsigned step = 0;
+	int rewindSteps = 0; ///< requested, -1 for as far as buffered
 	bool createJoint = false;
-	while (true)
+	bool settled = false;
+	bool debugNormals = false;
+	float simTime = 0.f;
+	bool quit = !rendering; // straight to the cleanup
+	bool idle = false;
+	mat4 lastView = camera.getView();
+
+	// Returns whether the event needs a new frame
+	auto handleEvent = [&]( const SDL_Event& ev ) -> bool
 	{
-		SDL_Event 	ev;
-		SDL_PollEvent( &ev );
 		if (ev.type == SDL_QUIT || (ev.type == SDL_KEYDOWN && ev.key.keysym.sym == SDLK_ESCAPE))
-			break;
+		{
+			quit = true;
+			return true;
+		}
+		if (ev.type == SDL_WINDOWEVENT)
+			return ev.window.event == SDL_WINDOWEVENT_EXPOSED;
+		if (ev.type != SDL_KEYDOWN)
+			return false;
 
-		auto t1 = std::chrono::high_resolution_clock::now();
-		if (!createJoint && std::chrono::duration<float>(t1-t0).count() > 3.f)
+		const float panStep = 2.f;
+		switch (ev.key.keysym.sym)
 		{
-			debugDisplayFilterData(*A);
-			debugDisplayFilterData(*B);
-			addFixedJoint(*A, vec3(0.f, 0.f, 0.f), *B, vec3(0.f, 0.f, 0.f),	/*WORKAROUND-->*/ false);
-			debugDisplayFilterData(*A);
-			debugDisplayFilterData(*B);
+			case SDLK_F8: debugNormals = !debugNormals; break;
+			case SDLK_F9:
+				if (!ev.key.repeat) // holding the key must not flip it on every repeat
+					renderThread.setCapturing(!renderThread.isCapturing());
+				break;
+			case SDLK_F10: gAllocator.report(std::cout); break;
+			case SDLK_r: rewindSteps = (ev.key.keysym.mod & KMOD_SHIFT)? -1 : REWIND_STEPS; break;
+			case SDLK_SPACE: kickBodies(bodyCommands, toPxVec3(camera.center), 20.f); break;
+			case SDLK_w: case SDLK_UP: camera.pan(0.f, panStep); break;
+			case SDLK_s: case SDLK_DOWN: camera.pan(0.f, -panStep); break;
+			case SDLK_a: case SDLK_LEFT: camera.pan(-panStep, 0.f); break;
+			case SDLK_d: case SDLK_RIGHT: camera.pan(panStep, 0.f); break;
+			default: break;
+		}
+		return true;
+	};
 
-			createJoint = true;
+	while (!quit)
+	{
+		SDL_Event 	ev;
+		bool woken = false;
+		// Nothing moves: block until input, checking again every second
+		if (idle && SDL_WaitEventTimeout(&ev, 1000))
+			woken = handleEvent(ev);
+		while (SDL_PollEvent( &ev ))
+			woken = handleEvent(ev) || woken;
+		if (idle)
+		{
+			if (!woken)
+				continue;
+			// resume without a backlog of steps
+			idle = false;
+			nextStep = std::chrono::high_resolution_clock::now();
 		}
 
-		gPhysicsScene->simulate(1.f/60.f);
-		gPhysicsScene->fetchResults(true);
+		if (rewindSteps != 0 && !history.empty())
+		{
+			const unsigned oldest = history.getOldestStep();
+			unsigned target = oldest;
+			if (rewindSteps > 0 && step >= oldest + rewindSteps)
+				target = step - rewindSteps;
+
+			std::vector<PxJoint*> joints;
+			if (history.rewind(target, joints))
+			{
+				for (PxJoint* joint : joints)
+					releaseJoint(joint);
+				step = target;
+				simTime = step * STEP_DURATION;
+				// changes happen before their step, the target one included replays them
+				createJoint = step > JOINT_STEP;
+				if (SOFT_AB_CONTACTS && settled && step <= SETTLED_STEP)
+				{
+					gContactModifier.setGroup(SETTLING_GROUP, getSettlingTuning());
+					settled = false;
+				}
+				// bodies restored asleep still need their new pose
+				updateSleeping(gWorld);
+				syncPoses(gWorld, 0);
+				std::cout << "rewound to step " << step << " (" << history.getOldestStep() << " to "
+					<< history.getNewestStep() << " buffered, " << (history.getUsedBytes() >> 20) << " MB)" << std::endl;
+			}
+		}
+		rewindSteps = 0;
 
-		updateStates();
-		graphics.clear();
+		// the test case replays the same way after a rewind
+		if (!createJoint && step >= JOINT_STEP)
+		{
+			if (FORK_AT_JOINT)
+				forkJointVariants(A, B);
+			debugDisplayFilterData(A);
+			debugDisplayFilterData(B);
+			PxJoint* joint = addFixedJoint(A, vec3(0.f, 0.f, 0.f), B, vec3(0.f, 0.f, 0.f),	/*WORKAROUND-->*/ false);
+			history.jointAdded(joint);
+			debugDisplayFilterData(A);
+			debugDisplayFilterData(B);
 
-		// Ground
-		graphics.drawBox(ground->getModelMatrix(), Color(0.2f, 0.2f, 1.f));
-		graphics.drawBox(A->getModelMatrix(), Color(0.2f, 1.f, 0.2f));
-		graphics.drawBox(B->getModelMatrix(), Color(1.f, 0.2f, 0.2f));
-		graphics.drawBox(C->getModelMatrix(), Color(1.f, 0.2f, 0.2f));
+			createJoint = true;
+		}
+		if (SOFT_AB_CONTACTS && createJoint && !settled && step >= SETTLED_STEP)
+		{
+			gContactModifier.resetGroup(SETTLING_GROUP);
+			settled = true;
+		}
+
+		// everything queued during the frame lands at the step boundary
+		bodyCommands.flush(*gPhysicsScene);
+		animatePlatforms(platforms, simTime, kinematics.getTargets());
+		kinematics.apply();
+		if (crowd.size())
+		{
+			crowd.moveBoxObstacle(gate, gateCenter, PxQuat(simTime * 0.5f, PxVec3(0.f, 1.f, 0.f)));
+			crowd.update(STEP_DURATION);
+		}
+		vehicles.update(STEP_DURATION);
+		simTime += STEP_DURATION;
 
-		graphics.refresh();
-		usleep(1000);
+		auto stepStart = std::chrono::high_resolution_clock::now();
+		gPhysicsScene->simulate(STEP_DURATION);
+		gPhysicsScene->fetchResults(true);
+		float stepMs = std::chrono::duration<float, std::milli>(
+				std::chrono::high_resolution_clock::now() - stepStart).count();
+		++step;
+
+		// fallen bodies go back above the ground where they left it
+		TriggerSpan triggered = gTriggers.collect();
+		for (const TriggerEvent& e : triggered)
+		{
+			PxRigidDynamic* body = e.otherActor? e.otherActor->is<PxRigidDynamic>() : nullptr;
+			if (!e.entered || e.triggerActor != killZone || !body
+					|| (body->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC))
+				continue;
+			PxVec3 p = body->getGlobalPose().p;
+			p.x = std::max(-80.f, std::min(p.x, 80.f));
+			p.z = std::max(-80.f, std::min(p.z, 80.f));
+			p.y = groundHeight(p.x, p.z) + 10.f;
+			body->setGlobalPose(PxTransform(p));
+			body->setLinearVelocity(PxVec3(0.f));
+			body->setAngularVelocity(PxVec3(0.f));
+		}
+		history.record(step);
+
+		updateSleeping(gWorld);
+		if (filterDataWatch.check())
+			std::cout << "filter data changed: " << filterDataWatch.lastAlert << std::endl;
+
+		// tiles and cells are only swapped between steps, the ground first
+		const PxVec3 pointsOfInterest[] = { toPxVec3(camera.center), toPxVec3(camera.eye), getDynamic(A)->getGlobalPose().p };
+		if (USE_TERRAIN)
+			terrain.update(pointsOfInterest, 3);
+		if (USE_WORLD_PARTITION)
+			partition.update(pointsOfInterest, 3);
+
+		fillHudStats(hud, stepMs, filterDataWatch);
+		if (step == 1)
+			std::cout << "first step: " << stepMs << " ms, " << hud.contacts << " contact pairs of "
+				<< hud.pairs << " in the narrow phase" << std::endl;
+		gContactModifier.collectStats(hud.modifiedPairs, hud.contactModifyMs);
+		hud.storedBodies = partition.getStoredBodyCount();
+		hud.characters = crowd.size();
+		hud.crowdMs = crowd.getLastUpdateMs();
+		hud.vehicles = vehicles.size();
+		hud.vehicleMs = vehicles.getLastUpdateMs();
+		hud.triggerEvents = triggered.size;
+		hud.droppedTriggerEvents = gTriggers.collectDropped();
+		std::shared_ptr<FramePacket> packet = buildFramePacket(systems, frame, proj, camera.getView(), hud);
+		partition.appendBoxes(packet->boxes);
+		crowd.appendCapsules(packet->capsules);
+		crowd.appendObstacleBoxes(packet->boxes);
+		appendVehicleBoxes(vehicles, vehicleColors, packet->boxes);
+		terrain.fillRenderData(packet->terrain);
+		packet->debugNormals = debugNormals;
+		renderThread.submit(packet);
+
+		// Idle once everything is asleep and this frame showed the current camera
+		const mat4 view = camera.getView();
+		idle = IDLE_WHEN_ASLEEP && hud.activeBodies == 0 && view == lastView
+			&& createJoint && (settled || !SOFT_AB_CONTACTS) && !bodyCommands.hasPending()
+			&& !terrain.isStreaming() && !renderThread.isCapturing();
+		lastView = view;
+		if (idle)
+			continue;
+
+		// Presentation no longer paces the loop (vsync happens on the render
+		// thread), so keep stepping in real time here. Drop the backlog when
+		// running late instead of trying to catch up.
+		nextStep += std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+				std::chrono::duration<float>(STEP_DURATION));
+		auto now = std::chrono::high_resolution_clock::now();
+		if (nextStep < now)
+			nextStep = now;
+		else
+			std::this_thread::sleep_until(nextStep);
 	}
 
+	renderThread.stop();
+	history.deinit();
+	systems.deinit();
 	graphics.deinit();
+	vehicles.deinit();
+	crowd.deinit();
+	partition.deinit();
+	terrain.deinit();
+	gAllocator.report(std::cout);
 	deinitPhysics();
 
 	SDL_Quit();
 
-	return 0;
+	return rendering? 0 : 1;
 }
-
@@ -0,0 +1,395 @@
+
+# include <Python.h>
+# include <vector>
+# include "Simulation.hpp"
+
+using namespace physx;
+
+///
+/// mcplane: the physics core of the demo as a Python module.
+///
+///   scene = mcplane.Scene(threads=2)
+///   scene.add_ground((50, 1, 50), (0, -1, 0))
+///   a = scene.add_box(1, (.5, .5, .5), (0, 2, 0))
+///   b = scene.add_box(1, (.5, .5, .5), (0, .5, 0))
+///   scene.attach(a, (0, -.5, 0), b, (0, .5, 0), workaround=True)
+///   scene.step(120)
+///   poses = scene.poses             # numpy (n, 7) float32, no copy
+///
+/// poses, velocities and filter_data are read-only NumPy arrays over the
+/// BodyArrays of the scene: step() and attach() update them in place. The
+/// body count cannot change while one of them is alive (like resizing an
+/// exported bytearray, add_box() raises BufferError).
+///
+
+enum ArrayKind
+{
+	ARRAY_POSES,
+	ARRAY_VELOCITIES,
+	ARRAY_FILTER_DATA
+};
+
+struct SceneObject
+{
+	PyObject_HEAD
+	Simulation* 					simulation;
+	JointFactory* 					factory;
+	std::vector<PxRigidDynamic*>* 	bodies;
+	std::vector<PxRigidActor*>* 	statics;
+	std::vector<PxJoint*>* 			joints;
+	BodyArrays* 					arrays;
+	Py_ssize_t 						exports;  ///< buffers handed out and not released
+};
+
+/// Exports one of the arrays of a scene through the buffer protocol.
+struct ArrayObject
+{
+	PyObject_HEAD
+	SceneObject* 	scene;
+	ArrayKind 		kind;
+	Py_ssize_t 		shape[2];
+	Py_ssize_t 		strides[2];
+};
+
+static PyTypeObject 	SceneType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+static PyTypeObject 	ArrayType = { PyVarObject_HEAD_INIT(nullptr, 0) };
+static PyObject* 		gNumpyAsArray = nullptr;
+
+
+//// Array ////
+
+static int 	arrayGetBuffer( PyObject* self, Py_buffer* view, int flags )
+{
+	ArrayObject* array = (ArrayObject*)self;
+	if (flags & PyBUF_WRITABLE)
+	{
+		PyErr_SetString(PyExc_BufferError, "mcplane arrays are read-only");
+		return -1;
+	}
+
+	static float empty = 0.f; // a valid address for 0 bodies
+	const BodyArrays& arrays = *array->scene->arrays;
+	const void* data = nullptr;
+	unsigned columns = 0;
+	switch (array->kind)
+	{
+		case ARRAY_POSES:
+			data = arrays.getPoses();
+			columns = BodyArrays::POSE_FLOATS;
+			break;
+		case ARRAY_VELOCITIES:
+			data = arrays.getVelocities();
+			columns = BodyArrays::VELOCITY_FLOATS;
+			break;
+		case ARRAY_FILTER_DATA:
+			data = arrays.getFilterData();
+			columns = BodyArrays::FILTER_WORDS;
+			break;
+	}
+
+	array->shape[0] = arrays.size();
+	array->shape[1] = columns;
+	array->strides[0] = columns * 4;
+	array->strides[1] = 4;
+
+	view->buf = const_cast<void*>(data? data : &empty);
+	view->obj = self;
+	Py_INCREF(self);
+	view->len = array->shape[0] * array->strides[0];
+	view->readonly = 1;
+	view->itemsize = 4;
+	view->format = (flags & PyBUF_FORMAT)? const_cast<char*>(array->kind == ARRAY_FILTER_DATA? "I" : "f") : nullptr;
+	view->ndim = 2;
+	view->shape = (flags & PyBUF_ND)? array->shape : nullptr;
+	view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES)? array->strides : nullptr;
+	view->suboffsets = nullptr;
+	view->internal = nullptr;
+	++array->scene->exports;
+	return 0;
+}
+
+static void 	arrayReleaseBuffer( PyObject* self, Py_buffer* )
+{
+	--((ArrayObject*)self)->scene->exports;
+}
+
+static void 	arrayDealloc( PyObject* self )
+{
+	Py_XDECREF(((ArrayObject*)self)->scene);
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyBufferProcs 	arrayBufferProcs = { arrayGetBuffer, arrayReleaseBuffer };
+
+/// numpy.asarray() over a new ArrayObject, which the array keeps alive.
+static PyObject* 	getArray( SceneObject* scene, ArrayKind kind )
+{
+	if (!gNumpyAsArray)
+	{
+		PyObject* numpy = PyImport_ImportModule("numpy");
+		if (!numpy)
+			return nullptr;
+		gNumpyAsArray = PyObject_GetAttrString(numpy, "asarray");
+		Py_DECREF(numpy);
+		if (!gNumpyAsArray)
+			return nullptr;
+	}
+
+	ArrayObject* array = PyObject_New(ArrayObject, &ArrayType);
+	if (!array)
+		return nullptr;
+	Py_INCREF(scene);
+	array->scene = scene;
+	array->kind = kind;
+	PyObject* result = PyObject_CallFunctionObjArgs(gNumpyAsArray, (PyObject*)array, nullptr);
+	Py_DECREF(array);
+	return result;
+}
+
+
+//// Scene ////
+
+static int 	sceneInit( PyObject* self, PyObject* args, PyObject* kwargs )
+{
+	SceneObject* scene = (SceneObject*)self;
+	static const char* keywords[] = { "threads", nullptr };
+	unsigned threads = 2;
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|I", const_cast<char**>(keywords), &threads))
+		return -1;
+	if (scene->simulation)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "Scene already initialized");
+		return -1;
+	}
+
+	SimulationSettings settings;
+	settings.threads = threads;
+	scene->simulation = new Simulation;
+	if (!scene->simulation->init(settings))
+	{
+		delete scene->simulation;
+		scene->simulation = nullptr;
+		PyErr_SetString(PyExc_RuntimeError, "cannot create the PhysX scene");
+		return -1;
+	}
+	scene->factory = new JointFactory;
+	scene->bodies = new std::vector<PxRigidDynamic*>;
+	scene->statics = new std::vector<PxRigidActor*>;
+	scene->joints = new std::vector<PxJoint*>;
+	scene->arrays = new BodyArrays;
+	scene->exports = 0;
+	return 0;
+}
+
+static void 	sceneDealloc( PyObject* self )
+{
+	SceneObject* scene = (SceneObject*)self;
+	if (scene->simulation)
+	{
+		for (PxJoint* joint : *scene->joints)
+			joint->release();
+		for (PxRigidDynamic* body : *scene->bodies)
+			body->release();
+		for (PxRigidActor* actor : *scene->statics)
+			actor->release();
+		scene->simulation->deinit();
+	}
+	delete scene->simulation;
+	delete scene->factory;
+	delete scene->bodies;
+	delete scene->statics;
+	delete scene->joints;
+	delete scene->arrays;
+	Py_TYPE(self)->tp_free(self);
+}
+
+static bool 	checkInit( SceneObject* scene )
+{
+	if (scene->simulation)
+		return true;
+	PyErr_SetString(PyExc_RuntimeError, "Scene not initialized");
+	return false;
+}
+
+static bool 	checkBody( SceneObject* scene, unsigned index )
+{
+	if (index < scene->bodies->size())
+		return true;
+	PyErr_Format(PyExc_IndexError, "no body %u", index);
+	return false;
+}
+
+static void 	gather( SceneObject* scene )
+{
+	scene->arrays->gather(scene->bodies->data(), scene->bodies->size());
+}
+
+static PyObject* 	sceneAddGround( PyObject* self, PyObject* args )
+{
+	SceneObject* scene = (SceneObject*)self;
+	PxVec3 halfsize, position;
+	if (!checkInit(scene) || !PyArg_ParseTuple(args, "(fff)(fff)", &halfsize.x, &halfsize.y, &halfsize.z,
+			&position.x, &position.y, &position.z))
+		return nullptr;
+
+	PxRigidStatic* ground = scene->simulation->createStaticBox(halfsize, position);
+	scene->simulation->getScene().addActor(*ground);
+	scene->statics->push_back(ground);
+	Py_RETURN_NONE;
+}
+
+static PyObject* 	sceneAddBox( PyObject* self, PyObject* args, PyObject* kwargs )
+{
+	SceneObject* scene = (SceneObject*)self;
+	static const char* keywords[] = { "mass", "halfsize", "position", "kinematic", nullptr };
+	float mass;
+	PxVec3 halfsize, position;
+	int kinematic = 0;
+	if (!checkInit(scene) || !PyArg_ParseTupleAndKeywords(args, kwargs, "f(fff)(fff)|p", const_cast<char**>(keywords),
+			&mass, &halfsize.x, &halfsize.y, &halfsize.z, &position.x, &position.y, &position.z, &kinematic))
+		return nullptr;
+	if (scene->exports)
+	{
+		PyErr_SetString(PyExc_BufferError, "cannot add bodies while poses, velocities or filter_data are in use");
+		return nullptr;
+	}
+
+	PxRigidDynamic* body = scene->simulation->createBox(mass, halfsize, position, kinematic);
+	scene->simulation->getScene().addActor(*body);
+	scene->bodies->push_back(body);
+	gather(scene);
+	return PyLong_FromSize_t(scene->bodies->size() - 1);
+}
+
+static PyObject* 	sceneAttach( PyObject* self, PyObject* args, PyObject* kwargs )
+{
+	SceneObject* scene = (SceneObject*)self;
+	static const char* keywords[] = { "a", "pos_a", "b", "pos_b", "workaround", "projection", nullptr };
+	unsigned a, b;
+	PxVec3 posA, posB;
+	int workaround = 0;
+	int projected = 0;
+	if (!checkInit(scene) || !PyArg_ParseTupleAndKeywords(args, kwargs, "I(fff)I(fff)|pp", const_cast<char**>(keywords),
+			&a, &posA.x, &posA.y, &posA.z, &b, &posB.x, &posB.y, &posB.z, &workaround, &projected))
+		return nullptr;
+	if (!checkBody(scene, a) || !checkBody(scene, b))
+		return nullptr;
+
+	JointProjection projection;
+	projection.enabled = projected;
+	PxFixedJoint* joint = createFixedJoint(scene->simulation->getPhysics(), *scene->factory,
+			(*scene->bodies)[a], posA, (*scene->bodies)[b], posB, workaround, projection);
+	if (!joint)
+	{
+		PyErr_SetString(PyExc_RuntimeError, "cannot create the joint");
+		return nullptr;
+	}
+	scene->joints->push_back(joint);
+	gather(scene); // A moved, and without the workaround the filter data changed
+	Py_RETURN_NONE;
+}
+
+static PyObject* 	sceneStep( PyObject* self, PyObject* args, PyObject* kwargs )
+{
+	SceneObject* scene = (SceneObject*)self;
+	static const char* keywords[] = { "n", "dt", nullptr };
+	unsigned n = 1;
+	float dt = 1.f/60.f;
+	if (!checkInit(scene) || !PyArg_ParseTupleAndKeywords(args, kwargs, "|If", const_cast<char**>(keywords), &n, &dt))
+		return nullptr;
+
+	float ms = 0.f;
+	for (unsigned i = 0; i < n; ++i)
+		ms += scene->simulation->step(dt);
+	gather(scene);
+	return PyFloat_FromDouble(ms);
+}
+
+static PyObject* 	sceneGetPoses( PyObject* self, void* )
+{
+	return checkInit((SceneObject*)self)? getArray((SceneObject*)self, ARRAY_POSES) : nullptr;
+}
+
+static PyObject* 	sceneGetVelocities( PyObject* self, void* )
+{
+	return checkInit((SceneObject*)self)? getArray((SceneObject*)self, ARRAY_VELOCITIES) : nullptr;
+}
+
+static PyObject* 	sceneGetFilterData( PyObject* self, void* )
+{
+	return checkInit((SceneObject*)self)? getArray((SceneObject*)self, ARRAY_FILTER_DATA) : nullptr;
+}
+
+static Py_ssize_t 	sceneLength( PyObject* self )
+{
+	SceneObject* scene = (SceneObject*)self;
+	return scene->bodies? scene->bodies->size() : 0;
+}
+
+static PyMethodDef 	sceneMethods[] = {
+	{ "add_ground", sceneAddGround, METH_VARARGS,
+		"add_ground(halfsize, position): add a static box" },
+	{ "add_box", (PyCFunction)(void(*)(void))sceneAddBox, METH_VARARGS | METH_KEYWORDS,
+		"add_box(mass, halfsize, position, kinematic=False) -> index of the new body" },
+	{ "attach", (PyCFunction)(void(*)(void))sceneAttach, METH_VARARGS | METH_KEYWORDS,
+		"attach(a, pos_a, b, pos_b, workaround=False, projection=False): move body a so that "
+		"the anchors meet and join a and b with a fixed joint" },
+	{ "step", (PyCFunction)(void(*)(void))sceneStep, METH_VARARGS | METH_KEYWORDS,
+		"step(n=1, dt=1/60) -> total step time in ms" },
+	{ nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef 	sceneGetSet[] = {
+	{ const_cast<char*>("poses"), sceneGetPoses, nullptr,
+		const_cast<char*>("(n, 7) float32: position xyz, rotation xyzw"), nullptr },
+	{ const_cast<char*>("velocities"), sceneGetVelocities, nullptr,
+		const_cast<char*>("(n, 6) float32: linear then angular"), nullptr },
+	{ const_cast<char*>("filter_data"), sceneGetFilterData, nullptr,
+		const_cast<char*>("(n, 4) uint32: words of the first shape"), nullptr },
+	{ nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+static PySequenceMethods 	sceneSequence = { sceneLength };
+
+
+//// Module ////
+
+static PyModuleDef 	mcplaneModule = {
+	PyModuleDef_HEAD_INIT, "mcplane", "PhysX scenes of boxes and fixed joints", -1, nullptr
+};
+
+PyMODINIT_FUNC 	PyInit_mcplane( void )
+{
+	ArrayType.tp_name = "mcplane.Array";
+	ArrayType.tp_basicsize = sizeof(ArrayObject);
+	ArrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+	ArrayType.tp_dealloc = arrayDealloc;
+	ArrayType.tp_as_buffer = &arrayBufferProcs;
+	ArrayType.tp_doc = "Buffer over one array of a Scene";
+
+	SceneType.tp_name = "mcplane.Scene";
+	SceneType.tp_basicsize = sizeof(SceneObject);
+	SceneType.tp_flags = Py_TPFLAGS_DEFAULT;
+	SceneType.tp_new = PyType_GenericNew;
+	SceneType.tp_init = sceneInit;
+	SceneType.tp_dealloc = sceneDealloc;
+	SceneType.tp_methods = sceneMethods;
+	SceneType.tp_getset = sceneGetSet;
+	SceneType.tp_as_sequence = &sceneSequence;
+	SceneType.tp_doc = "Scene(threads=2): a PhysX scene stepped from Python";
+
+	if (PyType_Ready(&ArrayType) < 0 || PyType_Ready(&SceneType) < 0)
+		return nullptr;
+
+	PyObject* module = PyModule_Create(&mcplaneModule);
+	if (!module)
+		return nullptr;
+	Py_INCREF(&SceneType);
+	if (PyModule_AddObject(module, "Scene", (PyObject*)&SceneType) < 0)
+	{
+		Py_DECREF(&SceneType);
+		Py_DECREF(module);
+		return nullptr;
+	}
+	return module;
+}